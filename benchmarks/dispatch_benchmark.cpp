@@ -0,0 +1,115 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "CompiledModule.h"
+#include "Interpreter.h"
+
+/*
+ * Measures the dispatch throughput of the interpreter on the test modules.
+ *
+ * Every function without parameters that runs without an error is invoked in a loop
+ * until the time budget of the module is used up. The binary is built once per dispatch
+ * mode (see benchmarks/CMakeLists.txt), so comparing the output of
+ * dispatch_benchmark_switch and dispatch_benchmark_threaded compares the two engines.
+ */
+
+static const std::vector<std::string> benchmark_modules = {
+    "01_test.wasm",
+    "02_test_prio1.wasm",
+    "03_test_prio2.wasm",
+    "04_test_prio3.wasm",
+    "05_test_complex.wasm",
+    "06_test_fc.wasm",
+    "07_test_bulk_memory.wasm",
+};
+
+static constexpr std::chrono::milliseconds time_per_module(500);
+
+// Number of rounds over all functions before the interpreter is recreated, which keeps
+// the values that the benchmarked functions leave on the operand stack bounded.
+static constexpr size_t rounds_per_instance = 64;
+
+std::vector<uint32_t> find_runnable_functions(const std::shared_ptr<const CompiledModule>& compiled_module) {
+    const Module& module = compiled_module->module();
+    std::vector<uint32_t> runnable;
+    for (uint32_t i = 0; i < module.functions.size(); ++i) {
+        if (module.functions.frames[i].param_count != 0) {
+            continue;
+        }
+        // Functions that trap or use unimplemented opcodes are not benchmarked
+        Interpreter interpreter(compiled_module);
+        if (interpreter.invoke(i).ok()) {
+            runnable.push_back(i);
+        }
+    }
+    return runnable;
+}
+
+int main() {
+    // The parser and interpreter log to std::cout, which would dominate the measurement
+    std::ostream report(std::cout.rdbuf());
+    std::cout.rdbuf(nullptr);
+
+    report << "Dispatch mode: " << DISPATCH_MODE_NAME << std::endl;
+    report << std::left << std::setw(28) << "Module"
+           << std::right << std::setw(10) << "Functions"
+           << std::setw(16) << "Instructions"
+           << std::setw(12) << "Seconds"
+           << std::setw(14) << "MInstr/s" << std::endl;
+
+    uint64_t total_instructions = 0;
+    double total_seconds = 0;
+
+    for (const auto& name : benchmark_modules) {
+        auto compiled_module = CompiledModule::compile(ModuleBinary::map_file(std::string(WASM_TEST_DIR) + "/" + name));
+
+        std::vector<uint32_t> runnable = find_runnable_functions(compiled_module);
+
+        uint64_t instructions = 0;
+        std::chrono::duration<double> elapsed(0);
+
+        while (!runnable.empty() && elapsed < time_per_module) {
+            Interpreter interpreter(compiled_module);
+
+            std::optional<uint32_t> trapped_function;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t round = 0; round < rounds_per_instance && !trapped_function; ++round) {
+                for (uint32_t function_index : runnable) {
+                    if (!interpreter.invoke(function_index).ok()) {
+                        trapped_function = function_index;
+                        break;
+                    }
+                }
+            }
+            elapsed += std::chrono::steady_clock::now() - start;
+            if (trapped_function) {
+                // A function that only traps on repeated runs is dropped from the benchmark
+                std::erase(runnable, *trapped_function);
+            }
+            instructions += interpreter.get_executed_instructions();
+        }
+
+        double seconds = elapsed.count();
+        report << std::left << std::setw(28) << name
+               << std::right << std::setw(10) << runnable.size()
+               << std::setw(16) << instructions
+               << std::setw(12) << std::fixed << std::setprecision(3) << seconds
+               << std::setw(14) << std::setprecision(1) << (seconds > 0 ? instructions / seconds / 1e6 : 0.0)
+               << std::endl;
+
+        total_instructions += instructions;
+        total_seconds += seconds;
+    }
+
+    report << std::left << std::setw(28) << "Total" << std::right << std::setw(10) << ""
+           << std::setw(16) << total_instructions
+           << std::setw(12) << std::fixed << std::setprecision(3) << total_seconds
+           << std::setw(14) << std::setprecision(1) << total_instructions / total_seconds / 1e6
+           << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CompiledModule.h"
+#include "Interpreter.h"
+#include "Opcodes.h"
+
+/*
+ * Mines the most frequent sequences of register instructions from a profiling run.
+ *
+ * Every function without parameters that runs without a trap is invoked a fixed number of
+ * times, and the interpreter counts each pair and triple of adjacent instructions that ran
+ * one after the other. The sequences that dominate are the candidates for the next
+ * superinstructions of the Fuser. The code is profiled after fusion, so the report shows
+ * what is still dispatched separately.
+ */
+
+static const std::vector<std::string> profiled_modules = {
+    "01_test.wasm",
+    "02_test_prio1.wasm",
+    "03_test_prio2.wasm",
+    "04_test_prio3.wasm",
+    "05_test_complex.wasm",
+    "06_test_fc.wasm",
+    "07_test_bulk_memory.wasm",
+};
+
+static constexpr size_t profiling_rounds = 64;
+
+// The number of sequences of each length to report
+static constexpr size_t reported_sequences = 20;
+
+std::string opcode_name(uint16_t opcode) {
+    switch (opcode) {
+        case 0x00: return "unreachable";
+        case 0x0F: return "return";
+        case 0x10: return "call";
+        case 0x1B: return "select";
+        case 0x23: return "global.get";
+        case 0x24: return "global.set";
+        case 0x3F: return "memory.size";
+        case 0x40: return "memory.grow";
+        case 0x41: return "i32.const";
+        case 0x42: return "i64.const";
+        case 0x43: return "f32.const";
+        case 0x44: return "f64.const";
+        case REG_COPY: return "copy";
+        case REG_JUMP: return "jump";
+        case REG_JUMP_IF: return "jump_if";
+        case REG_JUMP_UNLESS: return "jump_unless";
+        case REG_LOOP_JUMP: return "loop_jump";
+        case REG_LOOP_JUMP_IF: return "loop_jump_if";
+        case REG_BR_TABLE: return "br_table";
+
+#define MINER_NUMERIC_NAME(opcode, name, shape, Operand, Result, expression) case opcode: return #name;
+#define MINER_PREFIXED_NUMERIC_NAME(opcode, name, shape, Operand, Result, expression) case PREFIX_FC + opcode: return #name;
+
+        WASM_NUMERIC_OPCODES(MINER_NUMERIC_NAME)
+        WASM_PREFIXED_NUMERIC_OPCODES(MINER_PREFIXED_NUMERIC_NAME)
+
+#undef MINER_PREFIXED_NUMERIC_NAME
+#undef MINER_NUMERIC_NAME
+    }
+    if (opcode >= REG_COMPARE_IMMEDIATE_JUMP) return opcode_name(opcode - REG_COMPARE_IMMEDIATE_JUMP) + "_immediate_jump";
+    if (opcode >= REG_COMPARE_JUMP) return opcode_name(opcode - REG_COMPARE_JUMP) + "_jump";
+    if (opcode >= REG_WITH_IMMEDIATE) return opcode_name(opcode - REG_WITH_IMMEDIATE) + "_immediate";
+    if (opcode >= 0x28 && opcode <= 0x35) return "load";
+    if (opcode >= 0x36 && opcode <= 0x3E) return "store";
+
+    std::stringstream name;
+    name << "0x" << std::hex << std::uppercase << opcode;
+    return name.str();
+}
+
+std::string sequence_name(uint64_t key) {
+    std::string name = opcode_name(static_cast<uint16_t>(key >> 32)) + " ; " + opcode_name(static_cast<uint16_t>(key >> 16));
+    if (static_cast<uint16_t>(key) != 0) {
+        name += " ; " + opcode_name(static_cast<uint16_t>(key));
+    }
+    return name;
+}
+
+std::vector<uint32_t> find_runnable_functions(const std::shared_ptr<const CompiledModule>& compiled_module) {
+    const Module& module = compiled_module->module();
+    std::vector<uint32_t> runnable;
+    for (uint32_t i = 0; i < module.functions.size(); ++i) {
+        if (module.functions.frames[i].param_count != 0) {
+            continue;
+        }
+        Interpreter interpreter(compiled_module);
+        if (interpreter.invoke(i).ok()) {
+            runnable.push_back(i);
+        }
+    }
+    return runnable;
+}
+
+void report_sequences(std::ostream& report, const std::unordered_map<uint64_t, uint64_t>& counts,
+                      bool triples, uint64_t total_instructions) {
+    std::vector<std::pair<uint64_t, uint64_t>> sequences;
+    for (const auto& [key, count] : counts) {
+        if ((static_cast<uint16_t>(key) != 0) == triples) {
+            sequences.emplace_back(key, count);
+        }
+    }
+    std::sort(sequences.begin(), sequences.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    sequences.resize(std::min(sequences.size(), reported_sequences));
+
+    report << std::endl << (triples ? "Triples" : "Pairs") << std::endl;
+    for (const auto& [key, count] : sequences) {
+        report << std::left << std::setw(56) << sequence_name(key)
+               << std::right << std::setw(14) << count
+               << std::setw(9) << std::fixed << std::setprecision(1) << 100.0 * count / total_instructions << " %"
+               << std::endl;
+    }
+}
+
+int main() {
+    std::ostream report(std::cout.rdbuf());
+    std::cout.rdbuf(nullptr);
+
+    std::unordered_map<uint64_t, uint64_t> counts;
+    uint64_t total_instructions = 0;
+
+    for (const auto& name : profiled_modules) {
+        auto compiled_module = CompiledModule::compile(ModuleBinary::map_file(std::string(WASM_TEST_DIR) + "/" + name));
+
+        for (uint32_t function_index : find_runnable_functions(compiled_module)) {
+            Interpreter interpreter(compiled_module);
+            for (size_t round = 0; round < profiling_rounds; ++round) {
+                interpreter.invoke(function_index);
+            }
+            for (const auto& [key, count] : interpreter.get_sequence_counts()) {
+                counts[key] += count;
+            }
+            total_instructions += interpreter.get_executed_instructions();
+        }
+    }
+
+    report << "Dispatched register instructions: " << total_instructions << std::endl;
+    report << "Share of all dispatches that start each sequence" << std::endl;
+    report_sequences(report, counts, false, total_instructions);
+    report_sequences(report, counts, true, total_instructions);
+    return 0;
+}
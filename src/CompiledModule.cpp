@@ -0,0 +1,107 @@
+#include "CompiledModule.h"
+#include "ModuleCache.h"
+#include "Parser.h"
+#include "Interpreter.h"
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <thread>
+#include <utility>
+
+std::shared_ptr<const CompiledModule> CompiledModule::compile(ModuleBinary binary, const CompileOptions& options) {
+    // Moving the binary leaves its bytes in place, so the spans of the module stay valid
+    std::span<const uint8_t> bytes = binary.bytes();
+    std::optional<ModuleCache> cache;
+    if (!options.cache_directory.empty()) {
+        cache.emplace(options.cache_directory);
+        if (std::optional<Module> cached = cache->load(bytes)) {
+            return std::make_shared<const CompiledModule>(std::move(binary), std::move(*cached));
+        }
+    }
+
+    uint32_t threads = options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    Module module;
+    Parser parser(bytes, threads, options.lazy);
+    parser.parse_into(module);
+    auto compiled_module = std::make_shared<const CompiledModule>(std::move(binary), std::move(module), options.lazy);
+    if (cache && !options.lazy) {
+        cache->store(bytes, compiled_module->module());
+    }
+    return compiled_module;
+}
+
+std::shared_ptr<const CompiledModule> CompiledModule::compile(std::vector<uint8_t> binary, const CompileOptions& options) {
+    return compile(ModuleBinary(std::move(binary)), options);
+}
+
+CompiledModule::CompiledModule(ModuleBinary binary, Module module, bool lazy)
+    : binary(std::move(binary)), parsed_module(std::move(module)),
+      function_ready(std::make_unique<std::atomic<bool>[]>(parsed_module.functions.size()))
+#if WASM_JIT
+    , jit(parsed_module, Interpreter::jit_helpers())
+    , shared_code(std::make_unique<SharedCode[]>(parsed_module.functions.size()))
+#endif
+{
+    for (size_t i = 0; i < parsed_module.functions.size(); ++i) {
+        function_ready[i].store(!lazy, std::memory_order_relaxed);
+    }
+
+    for (const GlobalType& global : parsed_module.globals) {
+        global_values.push_back(global.initial_value);
+    }
+
+    // Segments that do not fit fail here, as the size of the memory does not depend on the instance
+    size_t memory_size = static_cast<size_t>(parsed_module.memory_initial_pages) * PAGE_SIZE;
+    size_t active_bytes = 0;
+    for (const DataSegment& segment : parsed_module.data_segments) {
+        if (!segment.is_active) {
+            continue;
+        }
+        if (segment.memory_offset > memory_size || segment.bytes.size() > memory_size - segment.memory_offset) {
+            throw std::runtime_error("Data segment does not fit into memory");
+        }
+        active_bytes += segment.bytes.size();
+    }
+
+    if (active_bytes >= DATA_IMAGE_THRESHOLD) {
+        LinearMemory initial_memory(parsed_module.memory_initial_pages, parsed_module.memory_initial_pages);
+        for (const DataSegment& segment : parsed_module.data_segments) {
+            if (segment.is_active) {
+                std::memcpy(initial_memory.data() + segment.memory_offset, segment.bytes.data(), segment.bytes.size());
+            }
+        }
+        data_image = std::make_shared<const MemoryImage>(initial_memory);
+    }
+}
+
+void CompiledModule::copy_data_segments(LinearMemory& memory) const {
+    if (data_image != nullptr) {
+        return;
+    }
+    // In order, so a later segment overwrites an earlier one where they overlap
+    for (const DataSegment& segment : parsed_module.data_segments) {
+        if (segment.is_active) {
+            std::memcpy(memory.data() + segment.memory_offset, segment.bytes.data(), segment.bytes.size());
+        }
+    }
+}
+
+void CompiledModule::compile_function(uint32_t function_index) const {
+    std::lock_guard<std::mutex> lock(compile_locks[function_index % COMPILE_LOCKS]);
+    if (function_ready[function_index].load(std::memory_order_relaxed)) {
+        return; // Translated by a concurrent caller
+    }
+    // A translation that throws leaves the flag unset, so the next call fails the same way
+    Parser::compile_function(parsed_module, function_index);
+    function_ready[function_index].store(true, std::memory_order_release);
+}
+
+#if WASM_JIT
+const CompiledFunction& CompiledModule::compiled_function(uint32_t function_index) const {
+    SharedCode& shared = shared_code[function_index];
+    std::call_once(shared.compiled, [this, &shared, function_index] {
+        shared.code = jit.compile(function_index);
+    });
+    return shared.code;
+}
+#endif
@@ -0,0 +1,155 @@
+#ifndef COMPILED_MODULE_H
+#define COMPILED_MODULE_H
+
+#include "Module.h"
+#include "JitCompiler.h"
+#include "LinearMemory.h"
+#include "ModuleBinary.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @struct CompileOptions
+ * @brief How CompiledModule::compile does its work. The resulting module is the same with any options.
+ */
+struct CompileOptions {
+    uint32_t threads = 0; // The threads that validate and translate function bodies, 0 for one per hardware thread.
+    bool lazy = false;    // Validate and translate each function on its first call instead (see CompiledModule::function).
+    std::string cache_directory; // A ModuleCache to load the module from, and to store it in once compiled; empty for none.
+};
+
+/**
+ * @class CompiledModule
+ * @brief A module that is ready to run: parsed, validated and translated to register code.
+ *
+ * All the work that depends only on the binary is done once, here, and never per instance.
+ * A CompiledModule is immutable once created and safe to share between threads, usually
+ * through a `std::shared_ptr<const CompiledModule>` that every Interpreter instantiating it
+ * holds on to. The Interpreter holds everything an instance changes: its memory, globals and
+ * stacks.
+ *
+ * The CompiledModule owns the binary, which the module's function bodies, export names and
+ * data segments point into. Modules
+ * with at least DATA_IMAGE_THRESHOLD bytes of active data are written into a MemoryImage
+ * once, here, which every instance maps copy-on-write instead of copying the data in. The
+ * few bytes of smaller modules are copied into each instance's memory.
+ *
+ * Compiled lazily, the module is only parsed up front, and each function is validated and
+ * translated on its first call, so the cost of starting up is in the code that actually runs.
+ *
+ * With a cache directory, a module that was compiled before is loaded from its ModuleCache
+ * artifact instead, which skips parsing, validation and translation altogether. Only modules
+ * compiled eagerly are stored, as a lazily compiled one is not complete.
+ *
+ * With WASM_JIT, the machine code of a function is shared the same way. It refers to no
+ * instance (the instance is passed in the JitContext of every call), so the first instance
+ * that finds a function hot compiles it for all of them.
+ */
+class CompiledModule {
+public:
+    /**
+     * @brief Parses, validates and translates a module.
+     * @param binary The bytes of the wasm file, such as a file mapped with ModuleBinary::map_file,
+     *        which the CompiledModule takes over.
+     * @param options How to compile, such as on how many threads.
+     * @throws std::runtime_error if the binary is malformed, the module is invalid or its
+     *         active data segments do not fit into its memory. A cache that cannot be read or
+     *         written is not an error, the module is compiled instead.
+     */
+    static std::shared_ptr<const CompiledModule> compile(ModuleBinary binary, const CompileOptions& options = {});
+
+    /**
+     * @brief Parses, validates and translates a module from bytes that are already in memory.
+     */
+    static std::shared_ptr<const CompiledModule> compile(std::vector<uint8_t> binary, const CompileOptions& options = {});
+
+    /**
+     * @param binary The bytes the module was parsed from, which the module points into.
+     * @param module A module filled by Parser::parse_into, which has already been validated and translated.
+     */
+    CompiledModule(ModuleBinary binary, Module module, bool lazy = false);
+
+    CompiledModule(const CompiledModule&) = delete;
+    CompiledModule& operator=(const CompiledModule&) = delete;
+
+    /**
+     * @brief The parsed module. The code of a function that was compiled lazily is only there once prepare_function() returned.
+     */
+    const Module& module() const { return parsed_module; }
+
+    /**
+     * @brief Makes sure a function of the module is validated and translated to register code,
+     * which module().functions then holds.
+     *
+     * In a module compiled lazily, the first call for a function validates and translates it.
+     * Concurrent first callers wait for that one translation.
+     * @throws std::runtime_error if the function is invalid, on every call for it.
+     */
+    void prepare_function(uint32_t function_index) const {
+        if (!function_ready[function_index].load(std::memory_order_acquire)) {
+            compile_function(function_index);
+        }
+    }
+
+    /**
+     * @brief The values every instance starts its globals with, in the order of the module's globals.
+     */
+    const std::vector<Value>& initial_globals() const { return global_values; }
+
+    /**
+     * @brief The initial memory of every instance, holding the active data segments.
+     * @return The image, or nullptr if instances start with zeros and copy_data_segments.
+     */
+    const std::shared_ptr<const MemoryImage>& memory_image() const { return data_image; }
+
+    /**
+     * @brief Writes the active data segments into a new or reset memory, unless they are in memory_image().
+     */
+    void copy_data_segments(LinearMemory& memory) const;
+
+#if WASM_JIT
+    /**
+     * @brief The machine code of a function, compiled by the first caller that asks for it.
+     *
+     * Concurrent callers for the same function wait for that one compilation, which stays
+     * valid for the lifetime of the CompiledModule.
+     * @return The compiled entry points, without any if the JIT does not support the function.
+     */
+    const CompiledFunction& compiled_function(uint32_t function_index) const;
+#endif
+
+    // The number of bytes of active data from which instances map an image rather than copying it
+    static constexpr size_t DATA_IMAGE_THRESHOLD = PAGE_SIZE;
+
+private:
+    const ModuleBinary binary;
+    mutable Module parsed_module; // Lazily compiled functions are translated in place
+
+    // Lazy compilation locks one of these, chosen by function index. A translation never
+    // needs another function's, and a translation that throws leaves nothing locked.
+    static constexpr size_t COMPILE_LOCKS = 64;
+
+    std::unique_ptr<std::atomic<bool>[]> function_ready; // Per function, whether its code is translated
+    mutable std::mutex compile_locks[COMPILE_LOCKS];
+
+    std::vector<Value> global_values;
+    std::shared_ptr<const MemoryImage> data_image;
+
+    void compile_function(uint32_t function_index) const;
+
+#if WASM_JIT
+    struct SharedCode {
+        std::once_flag compiled;
+        CompiledFunction code;
+    };
+
+    mutable JitCompiler jit;
+    std::unique_ptr<SharedCode[]> shared_code; // One per function
+#endif
+};
+
+#endif //COMPILED_MODULE_H
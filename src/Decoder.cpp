@@ -0,0 +1,258 @@
+#include "Decoder.h"
+#include "Leb128.h"
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <type_traits>
+
+Decoder::Decoder(std::span<const uint8_t> code) : code(code), offset(0) {}
+
+void Decoder::decode_into(FunctionCode& func) {
+    func.instructions.clear();
+    func.branch_table.clear();
+    // Most instructions take two bytes or more, so this is seldom too little, and saves the
+    // reallocations that otherwise dominate decoding large bodies
+    func.instructions.reserve(code.size() / 2 + 1);
+
+    // Indices of the block, loop and if instructions that are still open
+    std::vector<uint32_t> open_blocks;
+
+    while (offset < code.size()) {
+        uint32_t pc = func.instructions.size();
+        func.instructions.push_back(decode_instruction(func));
+        link_block_targets(func, open_blocks, pc);
+    }
+
+    if (!open_blocks.empty()) {
+        throw std::runtime_error("Function body ends inside an unterminated block");
+    }
+
+    // The parser strips the 'end' that closes the function body. It is put back as the
+    // last instruction, so execution always leaves a function through an 'end' or 'return'.
+    Instruction function_end{};
+    function_end.opcode = 0x0B;
+    func.instructions.push_back(function_end);
+}
+
+void Decoder::link_block_targets(FunctionCode& func, std::vector<uint32_t>& open_blocks, uint32_t pc) {
+    Instruction& instr = func.instructions[pc];
+
+    switch (instr.opcode) {
+        case 0x02: // block
+        case 0x03: // loop
+        case 0x04: // if
+            open_blocks.push_back(pc);
+            break;
+        case 0x05: { // else
+            if (open_blocks.empty() || func.instructions[open_blocks.back()].opcode != 0x04) {
+                throw std::runtime_error("'else' without a matching 'if'");
+            }
+            Instruction& if_instr = func.instructions[open_blocks.back()];
+            if (if_instr.b != 0) {
+                throw std::runtime_error("'if' with more than one 'else'");
+            }
+            if_instr.b = pc + 1;
+            break;
+        }
+        case 0x0B: { // end
+            if (open_blocks.empty()) {
+                throw std::runtime_error("'end' without a matching block");
+            }
+            Instruction& block_instr = func.instructions[open_blocks.back()];
+            open_blocks.pop_back();
+            block_instr.a = pc;
+            // The 'else' of an 'if' jumps straight to the shared 'end'
+            if (block_instr.opcode == 0x04 && block_instr.b != 0) {
+                func.instructions[block_instr.b - 1].a = pc;
+            }
+            break;
+        }
+    }
+}
+
+uint8_t Decoder::read_byte() {
+    if (offset >= code.size()) {
+        throw std::runtime_error("Unexpected end of function body");
+    }
+    return code[offset++];
+}
+
+template <typename T>
+T Decoder::decode_leb128_u() {
+    return decode_leb128<std::make_unsigned_t<T>>(code, offset, "Unexpected end of function body");
+}
+
+template <typename T>
+T Decoder::decode_leb128_s() {
+    return decode_leb128<std::make_signed_t<T>>(code, offset, "Unexpected end of function body");
+}
+
+template <typename T>
+T Decoder::read_immediate() {
+    if (offset + sizeof(T) > code.size()) {
+        throw std::runtime_error("Unexpected end of function body");
+    }
+    T value;
+    std::memcpy(&value, &code[offset], sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+Instruction Decoder::decode_instruction(FunctionCode& func) {
+    Instruction instr{};
+    instr.opcode = read_byte();
+
+    switch (instr.opcode) {
+        // === CONTROL FLOW ===
+        case 0x02: // block
+        case 0x03: // loop
+        case 0x04: // if
+            // The block type is a signed 33-bit value: negative for the empty type (0x40)
+            // and single value types, a type index otherwise.
+            instr.value.i64 = decode_leb128_s<int64_t>();
+            break;
+        case 0x0C: // br
+        case 0x0D: // br_if
+        case 0x10: // call
+        case 0x12: // return_call
+            instr.a = decode_leb128_u<uint32_t>();
+            break;
+        case 0x0E: { // br_table
+            uint32_t num_labels = decode_leb128_u<uint32_t>();
+            instr.a = func.branch_table.size();
+            instr.b = num_labels;
+            // The default label is stored right after the label list
+            for (uint32_t i = 0; i <= num_labels; ++i) {
+                func.branch_table.push_back(decode_leb128_u<uint32_t>());
+            }
+            break;
+        }
+        case 0x11: // call_indirect
+        case 0x13: // return_call_indirect
+            instr.a = decode_leb128_u<uint32_t>(); // type index
+            instr.b = decode_leb128_u<uint32_t>(); // table index
+            break;
+        case 0x1C: { // select t*
+            // The Validator only accepts exactly one type, the last one read is kept in `a`
+            instr.b = decode_leb128_u<uint32_t>();
+            for (uint32_t i = 0; i < instr.b; ++i) {
+                instr.a = read_byte();
+            }
+            break;
+        }
+
+        // === VARIABLES AND TABLES ===
+        case 0x20: // local.get
+        case 0x21: // local.set
+        case 0x22: // local.tee
+        case 0x23: // global.get
+        case 0x24: // global.set
+        case 0x25: // table.get
+        case 0x26: // table.set
+            instr.a = decode_leb128_u<uint32_t>();
+            break;
+
+        // === LOAD AND STORE ===
+        case 0x28: case 0x29: case 0x2A: case 0x2B: case 0x2C: case 0x2D: case 0x2E: case 0x2F:
+        case 0x30: case 0x31: case 0x32: case 0x33: case 0x34: case 0x35: case 0x36: case 0x37:
+        case 0x38: case 0x39: case 0x3A: case 0x3B: case 0x3C: case 0x3D: case 0x3E:
+            instr.b = decode_leb128_u<uint32_t>(); // alignment
+            instr.a = decode_leb128_u<uint32_t>(); // offset
+            break;
+
+        // === MEMORY ===
+        case 0x3F: // memory.size
+            if (read_byte() != 0x00) {
+                throw std::runtime_error("Invalid memory.size instruction format");
+            }
+            break;
+        case 0x40: // memory.grow
+            if (read_byte() != 0x00) {
+                throw std::runtime_error("Invalid memory.grow instruction format");
+            }
+            break;
+
+        // === IMMEDIATES ===
+        case 0x41: instr.value.i32 = decode_leb128_s<int32_t>(); break; // i32.const
+        case 0x42: instr.value.i64 = decode_leb128_s<int64_t>(); break; // i64.const
+        case 0x43: instr.value.f32 = read_immediate<float>(); break;    // f32.const
+        case 0x44: instr.value.f64 = read_immediate<double>(); break;   // f64.const
+
+        // === REFERENCES ===
+        case 0xD0: instr.a = read_byte(); break;                    // ref.null
+        case 0xD2: instr.a = decode_leb128_u<uint32_t>(); break;    // ref.func
+
+        case 0xFC: decode_prefixed_instruction(instr); break;
+
+        // === NO IMMEDIATES ===
+        case 0x00: // unreachable
+        case 0x01: // nop
+        case 0x05: // else
+        case 0x0B: // end
+        case 0x0F: // return
+        case 0x1A: // drop
+        case 0x1B: // select
+        case 0xD1: // ref.is_null
+            break;
+
+        default:
+            // All numeric instructions (0x45 - 0xC4) carry no immediates.
+            if (instr.opcode >= 0x45 && instr.opcode <= 0xC4) {
+                break;
+            }
+            std::stringstream error_stream;
+            error_stream << "Unknown opcode while decoding: 0x"
+                         << std::hex << std::uppercase << std::setw(2) << std::setfill('0')
+                         << (int)instr.opcode;
+            throw std::runtime_error(error_stream.str());
+    }
+
+    return instr;
+}
+
+void Decoder::decode_prefixed_instruction(Instruction& instr) {
+    uint32_t sub_opcode = decode_leb128_u<uint32_t>();
+    instr.opcode = PREFIX_FC + sub_opcode;
+
+    switch (sub_opcode) {
+        case 0x00: case 0x01: case 0x02: case 0x03: // i32.trunc_sat_*
+        case 0x04: case 0x05: case 0x06: case 0x07: // i64.trunc_sat_*
+            break;
+        case 0x08: // memory.init
+            instr.a = decode_leb128_u<uint32_t>(); // data index
+            read_byte(); // memory index
+            break;
+        case 0x09: // data.drop
+            instr.a = decode_leb128_u<uint32_t>();
+            break;
+        case 0x0A: // memory.copy
+            read_byte();
+            read_byte();
+            break;
+        case 0x0B: // memory.fill
+            read_byte();
+            break;
+        case 0x0C: // table.init
+            instr.a = decode_leb128_u<uint32_t>(); // element index
+            instr.b = decode_leb128_u<uint32_t>(); // table index
+            break;
+        case 0x0D: // elem.drop
+            instr.a = decode_leb128_u<uint32_t>();
+            break;
+        case 0x0E: // table.copy
+            instr.a = decode_leb128_u<uint32_t>(); // destination table
+            instr.b = decode_leb128_u<uint32_t>(); // source table
+            break;
+        case 0x0F: // table.grow
+        case 0x10: // table.size
+        case 0x11: // table.fill
+            instr.a = decode_leb128_u<uint32_t>();
+            break;
+        default:
+            std::stringstream error_stream;
+            error_stream << "Unknown opcode while decoding: 0xFC 0x"
+                         << std::hex << std::uppercase << std::setw(2) << std::setfill('0')
+                         << sub_opcode;
+            throw std::runtime_error(error_stream.str());
+    }
+}
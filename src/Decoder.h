@@ -0,0 +1,56 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <vector>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+#include "Module.h"
+
+/**
+ * @class Decoder
+ * @brief Translates the raw bytecode of a function body into pre-decoded instructions.
+ *
+ * The decoder runs once per function at load time. It walks the bytecode, decodes every
+ * LEB128 and fixed-size immediate and emits one fixed-width `Instruction` per opcode,
+ * which is what the interpreter executes afterwards. It also links every block, loop
+ * and if to its matching else/end, so control flow never has to scan the body.
+ */
+class Decoder {
+public:
+    /**
+     * @brief Constructs a Decoder for the bytecode of a single function body.
+     * @param code The raw bytecode of the function body.
+     */
+    explicit Decoder(std::span<const uint8_t> code);
+
+    /**
+     * @brief Decodes the bytecode and fills the instruction stream of a function.
+     * @param func The code whose `instructions` and `branch_table` are populated.
+     */
+    void decode_into(FunctionCode& func);
+
+private:
+    std::span<const uint8_t> code;
+    size_t offset;
+
+    uint8_t read_byte();
+
+    Instruction decode_instruction(FunctionCode& func);
+
+    void link_block_targets(FunctionCode& func, std::vector<uint32_t>& open_blocks, uint32_t pc);
+
+    void decode_prefixed_instruction(Instruction& instr);
+
+    template <typename T>
+    T decode_leb128_u();
+
+    template <typename T>
+    T decode_leb128_s();
+
+    template <typename T>
+    T read_immediate();
+};
+
+#endif //DECODER_H
@@ -0,0 +1,129 @@
+#include "Fuser.h"
+#include "Opcodes.h"
+
+namespace {
+
+bool is_jump(uint16_t opcode) {
+    return opcode >= REG_JUMP && opcode <= REG_LOOP_JUMP_IF;
+}
+
+bool is_compare_jump(uint16_t opcode) {
+    return opcode >= REG_COMPARE_JUMP && opcode < REG_COMPARE_JUMP + 0x100;
+}
+
+bool is_constant(uint16_t opcode) {
+    return opcode >= 0x41 && opcode <= 0x44;
+}
+
+// The comparison that holds exactly when `opcode` does not, 0 if `opcode` is no integer comparison
+uint16_t negated_compare(uint16_t opcode) {
+    switch (opcode) {
+#define FUSER_NEGATED_COMPARE(opcode, name, negated_opcode) case opcode: return negated_opcode;
+
+        WASM_INTEGER_COMPARE_OPCODES(FUSER_NEGATED_COMPARE)
+
+#undef FUSER_NEGATED_COMPARE
+        default:
+            return 0;
+    }
+}
+
+bool is_commutative(uint16_t opcode) {
+    switch (opcode) {
+        case 0x46: case 0x47: case 0x51: case 0x52: // eq, ne
+        case 0x6A: case 0x6C: case 0x71: case 0x72: case 0x73: // i32 add, mul, and, or, xor
+        case 0x7C: case 0x7E: case 0x83: case 0x84: case 0x85: // i64 add, mul, and, or, xor
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Fuses `second` into `first` if they form a superinstruction. `temporaries` is the first
+// slot that holds operands rather than locals.
+bool fuse_pair(RegisterInstruction& first, const RegisterInstruction& second, uint32_t temporaries) {
+    uint32_t slot = first.r;
+    if (slot < temporaries) {
+        return false;
+    }
+
+    // A constant folded into the binary operation that consumes it
+    if (is_constant(first.opcode) && second.opcode < PREFIX_FC && numeric_arity(second.opcode) == 2) {
+        uint32_t other;
+        if (second.b == slot && second.a != slot) {
+            other = second.a;
+        } else if (second.a == slot && second.b != slot && is_commutative(second.opcode)) {
+            other = second.b;
+        } else {
+            return false;
+        }
+        first = RegisterInstruction{static_cast<uint16_t>(REG_WITH_IMMEDIATE + second.opcode), second.r, other, 0, first.imm};
+        return true;
+    }
+
+    // A comparison folded into the conditional jump on its result
+    bool with_immediate = first.opcode >= REG_WITH_IMMEDIATE && first.opcode < REG_COMPARE_JUMP;
+    uint16_t compare = with_immediate ? first.opcode - REG_WITH_IMMEDIATE : first.opcode;
+    if (negated_compare(compare) == 0 || second.a != slot
+        || (second.opcode != REG_JUMP_IF && second.opcode != REG_JUMP_UNLESS)) {
+        return false;
+    }
+    if (second.opcode == REG_JUMP_UNLESS) {
+        compare = negated_compare(compare);
+    }
+    uint16_t base = with_immediate ? REG_COMPARE_IMMEDIATE_JUMP : REG_COMPARE_JUMP;
+    // The jump target moves to `r`, the comparison keeps its operands
+    first = RegisterInstruction{static_cast<uint16_t>(base + compare), static_cast<uint32_t>(second.imm.i64),
+                                first.a, first.b, first.imm};
+    return true;
+}
+
+} // namespace
+
+Fuser::Fuser(Module& module) : module(module) {}
+
+void Fuser::fuse_function(const FrameLayout& frame, FunctionCode& function_code) {
+    uint32_t temporaries = frame.param_count + frame.local_count;
+    const std::vector<RegisterInstruction>& code = function_code.register_code;
+
+    // An instruction a jump lands on must stay the first one of any superinstruction
+    std::vector<bool> is_target(code.size() + 1, false);
+    for (const RegisterInstruction& instr : code) {
+        if (is_jump(instr.opcode)) {
+            is_target[instr.imm.i64] = true;
+        }
+    }
+    for (uint32_t target : function_code.register_branch_table) {
+        is_target[target] = true;
+    }
+
+    std::vector<RegisterInstruction> fused;
+    fused.reserve(code.size());
+    // A superinstruction traps where its last part would, so it keeps that part's origin
+    std::vector<uint32_t> origins;
+    origins.reserve(code.size());
+    std::vector<uint32_t> new_pc(code.size() + 1);
+    for (size_t pc = 0; pc < code.size();) {
+        new_pc[pc] = fused.size();
+        RegisterInstruction instr = code[pc++];
+        while (pc < code.size() && !is_target[pc] && fuse_pair(instr, code[pc], temporaries)) {
+            new_pc[pc++] = fused.size();
+        }
+        fused.push_back(instr);
+        origins.push_back(function_code.register_origins[pc - 1]);
+    }
+    new_pc[code.size()] = fused.size();
+
+    for (RegisterInstruction& instr : fused) {
+        if (is_jump(instr.opcode)) {
+            instr.imm.i64 = new_pc[instr.imm.i64];
+        } else if (is_compare_jump(instr.opcode)) {
+            instr.r = new_pc[instr.r];
+        }
+    }
+    for (uint32_t& target : function_code.register_branch_table) {
+        target = new_pc[target];
+    }
+    function_code.register_code = std::move(fused);
+    function_code.register_origins = std::move(origins);
+}
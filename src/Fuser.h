@@ -0,0 +1,41 @@
+#ifndef FUSER_H
+#define FUSER_H
+
+#include "Module.h"
+
+/**
+ * @class Fuser
+ * @brief Replaces common sequences of register code with single superinstructions.
+ *
+ * Register code already folds local.get and local.set into the instructions around them.
+ * What a profiling run (see benchmarks/sequence_miner.cpp) still finds dispatched back to
+ * back is mostly a constant followed by the binary operation that consumes it, and an integer
+ * comparison followed by the conditional jump on its result. Those two kinds of pairs were
+ * picked by hand from the miner's report; the miner only counts, and a new kind of pair needs
+ * a rule in fuse_pair and handlers of its own. The Fuser merges each pair, repeatedly, so
+ * `i32.const; i32.lt_s; br_if` becomes one compare-and-branch.
+ *
+ * Only instructions whose result is a temporary operand slot consumed right away are fused,
+ * and never across an instruction a jump can land on, so the fused code leaves exactly the
+ * same values in the locals and in every live operand slot.
+ */
+class Fuser {
+public:
+    /**
+     * @brief Constructs a Fuser for a translated module.
+     * @param module The Module whose register code is fused.
+     */
+    explicit Fuser(Module& module);
+
+    /**
+     * @brief Fuses the register code of one function.
+     * @param frame The sizes of the function's frame.
+     * @param function_code The translated body, whose register code is replaced.
+     */
+    void fuse_function(const FrameLayout& frame, FunctionCode& function_code);
+
+private:
+    Module& module;
+};
+
+#endif //FUSER_H
@@ -0,0 +1,87 @@
+#include "InstancePool.h"
+#include <utility>
+
+InstancePool::InstancePool(std::shared_ptr<const CompiledModule> compiled_module, uint32_t capacity,
+                           const TieringPolicy& tiering_policy)
+    : InstancePool(std::move(compiled_module), nullptr, capacity, tiering_policy) {}
+
+InstancePool::InstancePool(std::shared_ptr<const Snapshot> snapshot, uint32_t capacity, const TieringPolicy& tiering_policy)
+    : InstancePool(snapshot->compiled_module, snapshot, capacity, tiering_policy) {}
+
+InstancePool::InstancePool(std::shared_ptr<const CompiledModule> compiled_module, std::shared_ptr<const Snapshot> snapshot,
+                           uint32_t capacity, const TieringPolicy& tiering_policy)
+    : compiled_module(std::move(compiled_module)), snapshot(std::move(snapshot)), tiering_policy(tiering_policy),
+      slot_count(capacity), slots(std::make_unique<Slot[]>(capacity)), free_head(NO_SLOT) {
+    // The stack starts out with every slot, slot 0 on top
+    for (uint32_t i = capacity; i-- > 0;) {
+        slots[i].instance = make_instance();
+        slots[i].next_free.store(static_cast<uint32_t>(free_head.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        free_head.store(make_head(i, free_head.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    }
+}
+
+InstancePool::Lease InstancePool::try_acquire() {
+    uint64_t head = free_head.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t slot = static_cast<uint32_t>(head);
+        if (slot == NO_SLOT) {
+            return {};
+        }
+        // The slot may be leased and given back meanwhile, which changes the tag and fails the exchange
+        uint32_t next = slots[slot].next_free.load(std::memory_order_relaxed);
+        if (free_head.compare_exchange_weak(head, make_head(next, head), std::memory_order_acquire,
+                                            std::memory_order_acquire)) {
+            return Lease(this, slot);
+        }
+    }
+}
+
+void InstancePool::give_back(uint32_t slot) noexcept {
+    Slot& returned = slots[slot];
+    try {
+        reset_instance(*returned.instance);
+    } catch (...) {
+        // An instance that cannot be reset is replaced, the pool keeps its capacity
+        try {
+            returned.instance = make_instance();
+        } catch (...) {
+            // Without an instance the slot stays off the free stack for good
+            returned.instance.reset();
+            retired_slots.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    // The release publishes the reset instance to the thread that leases it next
+    uint64_t head = free_head.load(std::memory_order_relaxed);
+    do {
+        returned.next_free.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+    } while (!free_head.compare_exchange_weak(head, make_head(slot, head), std::memory_order_release,
+                                              std::memory_order_relaxed));
+}
+
+std::unique_ptr<Interpreter> InstancePool::make_instance() const {
+    if (snapshot != nullptr) {
+        return std::make_unique<Interpreter>(snapshot, tiering_policy);
+    }
+    return std::make_unique<Interpreter>(compiled_module, tiering_policy);
+}
+
+void InstancePool::reset_instance(Interpreter& instance) const {
+    instance.reset();
+}
+
+InstancePool::Lease& InstancePool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool = std::exchange(other.pool, nullptr);
+        slot = other.slot;
+    }
+    return *this;
+}
+
+void InstancePool::Lease::release() noexcept {
+    if (pool != nullptr) {
+        std::exchange(pool, nullptr)->give_back(slot);
+    }
+}
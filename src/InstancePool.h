@@ -0,0 +1,133 @@
+#ifndef INSTANCE_POOL_H
+#define INSTANCE_POOL_H
+
+#include "CompiledModule.h"
+#include "Interpreter.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @class InstancePool
+ * @brief A fixed set of instances of one module, created up front and reused across requests.
+ *
+ * A request leases an instance, runs it and hands it back, which resets it (see
+ * Interpreter::reset) so the next lease finds it as if it were new. The expensive parts of
+ * instantiation, reserving memory and allocating the stacks, happen only when the pool is
+ * created.
+ *
+ * Leasing and returning are lock-free and can be done from any thread. The free instances
+ * form a stack linked through their slot indices, whose head carries a tag that changes on
+ * every update, so a thread whose view of the head is stale cannot swap in an outdated link.
+ *
+ * Returning an instance never throws, as it happens when a lease is destroyed. An instance
+ * whose reset fails is replaced by a new one, and if that fails as well, its slot is retired:
+ * the pool has one instance less from then on, which retired() reports.
+ */
+class InstancePool {
+public:
+    /**
+     * @class Lease
+     * @brief Exclusive use of one pooled instance, which goes back to the pool when the lease ends.
+     */
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept : pool(other.pool), slot(other.slot) { other.pool = nullptr; }
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease() { release(); }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        // False if the pool had no free instance
+        explicit operator bool() const { return pool != nullptr; }
+
+        Interpreter& operator*() const { return *pool->slots[slot].instance; }
+        Interpreter* operator->() const { return pool->slots[slot].instance.get(); }
+
+        /**
+         * @brief Resets the instance and returns it to the pool before the lease goes out of scope.
+         */
+        void release() noexcept;
+
+    private:
+        friend class InstancePool;
+        Lease(InstancePool* pool, uint32_t slot) : pool(pool), slot(slot) {}
+
+        InstancePool* pool = nullptr;
+        uint32_t slot = 0;
+    };
+
+    /**
+     * @param compiled_module The module to instantiate.
+     * @param capacity The number of instances, all created here.
+     * @param tiering_policy The tiering policy of every instance (only with WASM_JIT).
+     */
+    InstancePool(std::shared_ptr<const CompiledModule> compiled_module, uint32_t capacity,
+                 const TieringPolicy& tiering_policy = {});
+
+    /**
+     * @brief A pool of instances that start out in the state of a snapshot, and return to it on reset.
+     */
+    InstancePool(std::shared_ptr<const Snapshot> snapshot, uint32_t capacity, const TieringPolicy& tiering_policy = {});
+
+    virtual ~InstancePool() = default;
+
+    InstancePool(const InstancePool&) = delete;
+    InstancePool& operator=(const InstancePool&) = delete;
+
+    /**
+     * @brief Leases a free instance. Every lease must end before the pool is destroyed.
+     * @return The lease, or an empty one if all instances are leased.
+     */
+    Lease try_acquire();
+
+    uint32_t capacity() const { return slot_count; }
+
+    /**
+     * @brief The number of slots retired because their instance could neither be reset nor replaced.
+     */
+    uint32_t retired() const { return retired_slots.load(std::memory_order_relaxed); }
+
+protected:
+    /**
+     * @brief Creates an instance in the pool's initial state.
+     * @throws std::runtime_error if the instance cannot be created.
+     */
+    virtual std::unique_ptr<Interpreter> make_instance() const;
+
+    /**
+     * @brief Brings a returned instance back to the pool's initial state.
+     * @throws std::runtime_error if the instance cannot be reset.
+     */
+    virtual void reset_instance(Interpreter& instance) const;
+
+private:
+    struct Slot {
+        std::unique_ptr<Interpreter> instance;
+        std::atomic<uint32_t> next_free; // The slot below this one on the free stack
+    };
+
+    // The head of the free stack: a slot index in the low half and the tag in the high half
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    static uint64_t make_head(uint32_t slot, uint64_t previous_head) {
+        return ((previous_head >> 32) + 1) << 32 | slot;
+    }
+
+    std::shared_ptr<const CompiledModule> compiled_module;
+    std::shared_ptr<const Snapshot> snapshot; // Where the instances start, or nullptr for a fresh instantiation
+    TieringPolicy tiering_policy;
+    uint32_t slot_count;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<uint64_t> free_head;
+    std::atomic<uint32_t> retired_slots{0};
+
+    InstancePool(std::shared_ptr<const CompiledModule> compiled_module, std::shared_ptr<const Snapshot> snapshot,
+                 uint32_t capacity, const TieringPolicy& tiering_policy);
+
+    void give_back(uint32_t slot) noexcept;
+};
+
+#endif //INSTANCE_POOL_H
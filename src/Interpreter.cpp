@@ -1,547 +1,548 @@
 #include "Interpreter.h"
-#include "cross_platform.h"
+#include "Opcodes.h"
 #include <stdexcept>
-#include <iostream>
-#include <sstream>
-#include <iomanip>
-
-Interpreter::Interpreter(const Module& module) : module(module) {
-    // Allocate Memory
-    if (module.memory_initial_pages > 0) {
-        memory.resize(module.memory_initial_pages * PAGE_SIZE);
-    }
-
-    // Initialize Globals
-    for (const auto& global_def : module.globals) {
-        globals.push_back(global_def.initial_value);
-
+#include <utility>
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+
+#if WASM_THREADED_DISPATCH && !defined(__GNUC__)
+#error "WASM_THREADED_DISPATCH requires the labels-as-values extension of GCC or Clang"
+#endif
+
+#ifdef WASM_COUNT_INSTRUCTIONS
+#define INTERPRETER_COUNT_INSTRUCTION() (++executed_instructions)
+#else
+#define INTERPRETER_COUNT_INSTRUCTION() ((void)0)
+#endif
+
+#ifdef WASM_PROFILE_SEQUENCES
+#define INTERPRETER_PROFILE_SEQUENCE() record_sequence(instr)
+#else
+#define INTERPRETER_PROFILE_SEQUENCE() ((void)0)
+#endif
+
+/*
+ * The handlers in execute() are written once and compiled into one of two dispatch engines:
+ * a portable `switch` inside a loop, or direct threading with computed gotos, where every
+ * handler ends in its own indirect jump to the next handler. The latter gives the branch
+ * predictor one jump site per opcode instead of a single shared one.
+ */
+#if WASM_THREADED_DISPATCH
+// The opcodes whose handlers are written out one by one in execute(). Those of the numeric
+// opcodes and of the superinstructions are generated from the tables in Opcodes.h. A handler
+// missing from the dispatch table is an unused label, which fails the build.
+#pragma GCC diagnostic error "-Wunused-label"
+#define INTERPRETER_OPCODES(X)                                                                  \
+    X(0x00) X(0x0F) X(0x10) X(0x1B) X(0x23) X(0x24)                                             \
+    X(0x28) X(0x29) X(0x2A) X(0x2B) X(0x2C) X(0x2D) X(0x2E) X(0x2F) X(0x30) X(0x31) X(0x32)     \
+    X(0x33) X(0x34) X(0x35) X(0x36) X(0x37) X(0x38) X(0x39) X(0x3A) X(0x3B) X(0x3C) X(0x3D)     \
+    X(0x3E) X(0x3F) X(0x40) X(0x41) X(0x42) X(0x43) X(0x44)                                     \
+    X(REG_COPY) X(REG_JUMP) X(REG_JUMP_IF) X(REG_JUMP_UNLESS) X(REG_LOOP_JUMP) X(REG_LOOP_JUMP_IF) X(REG_BR_TABLE)
+
+// Every handler of execute() as INTERPRETER_DISPATCH_ENTRY(opcode, label), from the same lists
+// the handlers are generated from. INTERPRETER_DISPATCH_ENTRY is defined where the list is used.
+#define INTERPRETER_ENTRY(opcode) INTERPRETER_DISPATCH_ENTRY(opcode, handle_##opcode)
+#define INTERPRETER_NUMERIC_ENTRY(opcode, name, shape, Operand, Result, expression) \
+    INTERPRETER_DISPATCH_ENTRY(opcode, handle_##opcode)
+#define INTERPRETER_PREFIXED_NUMERIC_ENTRY(opcode, name, shape, Operand, Result, expression) \
+    INTERPRETER_DISPATCH_ENTRY(PREFIX_FC + opcode, handle_fc_##opcode)
+#define INTERPRETER_WITH_IMMEDIATE_ENTRY_unary(opcode)
+#define INTERPRETER_WITH_IMMEDIATE_ENTRY_binary(opcode) \
+    INTERPRETER_DISPATCH_ENTRY(REG_WITH_IMMEDIATE + opcode, handle_imm_##opcode)
+#define INTERPRETER_WITH_IMMEDIATE_ENTRY(opcode, name, shape, Operand, Result, expression) \
+    INTERPRETER_WITH_IMMEDIATE_ENTRY_##shape(opcode)
+#define INTERPRETER_COMPARE_JUMP_ENTRY(opcode, name, negated_opcode)                        \
+    INTERPRETER_DISPATCH_ENTRY(REG_COMPARE_JUMP + opcode, handle_compare_jump_##opcode)     \
+    INTERPRETER_DISPATCH_ENTRY(REG_COMPARE_IMMEDIATE_JUMP + opcode, handle_compare_imm_jump_##opcode)
+#define INTERPRETER_DISPATCH_ENTRIES                                                        \
+    INTERPRETER_OPCODES(INTERPRETER_ENTRY)                                                  \
+    WASM_NUMERIC_OPCODES(INTERPRETER_NUMERIC_ENTRY)                                         \
+    WASM_PREFIXED_NUMERIC_OPCODES(INTERPRETER_PREFIXED_NUMERIC_ENTRY)                       \
+    WASM_NUMERIC_OPCODES(INTERPRETER_WITH_IMMEDIATE_ENTRY)                                  \
+    WASM_INTEGER_COMPARE_OPCODES(INTERPRETER_COMPARE_JUMP_ENTRY)
+
+#define INTERPRETER_DISPATCH_ENTRY(opcode, label) opcode,
+static constexpr uint16_t DISPATCHED_OPCODES[] = {INTERPRETER_DISPATCH_ENTRIES};
+#undef INTERPRETER_DISPATCH_ENTRY
+
+// The compare-and-branch superinstructions with an immediate are the last range of opcodes
+static constexpr size_t DISPATCH_TABLE_SIZE = REG_COMPARE_IMMEDIATE_JUMP + 0x80;
+static_assert(std::ranges::max(DISPATCHED_OPCODES) < DISPATCH_TABLE_SIZE, "A handler's opcode is past the dispatch table");
+
+using DispatchTable = std::array<void*, DISPATCH_TABLE_SIZE>;
+
+// A table in which every opcode without a handler of its own goes to the default one
+static DispatchTable make_dispatch_table(void* default_handler, std::initializer_list<std::pair<uint16_t, void*>> handlers) {
+    DispatchTable dispatch_table;
+    dispatch_table.fill(default_handler);
+    for (auto [opcode, handler] : handlers) {
+        dispatch_table[opcode] = handler;
     }
+    return dispatch_table;
 }
 
-void Interpreter::invoke(uint32_t function_index) {
-    if (function_index >= module.functions.size()) {
-        throw std::runtime_error("Function index out of bounds");
+#define INTERPRETER_CASE(opcode) handle_##opcode:
+#define INTERPRETER_CASE_FC(opcode) handle_fc_##opcode:
+#define INTERPRETER_CASE_WITH_IMMEDIATE(opcode) handle_imm_##opcode:
+#define INTERPRETER_CASE_COMPARE_JUMP(opcode) handle_compare_jump_##opcode:
+#define INTERPRETER_CASE_COMPARE_IMMEDIATE_JUMP(opcode) handle_compare_imm_jump_##opcode:
+#define INTERPRETER_DEFAULT handle_default:
+#define INTERPRETER_NEXT()                                                        \
+    do {                                                                          \
+        instr = ip++;                                                             \
+        INTERPRETER_COUNT_INSTRUCTION();                                          \
+        INTERPRETER_PROFILE_SEQUENCE();                                           \
+        goto *dispatch_table[instr->opcode];                                      \
+    } while (0)
+#else
+#define INTERPRETER_CASE(opcode) case opcode:
+#define INTERPRETER_CASE_FC(opcode) case PREFIX_FC + opcode:
+#define INTERPRETER_CASE_WITH_IMMEDIATE(opcode) case REG_WITH_IMMEDIATE + opcode:
+#define INTERPRETER_CASE_COMPARE_JUMP(opcode) case REG_COMPARE_JUMP + opcode:
+#define INTERPRETER_CASE_COMPARE_IMMEDIATE_JUMP(opcode) case REG_COMPARE_IMMEDIATE_JUMP + opcode:
+#define INTERPRETER_DEFAULT default:
+#define INTERPRETER_NEXT() break
+#endif
+
+/*
+ * The state of the running frame lives in local variables, which the compiler keeps in
+ * registers across dispatches: `regs` is the frame's first slot, `code` its register code and
+ * `ip` the next instruction. The frame's `pc` in the call stack is only written when the
+ * frame is left for a call, and read back when it resumes.
+ */
+#define INTERPRETER_LOAD_FRAME()                                                  \
+    frame = &call_stack.back();                                                   \
+    regs = &stack[frame->locals_base];                                            \
+    code = frame->code;                                                           \
+    ip = code + frame->pc
+
+#define INTERPRETER_JUMP(target) (ip = code + (target))
+
+// Every trap leaves the loop through `trap_exit`, the only exit besides the return of the
+// frame execute() was entered with. Used as a statement around an expression of type TrapCode.
+#define INTERPRETER_CHECK(...)                                                    \
+    if ((trap = (__VA_ARGS__)) != TRAP_NONE) goto trap_exit
+
+#define INTERPRETER_TRAP(code)                                                    \
+    do {                                                                          \
+        trap = (code);                                                            \
+        goto trap_exit;                                                           \
+    } while (0)
+
+// Used after instructions that may push or pop call frames: reloads the current frame and
+// leaves execute() once the frame it was entered with has returned.
+#define INTERPRETER_NEXT_FRAME()                                                  \
+    if (call_stack.size() == entry_depth) return TRAP_NONE;                       \
+    INTERPRETER_LOAD_FRAME();                                                     \
+    INTERPRETER_NEXT()
+
+// Used after jumps back to a loop header. A hot loop carries on in compiled code, which then
+// finishes the whole call.
+#if WASM_JIT
+#define INTERPRETER_NEXT_BACK_EDGE()                                              \
+    if (JitCode compiled = compiled_loop(instr->b)) {                             \
+        INTERPRETER_CHECK(run_compiled(compiled));                                \
+        INTERPRETER_NEXT_FRAME();                                                 \
+    }                                                                             \
+    INTERPRETER_NEXT()
+#else
+#define INTERPRETER_NEXT_BACK_EDGE() INTERPRETER_NEXT()
+#endif
+
+Interpreter::Interpreter(std::shared_ptr<const CompiledModule> compiled_module, const TieringPolicy& tiering_policy)
+    : Interpreter(std::move(compiled_module), nullptr, tiering_policy) {}
+
+Interpreter::Interpreter(std::shared_ptr<const Snapshot> snapshot, const TieringPolicy& tiering_policy)
+    : Interpreter(snapshot->compiled_module, snapshot, tiering_policy) {}
+
+Interpreter::Interpreter(std::shared_ptr<const CompiledModule> compiled_module, std::shared_ptr<const Snapshot> origin,
+                         const TieringPolicy& tiering_policy)
+    : compiled_module(std::move(compiled_module)), module(this->compiled_module->module()), origin(std::move(origin)),
+      stack(VALUE_STACK_SIZE),
+      memory(this->origin != nullptr
+                 ? LinearMemory(this->origin->memory, module.has_memory ? module.memory_max_pages : 0)
+             : this->compiled_module->memory_image() != nullptr
+                 ? LinearMemory(this->compiled_module->memory_image(), module.memory_max_pages)
+                 : LinearMemory(module.memory_initial_pages, module.has_memory ? module.memory_max_pages : 0)),
+      globals(this->origin != nullptr ? this->origin->globals : this->compiled_module->initial_globals())
+#if WASM_JIT
+    , tiering(*this->compiled_module, tiering_policy)
+#endif
+{
+    if (this->origin == nullptr) {
+        this->compiled_module->copy_data_segments(memory);
     }
 
-    std::cout << "Invoking function with index " << function_index << std::endl;
+    // Calls never allocate: the frames and their locals live in storage reserved up front
+    call_stack.reserve(MAX_CALL_DEPTH);
 
-    const Function& func = module.functions.at(function_index);
-    const FunctionType& type = module.types.at(func.type_index);
+#if WASM_GUARD_PAGE_MEMORY
+    execute_variant = memory.checks_bounds() ? &Interpreter::execute_with<false> : &Interpreter::execute_with<true>;
+#endif
 
-    // Create the first stack frame
-    StackFrame frame;
-    frame.func = &func;
-    frame.pc = 0;
-    frame.locals = std::vector<Value>(type.params.size() + func.locals.size());
-    frame.control_stack_base = 0;
-
-    // Pop arguments from the stack and place them in the frame
-    for (int i = type.params.size() - 1; i >= 0; --i) {
-        frame.locals[i] = stack.back();
-        stack.pop_back();
-    }
-
-    call_stack.push_back(frame);
-    execute();
+#if WASM_JIT
+    jit_context = JitContext{this, globals.data(), memory.data(), memory.size(), &jit_exception};
+#else
+    (void)tiering_policy;
+#endif
 }
 
-void Interpreter::execute() {
-    while (!call_stack.empty()) {
-        StackFrame& frame = call_stack.back();
-        const Function& func = *frame.func;
-        size_t& pc = frame.pc;
-
-        if (pc >= func.code.size()) {
-            // Reached the end of the function naturally
-            control_stack.resize(frame.control_stack_base); // We restore the size of the control stack
-            call_stack.pop_back();
-            continue;
-        }
-
-        uint8_t opcode = func.code[pc++];
-
-        switch (opcode) {
-            // === CONTROL FLOW ===
-            case 0x00: // unreachable
-            case 0x01: // noop
-                break;
-            case 0x02: // block
-            case 0x03: { op_loop(func, pc, opcode); } break; // loop
-            case 0x04: { op_if(func, pc, opcode); } break; // if
-            // If we encounter an 'else' opcode, it's because the 'if' condition was TRUE and we can skip it.
-            case 0x05: { pc = control_stack.back().end; } break; // else
-            case 0x0C: { perform_branch(decode_leb128_u<uint32_t>(func.code, pc)); } break; // br
-            case 0x0A:
-                break;
-            case 0x0B: { op_end(pc); } break; // end
-            case 0x0D: { op_br_if(func, pc); } break; // br_if
-            case 0x0F: { op_return(); } break; // return
-            case 0x10: { op_function_call(func, pc); } break; // call
-            case 0x1A: { stack.pop_back(); } break; // drop;
-            case 0x1B: { op_select(); } break; // select
-
-            // === GLOBALS ===
-            case 0x20: { // local.get
-                uint32_t index = decode_leb128_u<uint32_t>(func.code, pc);
-                const Value& value = frame.locals.at(index);
-                stack.push_back(value);
-                break;
-            }
-            case 0x21: { // local.set
-                uint32_t index = decode_leb128_u<uint32_t>(func.code, pc);
-                const Value& value = stack.back();
-                stack.pop_back();
-                frame.locals.at(index) = value;
-                break;
-            }
-            case 0x22: { // local.tee
-                uint32_t index = decode_leb128_u<uint32_t>(func.code, pc);
-                const Value& value = stack.back();
-                frame.locals.at(index) = value;
-                break;
-            }
-            case 0x23: { // global.set
-                uint32_t index = decode_leb128_u<uint32_t>(func.code, pc);
-                const Value& value = globals.at(index);
-                stack.push_back(value);
-                break;
-            }
-            case 0x24: { // global.get
-                uint32_t index = decode_leb128_u<uint32_t>(func.code, pc);
-                globals.at(index) = stack.back();
-                stack.pop_back();
-                break;
-            }
-
-            // === LOAD ===
-            case 0x28: { int32_t a = pop<int32_t>(); push<int32_t>(load<int32_t>(a)); break; }   // i32.load
-            case 0x29: { int32_t a = pop<int32_t>(); push<int64_t>(load<int64_t>(a)); break; }   // i64.load
-            case 0x2A: { int32_t a = pop<int32_t>(); push<float>(load<float>(a)); break; }       // f32.load
-            case 0x2B: { int32_t a = pop<int32_t>(); push<double>(load<double>(a)); break; }     // f64.load
-            case 0x2C: { int32_t a = pop<int32_t>(); push<int32_t>(static_cast<int32_t>(load<int8_t>(a))); break; }    // i32.load8_s
-            case 0x2D: { int32_t a = pop<int32_t>(); push<int32_t>(static_cast<int32_t>(load<uint8_t>(a))); break; }   // i32.load8_u
-            case 0x2E: { int32_t a = pop<int32_t>(); push<int32_t>(static_cast<int32_t>(load<int16_t>(a))); break; }  // i32.load16_s
-            case 0x2F: { int32_t a = pop<int32_t>(); push<int32_t>(static_cast<int32_t>(load<uint16_t>(a))); break; } // i32.load16_u
-            case 0x30: { int32_t a = pop<int32_t>(); push<int64_t>(static_cast<int64_t>(load<int8_t>(a))); break; }    // i64.load8_s
-            case 0x31: { int32_t a = pop<int32_t>(); push<int64_t>(static_cast<int64_t>(load<uint8_t>(a))); break; }   // i64.load8_u
-            case 0x32: { int32_t a = pop<int32_t>(); push<int64_t>(static_cast<int64_t>(load<int16_t>(a))); break; }  // i64.load16_s
-            case 0x33: { int32_t a = pop<int32_t>(); push<int64_t>(static_cast<int64_t>(load<uint16_t>(a))); break; } // i64.load16_u
-            case 0x34: { int32_t a = pop<int32_t>(); push<int64_t>(static_cast<int64_t>(load<int32_t>(a))); break; }   // i64.load32_s
-            case 0x35: { int32_t a = pop<int32_t>(); push<int64_t>(static_cast<int64_t>(load<uint32_t>(a))); break; }  // i64.load32_u
-
-            // === STORE ===
-            case 0x36: { int32_t v = pop<int32_t>(); int32_t a = pop<int32_t>(); store<int32_t>(a, v); break; }     // i32.store
-            case 0x37: { int64_t v = pop<int64_t>(); int32_t a = pop<int32_t>(); store<int64_t>(a, v); break; }     // i64.store
-            case 0x38: { float   v = pop<float>();   int32_t a = pop<int32_t>(); store<float>(a, v); break; }       // f32.store
-            case 0x39: { double  v = pop<double>();  int32_t a = pop<int32_t>(); store<double>(a, v); break; }      // f64.store
-            case 0x3A: { int32_t v = pop<int32_t>(); int32_t a = pop<int32_t>(); store<int8_t>(a, static_cast<int8_t>(v)); break; }    // i32.store8
-            case 0x3B: { int32_t v = pop<int32_t>(); int32_t a = pop<int32_t>(); store<int16_t>(a, static_cast<int16_t>(v)); break; }   // i32.store16
-            case 0x3C: { int64_t v = pop<int64_t>(); int32_t a = pop<int32_t>(); store<int32_t>(a, static_cast<int32_t>(v)); break; }   // i64.store32
-            case 0x3D: { int64_t v = pop<int64_t>(); int32_t a = pop<int32_t>(); store<int8_t>(a, static_cast<int8_t>(v)); break; }    // i64.store8
-            case 0x3E: { int64_t v = pop<int64_t>(); int32_t a = pop<int32_t>(); store<int16_t>(a, static_cast<int16_t>(v)); break; }   // i64.store16
-
-            // === MEMORY ===
-            case 0x3F: { op_mem_size(func, pc); } break; // memory.size
-            case 0x40: { op_grow(func, pc); } break; // grow
-
-
-            // === IMMEDIATES ===
-
-            case 0x41: { // i32.const
-                int32_t value = decode_leb128_s<int32_t>(func.code, pc);
-                push<int32_t>(value);
-                break;
-            }
-
-            case 0x42: { // i64.const
-                int64_t value = decode_leb128_s<uint64_t>(func.code, pc);
-                push<int64_t>(value);
-                break;
-            }
-
-            case 0x43: { // f32.const
-                float value = read_immediate<float>(func.code, pc);
-                push<float>(value);
-                break;
-            }
-            case 0x44: { // f64.const
-                double value = read_immediate<double>(func.code, pc);
-                push<double>(value);
-                break;
-            }
-
-            // === COMPARISON ===
-            case 0x45: push<int32_t>(pop<int32_t>() == 0); break; // i32.eqz
-            case 0x46: execute_comparison_op<int32_t>([](int32_t a, int32_t b) { return a == b; }); break; // i32.eq
-            case 0x47: execute_comparison_op<int32_t>([](int32_t a, int32_t b) { return a != b; }); break; // i32.ne
-            case 0x48: execute_comparison_op<int32_t>([](int32_t a, int32_t b) { return a < b; }); break; // i32.lt_s
-            case 0x49: execute_comparison_op<int32_t>([](int32_t a, int32_t b) { return static_cast<uint32_t>(a) < static_cast<uint32_t>(b); }); break; // i32.lt_u
-            case 0x4A: execute_comparison_op<int32_t>([](int32_t a, int32_t b) { return a > b; }); break; // i32.gt_s
-            case 0x4B: execute_comparison_op<int32_t>([](int32_t a, int32_t b) { return static_cast<uint32_t>(a) > static_cast<uint32_t>(b); }); break; // i32.gt_u
-            case 0x4C: execute_comparison_op<int32_t>([](int32_t a, int32_t b) { return a <= b; }); break; // i32.le_s
-            case 0x4D: execute_comparison_op<int32_t>([](int32_t a, int32_t b) { return static_cast<uint32_t>(a) <= static_cast<uint32_t>(b); }); break; // i32.le_u
-            case 0x4E: execute_comparison_op<int32_t>([](int32_t a, int32_t b) { return a >= b; }); break; // i32.ge_s
-            case 0x4F: execute_comparison_op<int32_t>([](int32_t a, int32_t b) { return static_cast<uint32_t>(a) >= static_cast<uint32_t>(b); }); break; // i32.ge_u
-
-            case 0x50: push<int32_t>(pop<int64_t>() == 0); break; // i64.eqz
-            case 0x51: execute_comparison_op<int64_t>([](int64_t a, int64_t b) { return a == b; }); break; // i64.eq
-            case 0x52: execute_comparison_op<int64_t>([](int64_t a, int64_t b) { return a != b; }); break; // i64.ne
-            case 0x53: execute_comparison_op<int64_t>([](int64_t a, int64_t b) { return a < b; }); break; // i64.lt_s
-            case 0x54: execute_comparison_op<int64_t>([](int64_t a, int64_t b) { return static_cast<uint64_t>(a) < static_cast<uint64_t>(b); }); break; // i64.lt_u
-            case 0x55: execute_comparison_op<int64_t>([](int64_t a, int64_t b) { return a > b; }); break; // i64.gt_s
-            case 0x56: execute_comparison_op<int64_t>([](int64_t a, int64_t b) { return static_cast<uint64_t>(a) > static_cast<uint64_t>(b); }); break; // i64.gt_u
-            case 0x57: execute_comparison_op<int64_t>([](int64_t a, int64_t b) { return a <= b; }); break; // i64.le_s
-            case 0x58: execute_comparison_op<int64_t>([](int64_t a, int64_t b) { return static_cast<uint64_t>(a) <= static_cast<uint64_t>(b); }); break; // i64.le_u
-            case 0x59: execute_comparison_op<int64_t>([](int64_t a, int64_t b) { return a >= b; }); break; // i64.ge_s
-            case 0x5A: execute_comparison_op<int64_t>([](int64_t a, int64_t b) { return static_cast<uint64_t>(a) >= static_cast<uint64_t>(b); }); break; // i64.ge_u
-
-            case 0x5B: execute_comparison_op<float>([](float a, float b) { return a == b; }); break; // f32.eq
-            case 0x5C: execute_comparison_op<float>([](float a, float b) { return a != b; }); break; // f32.ne
-            case 0x5D: execute_comparison_op<float>([](float a, float b) { return a < b; }); break;  // f32.lt
-            case 0x5E: execute_comparison_op<float>([](float a, float b) { return a > b; }); break;  // f32.gt
-            case 0x5F: execute_comparison_op<float>([](float a, float b) { return a <= b; }); break; // f32.le
-            case 0x60: execute_comparison_op<float>([](float a, float b) { return a >= b; }); break; // f32.ge
-
-            case 0x61: execute_comparison_op<double>([](double a, double b) { return a == b; }); break; // f64.eq
-            case 0x62: execute_comparison_op<double>([](double a, double b) { return a != b; }); break; // f64.ne
-            case 0x63: execute_comparison_op<double>([](double a, double b) { return a < b; }); break; // f64.lt
-            case 0x64: execute_comparison_op<double>([](double a, double b) { return a > b; }); break; // f64.gt
-            case 0x65: execute_comparison_op<double>([](double a, double b) { return a <= b; }); break; // f64.le
-            case 0x66: execute_comparison_op<double>([](double a, double b) { return a >= b; }); break; // f64.ge
-
-            // === ARITHMETIC ===
-            case 0x67: execute_unary_op<int32_t>([](int32_t a) { return a ? clz32(a) : 32; }); break; // i32.clz
-            case 0x68: execute_unary_op<int32_t>([](int32_t a) { return a ? ctz32(a) : 32; }); break; // i32.ctz
-            case 0x69: execute_unary_op<int32_t>([](int32_t a) { return std::popcount(static_cast<uint32_t>(a)); }); break; // i32.popcnt
-            case 0x6A: execute_binary_op<int32_t>([](int32_t a, int32_t b) { return a + b; }); break; // i32.add
-            case 0x6B: execute_binary_op<int32_t>([](int32_t a, int32_t b) { return a - b; }); break; // i32.sub
-            case 0x6C: execute_binary_op<int32_t>([](int32_t a, int32_t b) { return a * b; }); break; // i32.mul
-            case 0x71: execute_binary_op<int32_t>([](int32_t a, int32_t b) { return a & b; }); break; // i32.and
-            case 0x72: execute_binary_op<int32_t>([](int32_t a, int32_t b) { return a | b; }); break; // i32.or
-            case 0x73: execute_binary_op<int32_t>([](int32_t a, int32_t b) { return a ^ b; }); break; // i32.xor
-            case 0x74: execute_binary_op<int32_t>([](int32_t a, int32_t b) { return a << b; }); break; // i32.shl
-            case 0x75: execute_binary_op<int32_t>([](int32_t a, int32_t b) { return a >> b; }); break; // i32.shr_s
-            case 0x76: execute_binary_op<int32_t>([](int32_t a, int32_t b) { return a >> b; }); break; // i32.shr_u // Todo
-            case 0x77: execute_binary_op<int32_t>([](int32_t a, int32_t b) { return std::rotl(static_cast<uint32_t>(a), b); }); break; // i32.rotl
-            case 0x78: execute_binary_op<int32_t>([](int32_t a, int32_t b) { return std::rotr(static_cast<uint32_t>(a), b); }); break; // i32.rotr
-
-            case 0x79: execute_unary_op<int64_t>([](int64_t a) { return a ? clz64(a) : 64; }); break; // i64.clz
-            case 0x7A: execute_unary_op<int64_t>([](int64_t a) { return a ? ctz64(a) : 64; }); break; // i64.ctz
-            case 0x7B: execute_unary_op<int64_t>([](int64_t a) { return std::popcount(static_cast<uint64_t>(a)); }); break; // i64.popcnt
-            case 0x7C: execute_binary_op<int64_t>([](int64_t a, int64_t b) { return a + b; }); break; // i64.add
-            case 0x7D: execute_binary_op<int64_t>([](int64_t a, int64_t b) { return a - b; }); break; // i64.sub
-            case 0x7E: execute_binary_op<int64_t>([](int64_t a, int64_t b) { return a * b; }); break; // i64.mul
-
-            case 0x83: execute_binary_op<int64_t>([](int64_t a, int64_t b) { return a & b; }); break; // i64.and
-            case 0x84: execute_binary_op<int64_t>([](int64_t a, int64_t b) { return a | b; }); break; // i64.or
-            case 0x85: execute_binary_op<int64_t>([](int64_t a, int64_t b) { return a ^ b; }); break; // i64.xor
-            case 0x86: execute_binary_op<int64_t>([](int64_t a, int64_t b) { return a << b; }); break; // i64.shl
-            case 0x87: execute_binary_op<int64_t>([](int64_t a, int64_t b) { return a >> b; }); break; // i64.shr_s
-            case 0x88: execute_binary_op<int64_t>([](int64_t a, int64_t b) { return a >> b; }); break; // i64.shr_u
-            case 0x89: execute_binary_op<int64_t>([](int64_t a, int64_t b) { return std::rotl(static_cast<uint64_t>(a), b); }); break; // i64.rotl
-            case 0x8A: execute_binary_op<int64_t>([](int64_t a, int64_t b) { return std::rotr(static_cast<uint64_t>(a), b); }); break; // i64.rotr
-
-            case 0x8B: execute_unary_op<float>([](float a) { return std::abs(a); }); break; // f32.abs
-            case 0x8C: execute_unary_op<float>([](float a) { return -a; }); break; // f32.neg
-            case 0x8D: execute_unary_op<float>([](float a) { return std::ceil(a); }); break; // f32.ceil
-            case 0x8E: execute_unary_op<float>([](float a) { return std::floor(a); }); break; // f32.floor
-            case 0x8F: execute_unary_op<float>([](float a) { return std::trunc(a); }); break; // f32.trunc
-            case 0x90: execute_unary_op<float>([](float a) { return std::nearbyint(a); }); break; // f32.nearest
-            case 0x91: execute_unary_op<float>([](float a) { return std::sqrt(a); }); break; // f32.sqrt
-            case 0x92: execute_binary_op<float>([](float a, float b) { return a + b; }); break; // f32.add
-            case 0x93: execute_binary_op<float>([](float a, float b) { return a - b; }); break; // f32.sub
-            case 0x94: execute_binary_op<float>([](float a, float b) { return a * b; }); break; // f32.mul
-            case 0x95: execute_binary_op<float>([](float a, float b) { return a / b; }); break; // f32.div // Todo
-            case 0x96: execute_binary_op<float>([](float a, float b) { return std::min(a, b); }); break; // f32.min
-            case 0x97: execute_binary_op<float>([](float a, float b) { return std::max(a, b); }); break; // f32.max
-            case 0x98: execute_binary_op<float>([](float a, float b) { return std::copysign(a, b);}); break; // f32.copysign
-            case 0x99: execute_unary_op<double>([](double a) { return std::abs(a); }); break; // f64.abs
-            case 0x9A: execute_unary_op<double>([](double a) { return -a; }); break; // f64.neg
-            case 0x9B: execute_unary_op<double>([](double a) { return std::ceil(a); }); break; // f64.ceil
-            case 0x9C: execute_unary_op<double>([](double a) { return std::floor(a); }); break; // f64.floor
-            case 0x9D: execute_unary_op<double>([](double a) { return std::trunc(a); }); break; // f64.trunc
-            case 0x9E: execute_unary_op<double>([](double a) { return std::nearbyint(a); }); break; // f64.nearest
-            case 0x9F: execute_unary_op<double>([](double a) { return std::sqrt(a); }); break; // f64.sqrt
-
-            case 0xA0: execute_binary_op<double>([](double a, double b) { return a + b; }); break; // f64.add
-            case 0xA1: execute_binary_op<double>([](double a, double b) { return a - b; }); break; // f64.sub
-            case 0xA2: execute_binary_op<double>([](double a, double b) { return a * b; }); break; // f64.mul
-            case 0xA3: execute_binary_op<double>([](double a, double b) { return a / b; }); break; // f64.div // Todo
-            case 0xA4: execute_binary_op<double>([](double a, double b) { return std::min(a, b); }); break; // f64.min
-            case 0xA5: execute_binary_op<double>([](double a, double b) { return std::max(a, b); }); break; // f64.max
-            case 0xA6: execute_binary_op<double>([](double a, double b) { return std::copysign(a, b); }); break; // f64.copysign
-
-            // === Conversion ===
-            case 0xA7: execute_conversion_op<int32_t, int64_t>([](int64_t a) { return static_cast<int32_t>(a); }); break; // 32.wrap_i64
-            case 0xA8: execute_conversion_op<int32_t, float>([](float a) { return static_cast<int32_t>(a); }); break; // i32.trunc_f32_s
-            case 0xA9: execute_conversion_op<int32_t, float>([](float a) { return static_cast<uint32_t>(a); }); break; // i32.trunc_f32_u
-            case 0xAA: execute_conversion_op<int32_t, double>([](double a) { return static_cast<int32_t>(a); }); break; // i32.trunc_f64_s
-            case 0xAB: execute_conversion_op<int32_t, double>([](double a) { return static_cast<uint32_t>(a); }); break; // i32.trunc_f64_u
-            case 0xAC: execute_conversion_op<int64_t, int32_t>([](int32_t a) { return static_cast<int64_t>(a); }); break; // i64.extend_i32_s
-            case 0xAD: execute_conversion_op<int64_t, int32_t>([](int32_t a) { return static_cast<uint32_t>(a); }); break; // i64.extend_i32_u
-            case 0xAE: execute_conversion_op<int64_t, float>([](float a) { return static_cast<int64_t>(a); }); break; // i64.trunc_f32_s
-            case 0xAF: execute_conversion_op<int64_t, float>([](float a) { return static_cast<uint64_t>(a); }); break; // i64.trunc_f32_u
-            case 0xB0: execute_conversion_op<int64_t, double>([](double a) { return static_cast<int64_t>(a); }); break; // i64.trunc_f64_s
-            case 0xB1: execute_conversion_op<int64_t, double>([](double a) { return static_cast<uint64_t>(a); }); break; // i64.trunc_f64_u
-            case 0xB2: execute_conversion_op<float, int32_t>([](int32_t a) { return static_cast<float>(a); }); break; // f32.convert_i32_s
-            case 0xB3: execute_conversion_op<float, int32_t>([](int32_t a) { return static_cast<float>(static_cast<uint32_t>(a)); }); break; // f32.convert_i32_u
-            case 0xB4: execute_conversion_op<double, int32_t>([](int32_t a) { return static_cast<double>(a); }); break; // f64.convert_i32_s
-            case 0xB5: execute_conversion_op<double, int32_t>([](int32_t a) { return static_cast<double>(static_cast<uint32_t>(a)); }); break; // f64.convert_i32_u
-            case 0xB6: execute_conversion_op<float, double>([](double a) { return static_cast<float>(a); }); break; // f32.demote_f64
-            case 0xB7: execute_conversion_op<double, int32_t>([](int32_t a) { return static_cast<double>(a); }); break; // f64.convert_i32_s
-            case 0xB8: execute_conversion_op<double, int32_t>([](int32_t a) { return static_cast<double>(static_cast<uint32_t>(a)); }); break; // f64.convert_i32_u
-            case 0xB9: execute_conversion_op<double, int32_t>([](int64_t a) { return static_cast<double>(a); }); break; // f64.convert_i64_s
-            case 0xBA: execute_conversion_op<double, int32_t>([](int64_t a) { return static_cast<double>(static_cast<uint64_t>(a)); }); break; // f64.convert_i64_u
-            case 0xBB: execute_conversion_op<double, float>([](float a) { return static_cast<double>(a); }); break; // f64.promote_f32
-            case 0xBC: execute_reinterpret_op<int32_t, float>(); break;   // i32.reinterpret_f32
-            case 0xBD: execute_reinterpret_op<int64_t, double>(); break;  // i64.reinterpret_f64
-            case 0xBE: execute_reinterpret_op<float, int32_t>(); break;   // f32.reinterpret_i32
-            case 0xBF: execute_reinterpret_op<double, int64_t>(); break;  // f64.reinterpret_i64
-
-            // === ARITHMETIC WITH EDGE CASES ===
-            case 0x6D: { // i32.div_s
-                int32_t b = pop<int32_t>();
-                int32_t a = pop<int32_t>();
-                if (b == 0) throw std::runtime_error("integer divide by zero");
-                if (a == INT32_MIN && b == -1) throw std::runtime_error("integer overflow");
-                push<int32_t>(a / b);
-                break;
-            }
-            case 0x6E: { // i32.div_u
-                uint32_t b = static_cast<uint32_t>(pop<int32_t>());
-                uint32_t a = static_cast<uint32_t>(pop<int32_t>());
-                if (b == 0) throw std::runtime_error("integer divide by zero");
-                push<int32_t>(static_cast<int32_t>(a / b));
-                break;
-            }
-            case 0x6F: { // i32.rem_s
-                int32_t b = pop<int32_t>();
-                int32_t a = pop<int32_t>();
-                if (b == 0) throw std::runtime_error("integer divide by zero");
-                push<int32_t>(a % b);
-                break;
-            }
-            case 0x70: { // i32.rem_u
-                uint32_t b = static_cast<uint32_t>(pop<int32_t>());
-                uint32_t a = static_cast<uint32_t>(pop<int32_t>());
-                if (b == 0) throw std::runtime_error("integer divide by zero");
-                push<int32_t>(static_cast<int32_t>(a % b));
-                break;
-            }
-
-            case 0x7F: { // i64.div_s
-                int64_t b = pop<int64_t>();
-                int64_t a = pop<int64_t>();
-                if (b == 0) throw std::runtime_error("integer divide by zero");
-                if (a == INT64_MIN && b == -1) throw std::runtime_error("integer overflow");
-                push<int64_t>(a / b);
-                break;
-            }
-            case 0x80: { // i64.div_u
-                uint64_t b = static_cast<uint64_t>(pop<int64_t>());
-                uint64_t a = static_cast<uint64_t>(pop<int64_t>());
-                if (b == 0) throw std::runtime_error("integer divide by zero");
-                push<int64_t>(static_cast<int64_t>(a / b));
-                break;
-            }
-            case 0x81: { // i64.rem_s
-                int64_t b = pop<int64_t>();
-                int64_t a = pop<int64_t>();
-                if (b == 0) throw std::runtime_error("integer divide by zero");
-                push<int64_t>(a % b);
-                break;
-            }
-            case 0x82: { // i64.rem_u
-                uint64_t b = static_cast<uint64_t>(pop<int64_t>());
-                uint64_t a = static_cast<uint64_t>(pop<int64_t>());
-                if (b == 0) throw std::runtime_error("integer divide by zero");
-                push<int64_t>(static_cast<int64_t>(a % b));
-                break;
-            }
-
-            default:
-                std::stringstream error_stream;
-                error_stream << "Unknown or unimplemented opcode: 0x"
-                         << std::hex << std::uppercase << std::setw(2) << std::setfill('0')
-                         << (int)opcode;
-                throw std::runtime_error(error_stream.str());
-        }
+std::shared_ptr<const Snapshot> Interpreter::snapshot() const {
+    return std::make_shared<const Snapshot>(Snapshot{compiled_module, std::make_shared<const MemoryImage>(memory), globals});
+}
 
+void Interpreter::reset() {
+    memory.reset();
+    if (origin == nullptr) {
+        compiled_module->copy_data_segments(memory);
     }
+    const std::vector<Value>& initial_globals = origin != nullptr ? origin->globals : compiled_module->initial_globals();
+    std::copy(initial_globals.begin(), initial_globals.end(), globals.begin());
+    call_stack.clear();
+    sp = 0;
+    invoke_result = InvokeResult{};
+#if WASM_JIT
+    jit_context.memory_base = memory.data();
+    jit_context.memory_size = memory.size();
+    jit_exception = nullptr;
+#endif
 }
 
-std::pair<size_t, size_t> Interpreter::scan_block_body(size_t start_pc, const std::vector<uint8_t>& code) {
-    int nesting_level = 1;
-    size_t pc = start_pc;
-    size_t else_pc = 0; // Will remain 0 if no 'else' is found
-
-    while (pc < code.size() && nesting_level > 0) {
-        uint8_t opcode = code[pc++];
-        switch (opcode) {
-            case 0x02: // block
-            case 0x03: // loop
-            case 0x04: // if
-                pc = scan_block_body(pc, code).second;
-            break;
-            case 0x05: // else
-                // Found an 'else' that belongs to our current block.
-                if (nesting_level == 1) {
-                    else_pc = pc;
-                }
-            break;
-            case 0x0B: // end
-                nesting_level--;
-            break;
+InvokeResult Interpreter::invoke(uint32_t function_index) {
+    if (function_index >= module.functions.size()) {
+        throw std::runtime_error("Function index out of bounds");
+    }
 
-        }
+    // The arguments are taken from the top of the value stack
+    size_t param_count = module.functions.frames[function_index].param_count;
+    if (sp < param_count) {
+        throw std::runtime_error("Stack underflow");
     }
-    return {else_pc, pc};
+    size_t entry_depth = call_stack.size();
+    size_t arguments_base = sp - param_count;
+    invoke_result = InvokeResult{};
+
+    TrapCode trap = TRAP_NONE;
+    bool completed;
+    try {
+        completed = memory.run_trapping_faults([this, function_index, entry_depth, arguments_base, &trap] {
+            trap = op_function_call(function_index, arguments_base);
+            // A compiled function has already returned
+            if (trap == TRAP_NONE && call_stack.size() > entry_depth) {
+                trap = execute(entry_depth);
+            }
+        });
+    } catch (...) {
+        // Such as an invalid function of a lazily compiled module: the call is dropped like a trapping one
+        call_stack.resize(entry_depth);
+        sp = arguments_base;
+        throw;
+    }
+#if WASM_GUARD_PAGE_MEMORY
+    if (!completed) {
+        // The fault happened in the innermost frame, at the access it was tagged with: the register
+        // instruction when it is interpreted, the wasm PC itself when it is compiled
+        const StackFrame& frame = call_stack.back();
+        const void* tag = memory.faulting_access();
+        size_t pc = frame.pc == COMPILED_CODE_PC
+                        ? reinterpret_cast<uintptr_t>(tag)
+                        : module.functions.register_origins[frame.function_index][static_cast<const RegisterInstruction*>(tag) - frame.code];
+        record_trap(TRAP_OUT_OF_BOUNDS, frame, pc);
+        trap = TRAP_OUT_OF_BOUNDS;
+    }
+#else
+    (void)completed;
+#endif
+
+    if (trap != TRAP_NONE) {
+        // Nothing of the trapping call survives: its frames and its arguments are dropped
+        call_stack.resize(entry_depth);
+        sp = arguments_base;
+    }
+    return invoke_result;
 }
 
-void Interpreter::op_function_call(const Function &func, size_t &pc) {
-    uint32_t func_idx_to_call = decode_leb128_u<uint32_t>(func.code, pc);
-
-    const Function& target_func = module.functions.at(func_idx_to_call);
-    const FunctionType& target_type = module.types.at(target_func.type_index);
-
-    StackFrame new_frame;
-    new_frame.func = &target_func;
-    new_frame.pc = 0;
-    new_frame.locals.resize(target_type.params.size() + target_func.locals.size(), {.i32 = 0});
-    new_frame.control_stack_base = control_stack.size();
-
-    for (int i = target_type.params.size() - 1; i >= 0; --i) {
-        new_frame.locals[i] = stack.back();
-        stack.pop_back();
+void Interpreter::record_trap(TrapCode trap, const StackFrame& frame, size_t pc) {
+    // The trap passes through every call that is still running, only where it was raised counts
+    if (!invoke_result.ok()) {
+        return;
     }
-
-    call_stack.push_back(new_frame);
+    invoke_result.trap = trap;
+    invoke_result.function_index = frame.function_index;
+    invoke_result.pc = pc;
 }
 
-void Interpreter::op_select() {
-    uint32_t c = pop<int32_t>();
-
-    const Value& b = stack.back();
-    stack.pop_back();
-
-    const Value& a = stack.back();
-    stack.pop_back();
-
-    if (c == 0){
-        stack.push_back(b);
-    } else {
-        stack.push_back(a);
-    }
+TrapCode Interpreter::execute(size_t entry_depth) {
+#if WASM_GUARD_PAGE_MEMORY
+    return (this->*execute_variant)(entry_depth);
+#else
+    return execute_with<false>(entry_depth);
+#endif
 }
 
-void Interpreter::op_loop(const Function &func, size_t &pc, uint8_t opcode) {
-    [[maybe_unused]] uint8_t blocktype = func.code[pc++];
+template <bool Guarded>
+TrapCode Interpreter::execute_with(size_t entry_depth) {
+    TrapCode trap;
+    StackFrame* frame;
+    Value* regs;
+    const RegisterInstruction* code;
+    const RegisterInstruction* ip;
+    const RegisterInstruction* instr;
+    INTERPRETER_LOAD_FRAME();
+
+#if WASM_THREADED_DISPATCH
+    // Every handler jumps straight to the handler of the next instruction, through the entry of its opcode
+#define INTERPRETER_DISPATCH_ENTRY(opcode, label) {opcode, &&label},
+    static const DispatchTable dispatch_table = make_dispatch_table(&&handle_default, {INTERPRETER_DISPATCH_ENTRIES});
+#undef INTERPRETER_DISPATCH_ENTRY
+
+    INTERPRETER_NEXT();
+#else
+    while (true) {
+        // Every function's register code ends with a return, so the PC never runs past it
+        instr = ip++;
+        INTERPRETER_COUNT_INSTRUCTION();
+        INTERPRETER_PROFILE_SEQUENCE();
+
+        switch (instr->opcode) {
+#endif
+        // === CONTROL FLOW ===
+        INTERPRETER_CASE(0x00) { INTERPRETER_TRAP(TRAP_UNREACHABLE); } // unreachable
+        INTERPRETER_CASE(REG_JUMP) { INTERPRETER_JUMP(instr->imm.i64); } INTERPRETER_NEXT();
+        INTERPRETER_CASE(REG_JUMP_IF) { if (regs[instr->a].i32 != 0) INTERPRETER_JUMP(instr->imm.i64); } INTERPRETER_NEXT();
+        INTERPRETER_CASE(REG_JUMP_UNLESS) { if (regs[instr->a].i32 == 0) INTERPRETER_JUMP(instr->imm.i64); } INTERPRETER_NEXT();
+        INTERPRETER_CASE(REG_LOOP_JUMP) { INTERPRETER_JUMP(instr->imm.i64); } INTERPRETER_NEXT_BACK_EDGE();
+        INTERPRETER_CASE(REG_LOOP_JUMP_IF) { // Falls through to the next instruction when not taken
+            if (regs[instr->a].i32 == 0) {
+                INTERPRETER_NEXT();
+            }
+            INTERPRETER_JUMP(instr->imm.i64);
+            INTERPRETER_NEXT_BACK_EDGE();
+        }
+        INTERPRETER_CASE(REG_BR_TABLE) { // The last label is the default for any index past the others
+            uint32_t index = std::min(static_cast<uint32_t>(regs[instr->a].i32), instr->b);
+            INTERPRETER_JUMP(module.functions.register_branch_table[frame->function_index][instr->imm.i64 + index]);
+            INTERPRETER_NEXT();
+        }
+        INTERPRETER_CASE(0x0F) { op_return(*instr); } INTERPRETER_NEXT_FRAME(); // return
+        INTERPRETER_CASE(0x10) { // call
+            frame->pc = ip - code;
+            INTERPRETER_CHECK(op_function_call(instr->imm.i64, frame->locals_base + instr->r));
+            INTERPRETER_NEXT_FRAME();
+        }
+        INTERPRETER_CASE(0x1B) { // select
+            regs[instr->r] = regs[instr->imm.i64].i32 != 0 ? regs[instr->a] : regs[instr->b];
+            INTERPRETER_NEXT();
+        }
 
-    auto [_, end_target_pc] = scan_block_body(pc, func.code);
+        // === VARIABLES ===
+        INTERPRETER_CASE(REG_COPY) { regs[instr->r] = regs[instr->a]; } INTERPRETER_NEXT();
+        INTERPRETER_CASE(0x23) { regs[instr->r] = globals[instr->imm.i64]; } INTERPRETER_NEXT(); // global.get
+        INTERPRETER_CASE(0x24) { globals[instr->imm.i64] = regs[instr->a]; } INTERPRETER_NEXT(); // global.set
+
+        // === LOAD ===
+        INTERPRETER_CASE(0x28) INTERPRETER_CHECK(execute_load<Guarded, int32_t, int32_t>(regs, *instr)); INTERPRETER_NEXT();   // i32.load
+        INTERPRETER_CASE(0x29) INTERPRETER_CHECK(execute_load<Guarded, int64_t, int64_t>(regs, *instr)); INTERPRETER_NEXT();   // i64.load
+        INTERPRETER_CASE(0x2A) INTERPRETER_CHECK(execute_load<Guarded, float, float>(regs, *instr)); INTERPRETER_NEXT();       // f32.load
+        INTERPRETER_CASE(0x2B) INTERPRETER_CHECK(execute_load<Guarded, double, double>(regs, *instr)); INTERPRETER_NEXT();     // f64.load
+        INTERPRETER_CASE(0x2C) INTERPRETER_CHECK(execute_load<Guarded, int32_t, int8_t>(regs, *instr)); INTERPRETER_NEXT();    // i32.load8_s
+        INTERPRETER_CASE(0x2D) INTERPRETER_CHECK(execute_load<Guarded, int32_t, uint8_t>(regs, *instr)); INTERPRETER_NEXT();   // i32.load8_u
+        INTERPRETER_CASE(0x2E) INTERPRETER_CHECK(execute_load<Guarded, int32_t, int16_t>(regs, *instr)); INTERPRETER_NEXT();   // i32.load16_s
+        INTERPRETER_CASE(0x2F) INTERPRETER_CHECK(execute_load<Guarded, int32_t, uint16_t>(regs, *instr)); INTERPRETER_NEXT();  // i32.load16_u
+        INTERPRETER_CASE(0x30) INTERPRETER_CHECK(execute_load<Guarded, int64_t, int8_t>(regs, *instr)); INTERPRETER_NEXT();    // i64.load8_s
+        INTERPRETER_CASE(0x31) INTERPRETER_CHECK(execute_load<Guarded, int64_t, uint8_t>(regs, *instr)); INTERPRETER_NEXT();   // i64.load8_u
+        INTERPRETER_CASE(0x32) INTERPRETER_CHECK(execute_load<Guarded, int64_t, int16_t>(regs, *instr)); INTERPRETER_NEXT();   // i64.load16_s
+        INTERPRETER_CASE(0x33) INTERPRETER_CHECK(execute_load<Guarded, int64_t, uint16_t>(regs, *instr)); INTERPRETER_NEXT();  // i64.load16_u
+        INTERPRETER_CASE(0x34) INTERPRETER_CHECK(execute_load<Guarded, int64_t, int32_t>(regs, *instr)); INTERPRETER_NEXT();   // i64.load32_s
+        INTERPRETER_CASE(0x35) INTERPRETER_CHECK(execute_load<Guarded, int64_t, uint32_t>(regs, *instr)); INTERPRETER_NEXT();  // i64.load32_u
+
+        // === STORE ===
+        INTERPRETER_CASE(0x36) INTERPRETER_CHECK(execute_store<Guarded, int32_t, int32_t>(regs, *instr)); INTERPRETER_NEXT();  // i32.store
+        INTERPRETER_CASE(0x37) INTERPRETER_CHECK(execute_store<Guarded, int64_t, int64_t>(regs, *instr)); INTERPRETER_NEXT();  // i64.store
+        INTERPRETER_CASE(0x38) INTERPRETER_CHECK(execute_store<Guarded, float, float>(regs, *instr)); INTERPRETER_NEXT();      // f32.store
+        INTERPRETER_CASE(0x39) INTERPRETER_CHECK(execute_store<Guarded, double, double>(regs, *instr)); INTERPRETER_NEXT();    // f64.store
+        INTERPRETER_CASE(0x3A) INTERPRETER_CHECK(execute_store<Guarded, int32_t, int8_t>(regs, *instr)); INTERPRETER_NEXT();   // i32.store8
+        INTERPRETER_CASE(0x3B) INTERPRETER_CHECK(execute_store<Guarded, int32_t, int16_t>(regs, *instr)); INTERPRETER_NEXT();  // i32.store16
+        INTERPRETER_CASE(0x3C) INTERPRETER_CHECK(execute_store<Guarded, int64_t, int8_t>(regs, *instr)); INTERPRETER_NEXT();   // i64.store8
+        INTERPRETER_CASE(0x3D) INTERPRETER_CHECK(execute_store<Guarded, int64_t, int16_t>(regs, *instr)); INTERPRETER_NEXT();  // i64.store16
+        INTERPRETER_CASE(0x3E) INTERPRETER_CHECK(execute_store<Guarded, int64_t, int32_t>(regs, *instr)); INTERPRETER_NEXT();  // i64.store32
+
+        // === MEMORY ===
+        INTERPRETER_CASE(0x3F) set<int32_t>(regs[instr->r], memory.pages()); INTERPRETER_NEXT(); // memory.size
+        INTERPRETER_CASE(0x40) set<int32_t>(regs[instr->r], grow_memory(regs[instr->a].i32)); INTERPRETER_NEXT(); // grow
+
+        // === IMMEDIATES ===
+        INTERPRETER_CASE(0x41) // i32.const
+        INTERPRETER_CASE(0x42) // i64.const
+        INTERPRETER_CASE(0x43) // f32.const
+        INTERPRETER_CASE(0x44) // f64.const
+            regs[instr->r] = instr->imm;
+            INTERPRETER_NEXT();
+
+        // === NUMERIC ===
+        // One handler per row of the opcode table in Opcodes.h, each calling its kernel directly
+#define INTERPRETER_NUMERIC_CASE(opcode, name, shape, Operand, Result, expression) \
+        INTERPRETER_CASE(opcode) INTERPRETER_CHECK(execute_##shape##_op<name##_kernel>(regs, *instr)); INTERPRETER_NEXT();
+#define INTERPRETER_PREFIXED_NUMERIC_CASE(opcode, name, shape, Operand, Result, expression) \
+        INTERPRETER_CASE_FC(opcode) INTERPRETER_CHECK(execute_##shape##_op<name##_kernel>(regs, *instr)); INTERPRETER_NEXT();
+
+        WASM_NUMERIC_OPCODES(INTERPRETER_NUMERIC_CASE)
+        WASM_PREFIXED_NUMERIC_OPCODES(INTERPRETER_PREFIXED_NUMERIC_CASE)
+
+#undef INTERPRETER_PREFIXED_NUMERIC_CASE
+#undef INTERPRETER_NUMERIC_CASE
+
+        // === SUPERINSTRUCTIONS ===
+        // A binary operation with a constant operand, and a comparison fused with a conditional jump
+#define INTERPRETER_WITH_IMMEDIATE_CASE_unary(opcode, name)
+#define INTERPRETER_WITH_IMMEDIATE_CASE_binary(opcode, name) \
+        INTERPRETER_CASE_WITH_IMMEDIATE(opcode) INTERPRETER_CHECK(execute_binary_immediate_op<name##_kernel>(regs, *instr)); INTERPRETER_NEXT();
+#define INTERPRETER_WITH_IMMEDIATE_CASE(opcode, name, shape, Operand, Result, expression) \
+        INTERPRETER_WITH_IMMEDIATE_CASE_##shape(opcode, name)
+#define INTERPRETER_COMPARE_JUMP_CASE(opcode, name, negated_opcode)                                          \
+        INTERPRETER_CASE_COMPARE_JUMP(opcode) {                                                              \
+            if (compare<name##_kernel>(regs[instr->a], regs[instr->b])) INTERPRETER_JUMP(instr->r);          \
+            INTERPRETER_NEXT();                                                                              \
+        }                                                                                                    \
+        INTERPRETER_CASE_COMPARE_IMMEDIATE_JUMP(opcode) {                                                    \
+            if (compare<name##_kernel>(regs[instr->a], instr->imm)) INTERPRETER_JUMP(instr->r);              \
+            INTERPRETER_NEXT();                                                                              \
+        }
 
-    ControlFrame frame;
-    frame.opcode = opcode;
-    frame.end = end_target_pc;
+        WASM_NUMERIC_OPCODES(INTERPRETER_WITH_IMMEDIATE_CASE)
+        WASM_INTEGER_COMPARE_OPCODES(INTERPRETER_COMPARE_JUMP_CASE)
 
-    frame.start = (opcode == 0x03) ? pc : 0;
+#undef INTERPRETER_COMPARE_JUMP_CASE
+#undef INTERPRETER_WITH_IMMEDIATE_CASE
+#undef INTERPRETER_WITH_IMMEDIATE_CASE_binary
+#undef INTERPRETER_WITH_IMMEDIATE_CASE_unary
 
-    control_stack.push_back(frame);
-}
+        INTERPRETER_DEFAULT
+            INTERPRETER_TRAP(TRAP_UNSUPPORTED_INSTRUCTION);
+#if !WASM_THREADED_DISPATCH
+        }
+    }
+#endif
 
-void Interpreter::op_if(const Function &func, size_t &pc, uint8_t opcode) {
-    [[maybe_unused]] uint8_t blocktype = func.code[pc++];
+trap_exit:
+    record_trap(trap, *frame, module.functions.register_origins[frame->function_index][instr - code]);
+    return trap;
+}
 
-    // Scan ahead to find the 'else' and 'end' locations.
-    auto [else_target, end_target_pc] = scan_block_body(pc, func.code);
+TrapCode Interpreter::push_call_frame(uint32_t function_index, size_t locals_base) {
+    if (call_stack.size() == MAX_CALL_DEPTH) {
+        return TRAP_CALL_STACK_EXHAUSTED;
+    }
 
-    if (pop<int32_t>() == 0) {
-        // Jump to 'else' or 'end'
-        pc = (else_target != 0) ? else_target : end_target_pc;
-        return; // jump
+    // Reserving the whole frame here is what keeps the register accesses inside the function unchecked
+    const FrameLayout& layout = module.functions.frames[function_index];
+    size_t locals_start = locals_base + layout.param_count;
+    size_t locals_end = locals_start + layout.local_count;
+    if (locals_end + layout.max_stack_height > stack.size()) {
+        return TRAP_CALL_STACK_EXHAUSTED;
     }
 
-    ControlFrame frame;
-    frame.opcode = opcode;
-    frame.end = end_target_pc;
-    frame.start = 0;
+    // The declared locals start out as zero
+    std::fill(stack.begin() + locals_start, stack.begin() + locals_end, Value{.i64 = 0});
 
-    control_stack.push_back(frame);
+    call_stack.push_back(StackFrame{module.functions.register_code[function_index].data(), function_index, 0, locals_base});
+    return TRAP_NONE;
 }
 
-void Interpreter::op_end(size_t &pc) {
-    StackFrame& current_frame = call_stack.back();
-    if (control_stack.size() > current_frame.control_stack_base) {
-        control_stack.pop_back();
+TrapCode Interpreter::op_function_call(uint32_t function_index, size_t locals_base) {
+    // A function of a lazily compiled module is translated on its first call here
+    compiled_module->prepare_function(function_index);
+    if (TrapCode trap = push_call_frame(function_index, locals_base)) {
+        return trap;
     }
-
-    StackFrame& frame = call_stack.back();
-    const Function& func = *frame.func;
-    // Check if this 'end' corresponds to the end of the function body
-    if (pc >= func.code.size()) {
-        call_stack.pop_back();
+#if WASM_JIT
+    if (JitCode code = tiering.on_call(function_index)) {
+        return run_compiled(code);
     }
+#endif
+    return TRAP_NONE;
 }
 
-void Interpreter::op_grow(const Function &func, size_t &pc) {
-    if (func.code[pc++] != 0x00) {
-        throw std::runtime_error("Invalid memory.grow instruction format");
-    }
-    int32_t delta_pages = pop<int32_t>();
-    int32_t old_size_pages = memory.size() / PAGE_SIZE;
+void Interpreter::op_return(const RegisterInstruction& instr) {
+    const StackFrame& frame = call_stack.back();
+
+    // The results replace the arguments and locals of the returning call
+    Value* regs = &stack[frame.locals_base];
+    std::copy(regs + instr.a, regs + instr.a + instr.b, regs);
+    sp = frame.locals_base + instr.b;
 
-    // We assume that we always have enough memory
-    size_t new_size_bytes = (old_size_pages + delta_pages) * PAGE_SIZE;
-    memory.resize(new_size_bytes);
-    push<int32_t>(old_size_pages);
+    call_stack.pop_back();
 }
 
-void Interpreter::op_br_if(const Function &func, size_t &pc) {
-    uint32_t label_index = decode_leb128_u<uint32_t>(func.code, pc);
-    if (pop<int32_t>() != 0) {
-        perform_branch(label_index);
+#if WASM_JIT
+TrapCode Interpreter::run_compiled(JitCode code) {
+    StackFrame& frame = call_stack.back();
+    frame.pc = COMPILED_CODE_PC;
+    uint32_t status = code(&jit_context, &stack[frame.locals_base]);
+    if (status == JIT_EXCEPTION) {
+        std::rethrow_exception(std::exchange(jit_exception, nullptr));
+    }
+    if (status != JIT_OK) {
+        // A trap raised in a call the compiled code made is already recorded
+        record_trap(static_cast<TrapCode>(status), frame, jit_context.trap_pc);
+        return static_cast<TrapCode>(status);
     }
-}
 
-void Interpreter::op_return() {
-    const StackFrame& exiting_frame = call_stack.back();
-    control_stack.resize(exiting_frame.control_stack_base);
+    // The compiled code finishes the whole call and leaves the results in place of the arguments
+    sp = frame.locals_base + module.functions.frames[frame.function_index].result_count;
     call_stack.pop_back();
+    return TRAP_NONE;
 }
 
-void Interpreter::op_mem_size(const Function &func, size_t &pc) {
-    if (func.code[pc++] != 0x00) {
-        throw std::runtime_error("Invalid memory.size instruction format");
-    }
-    push<int32_t>(memory.size() / PAGE_SIZE);
+JitCode Interpreter::compiled_loop(uint32_t loop_pc) {
+    // The register code keeps every operand a loop starts with in its own slot, which is where
+    // the compiled code expects it at the loop header
+    const StackFrame& frame = call_stack.back();
+    return tiering.on_back_edge(frame.function_index, loop_pc);
 }
 
-void Interpreter::perform_branch(uint32_t label_index) {
-    if (label_index >= control_stack.size()) {
-        throw std::runtime_error("perform_branch: Invalid branch label index");
-    }
-
-    const ControlFrame& target = control_stack[control_stack.size() - 1 - label_index];
-    StackFrame& current_frame = call_stack.back();
-
-    for (uint32_t i = 0; i < label_index; ++i) {
-        if (!control_stack.empty()) {
-            control_stack.pop_back();
+uint32_t Interpreter::call_from_jit(uint32_t function_index, Value* arguments) {
+    // No exception may unwind through the compiled caller, it is rethrown once the caller returned.
+    // A trap is returned like one raised by the caller itself.
+    try {
+        size_t entry_depth = call_stack.size();
+        TrapCode trap = op_function_call(function_index, arguments - stack.data());
+        if (trap == TRAP_NONE && call_stack.size() > entry_depth) {
+            trap = execute(entry_depth);
         }
+        return trap;
+    } catch (...) {
+        jit_exception = std::current_exception();
+        return JIT_EXCEPTION;
     }
+}
 
-    if (target.opcode == 0x03) { // Loop
-        current_frame.pc = target.start;
-    } else {
-        current_frame.pc = target.end;
-    }
+uint32_t Interpreter::jit_call(JitContext* context, uint32_t function_index, Value* arguments) {
+    return static_cast<Interpreter*>(context->runtime)->call_from_jit(function_index, arguments);
 }
 
+int32_t Interpreter::jit_memory_grow(JitContext* context, uint32_t delta_pages) {
+    return static_cast<Interpreter*>(context->runtime)->grow_memory(delta_pages);
+}
+#endif
+
+int32_t Interpreter::grow_memory(uint32_t delta_pages) {
+    int32_t old_pages = memory.grow(delta_pages);
+#if WASM_JIT
+    // Compiled code reads the memory bounds from its context
+    jit_context.memory_base = memory.data();
+    jit_context.memory_size = memory.size();
+#endif
+    return old_pages;
+}
 
 int32_t Interpreter::get_memory_i32(uint32_t address) const {
     if (address + 4 > memory.size()) {
         throw std::runtime_error("Memory read out of bounds");
     }
-    return (int32_t)(memory[address] | (memory[address+1] << 8) | (memory[address+2] << 16) | (memory[address+3] << 24));
+    const uint8_t* bytes = memory.data() + address;
+    return (int32_t)(bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24));
 }
 
 float Interpreter::get_memory_f32(uint32_t address) const {
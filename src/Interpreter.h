@@ -2,9 +2,19 @@
 #define INTERPRETER_H
 
 #include "Module.h"
+#include "CompiledModule.h"
+#include "LinearMemory.h"
+#include "Snapshot.h"
+#include "TieringManager.h"
+#include "Opcodes.h"
+#include "Trap.h"
 #include <vector>
-#include <functional>
+#include <memory>
 #include <stdexcept>
+#include <cstring>
+#ifdef WASM_PROFILE_SEQUENCES
+#include <unordered_map>
+#endif
 
 /**
  * @struct StackFrame
@@ -13,45 +23,95 @@
  * Each time a function is called, a new StackFrame is created and pushed onto
  * the call stack. It contains all the state necessary to resume a parent function
  * after a nested call completes.
+ *
+ * A frame owns no storage: its registers are a window into the value stack. The arguments
+ * the caller left in its own operand slots become the first locals in place, the declared
+ * locals follow them, and the slots of the callee's operands start right above.
  */
 struct StackFrame {
-    const Function* func;     // Pointer to the function being executed
-    size_t pc;                // Program counter for that function
-    std::vector<Value> locals;  // The values of the locals for this call
-    size_t control_stack_base;  // The base of this frame with reference to the stack
+    const RegisterInstruction* code; // The register code of the function being executed
+    uint32_t function_index;    // Index of the function being executed
+    size_t pc;                  // Index in its register code where the frame resumes after a call
+    size_t locals_base;         // Index of the first local (the first parameter) in the value stack
 };
 
-/**
- * @struct ControlFrame
- * @brief Represents a structured control flow block like `block`, `loop`, or `if`.
- *
- * These are pushed onto the control stack to manage the targets for branch instructions.
- */
-struct ControlFrame {
-    uint8_t opcode; // The opcode that created this block (if, block, loop)
-    size_t end;     // PC to jump to end the block
-    size_t start;   // PC to jump to start the block.
-};
+// Number of slots in the value stack, which holds the locals and operands of all active calls
+static constexpr size_t VALUE_STACK_SIZE = 64 * 1024;
 
-static constexpr size_t PAGE_SIZE = 65536; // Todo
+// Maximum number of nested calls before execution is aborted
+static constexpr size_t MAX_CALL_DEPTH = 4096;
+
+// The `pc` of a frame whose call runs in compiled code, which the interpreter never resumes
+static constexpr size_t COMPILED_CODE_PC = SIZE_MAX;
 
 /**
  * @class Interpreter
- * @brief Executes the bytecode of a parsed WebAssembly Module.
+ * @brief An instance of a CompiledModule, executing its bytecode.
+ *
+ * The Interpreter is a register-based virtual machine that executes the register code the
+ * Translator produced for every function (see RegisterInstruction). It shares the immutable
+ * CompiledModule with every other instance of it and only owns the runtime state: the call
+ * stack, the value stack holding the frames, the globals and linear memory. Creating one
+ * processes no code, and each instance is used by one thread at a time.
+ *
+ * With WASM_JIT, functions start out interpreted and the TieringManager compiles them to
+ * machine code once they are hot. Calls to a compiled function run the compiled code on the
+ * same value stack frame, and compiled code calls back into the Interpreter for every call
+ * it makes, so compiled and interpreted functions can call each other freely.
  *
- * The Interpreter is a stack-based virtual machine that processes Wasm instructions
- * sequentially. It is initialized with a static Module blueprint and manages all
- * runtime state, including the call stack, operand stack, and linear memory.
+ * A trap is not an exception: the trapping instruction leaves the interpreter loop through
+ * its single exit with a TrapCode, which is passed up through all the calls still running
+ * and returned from invoke() together with the place it happened.
  */
 class Interpreter {
 public:
-    explicit Interpreter(const Module& module);
+    /**
+     * @brief Creates a new instance, whose memory holds the module's active data segments.
+     * @param compiled_module The module to instantiate, kept alive as long as the instance.
+     * @param tiering_policy When functions are promoted to compiled code (only with WASM_JIT).
+     */
+    explicit Interpreter(std::shared_ptr<const CompiledModule> compiled_module, const TieringPolicy& tiering_policy = {});
+
+    /**
+     * @brief Creates an instance in the state of a snapshot, without running any code.
+     *
+     * The memory maps the snapshot's image copy-on-write, so this costs about as much as a
+     * new instance however large the memory is.
+     * @param snapshot The state to start from, kept alive as long as the instance.
+     * @param tiering_policy When functions are promoted to compiled code (only with WASM_JIT).
+     */
+    explicit Interpreter(std::shared_ptr<const Snapshot> snapshot, const TieringPolicy& tiering_policy = {});
 
     /**
      * @brief Begins execution by invoking a function by its index. This is the main entry point.
+     *
+     * The arguments are taken from the top of the value stack, and the results are left there
+     * if the function returns. A trap drops the arguments and all frames of the call.
      * @param function_index The index of the function to call in the module's function space.
+     * @return Success, or the trap that stopped the call with the function and wasm instruction that raised it.
+     * @throws std::runtime_error if the function does not exist or its arguments are missing, or a
+     *         function of a lazily compiled module that the call reaches is invalid.
+     */
+    InvokeResult invoke(uint32_t function_index);
+
+    /**
+     * @brief Saves the memory and globals of the instance, for new instances to start from.
+     *
+     * Meant to be taken between calls, such as after running the module's initialization.
+     * The results the last call left on the value stack are not part of it.
+     * @throws std::runtime_error if the memory cannot be saved.
      */
-    void invoke(uint32_t function_index);
+    std::shared_ptr<const Snapshot> snapshot() const;
+
+    /**
+     * @brief Returns the instance to the state it was created in, ready to be reused.
+     *
+     * Memory goes back to its initial size and contents, the globals to their initial values
+     * (those of the snapshot it was created from, if any), and the stacks are emptied. This is much cheaper than a new instance: no address space
+     * is reserved and only the memory pages that were written cost anything. The counts of
+     * the TieringManager are kept, so functions that were hot stay compiled.
+     */
+    void reset();
 
     /**
      * @brief Retrieves a 32-bit integer from the interpreter's linear memory.
@@ -69,159 +129,234 @@ public:
      */
     float get_memory_f32(uint32_t address) const;
 
+#if WASM_JIT
+    /**
+     * @brief The runtime functions compiled code calls back into, which work for every instance.
+     */
+    static JitHelpers jit_helpers() { return JitHelpers{&Interpreter::jit_call, &Interpreter::jit_memory_grow}; }
+#endif
+
+#ifdef WASM_COUNT_INSTRUCTIONS
+    /**
+     * @brief Retrieves the number of instructions dispatched since the interpreter was created.
+     *
+     * Only available in builds that define WASM_COUNT_INSTRUCTIONS, such as the benchmarks.
+     */
+    uint64_t get_executed_instructions() const { return executed_instructions; }
+#endif
+
+#ifdef WASM_PROFILE_SEQUENCES
+    /**
+     * @brief Retrieves how often each short sequence of register instructions was executed.
+     *
+     * Only sequences of adjacent instructions are counted, where each instruction fell through
+     * to the next, since only those can be fused into a superinstruction. The key holds the
+     * opcodes of a sequence of two or three instructions (see pack_sequence). Only available in
+     * builds that define WASM_PROFILE_SEQUENCES, such as the sequence miner.
+     */
+    const std::unordered_map<uint64_t, uint64_t>& get_sequence_counts() const { return sequence_counts; }
+
+    /**
+     * @brief Packs the opcodes of a sequence into a key of get_sequence_counts(), 16 bits per
+     * opcode with the first one in the highest bits. A third opcode of 0 means a pair.
+     */
+    static constexpr uint64_t pack_sequence(uint16_t first, uint16_t second, uint16_t third = 0) {
+        return (uint64_t{first} << 32) | (uint64_t{second} << 16) | third;
+    }
+#endif
+
 private:
-    void execute();
-    std::pair<size_t, size_t> scan_block_body(size_t start_pc, const std::vector<uint8_t>& code);
-    void perform_branch(uint32_t label_index);
-
-    void op_function_call(const Function &func, size_t &pc);
-    void op_select();
-    void op_loop(const Function &func, size_t &pc, uint8_t opcode);
-    void op_if(const Function &func, size_t &pc, uint8_t opcode);
-    void op_end(size_t &pc);
-    void op_br_if(const Function &func, size_t &pc);
-    void op_return();
-    void op_mem_size(const Function &func, size_t &pc);
-    void op_grow(const Function &func, size_t &pc);
+    Interpreter(std::shared_ptr<const CompiledModule> compiled_module, std::shared_ptr<const Snapshot> origin,
+                const TieringPolicy& tiering_policy);
+
+    // The interpreter loop, in one variant for memories whose accesses are checked and one for
+    // memories with guard pages, which access them directly. Each instance picks one up front.
+    TrapCode execute(size_t entry_depth);
+    template <bool Guarded>
+    TrapCode execute_with(size_t entry_depth);
+    void record_trap(TrapCode trap, const StackFrame& frame, size_t pc);
+
+    TrapCode push_call_frame(uint32_t function_index, size_t locals_base);
+
+    TrapCode op_function_call(uint32_t function_index, size_t locals_base);
+    void op_return(const RegisterInstruction& instr);
+    int32_t grow_memory(uint32_t delta_pages);
+
+#if WASM_JIT
+    TrapCode run_compiled(JitCode code);
+    JitCode compiled_loop(uint32_t loop_pc);
+    uint32_t call_from_jit(uint32_t function_index, Value* arguments);
+    static uint32_t jit_call(JitContext* context, uint32_t function_index, Value* arguments);
+    static int32_t jit_memory_grow(JitContext* context, uint32_t delta_pages);
+#endif
 
+    std::shared_ptr<const CompiledModule> compiled_module;
     const Module& module;
+    std::shared_ptr<const Snapshot> origin; // The snapshot the instance was created from, or nullptr
+    // Allocated once with VALUE_STACK_SIZE slots. `sp` is the index of the first free slot
+    // between calls from the host: the arguments of invoke() and the results it leaves.
     std::vector<Value> stack;
-    std::vector<uint8_t> memory;
+    size_t sp = 0;
+    LinearMemory memory;
     std::vector<Value> globals;
     std::vector<StackFrame> call_stack;
-    std::vector<ControlFrame> control_stack;
+    InvokeResult invoke_result; // The outcome of the running invoke(), set by the first trap
+
+#if WASM_GUARD_PAGE_MEMORY
+    TrapCode (Interpreter::*execute_variant)(size_t entry_depth); // The variant of execute() for the memory
+#endif
+
+#if WASM_JIT
+    TieringManager tiering;
+    JitContext jit_context;
+    std::exception_ptr jit_exception; // An exception caught inside a call from compiled code
+#endif
+
+#ifdef WASM_COUNT_INSTRUCTIONS
+    uint64_t executed_instructions = 0;
+#endif
+
+#ifdef WASM_PROFILE_SEQUENCES
+    std::unordered_map<uint64_t, uint64_t> sequence_counts;
+    const RegisterInstruction* previous_instruction = nullptr;
+    bool previous_fell_through = false;
 
+    void record_sequence(const RegisterInstruction* instr) {
+        if (previous_instruction != nullptr && instr == previous_instruction + 1) {
+            const RegisterInstruction* first = previous_instruction - 1;
+            ++sequence_counts[pack_sequence(previous_instruction->opcode, instr->opcode)];
+            if (previous_fell_through) {
+                ++sequence_counts[pack_sequence(first->opcode, previous_instruction->opcode, instr->opcode)];
+            }
+            previous_fell_through = true;
+        } else {
+            previous_fell_through = false;
+        }
+        previous_instruction = instr;
+    }
+#endif
+
+    // The module is validated and every call reserves its whole frame, so register
+    // accesses need no bounds checks.
     template <typename T>
-    void push(T value) {
+    static T get(const Value& slot) {
         if constexpr (std::is_same_v<T, int32_t>) {
-            stack.push_back({.i32 = value});
+            return slot.i32;
         } else if constexpr (std::is_same_v<T, int64_t>) {
-            stack.push_back({.i64 = value});
+            return slot.i64;
         } else if constexpr (std::is_same_v<T, float>) {
-            stack.push_back({.f32 = value});
+            return slot.f32;
         } else if constexpr (std::is_same_v<T, double>) {
-            stack.push_back({.f64 = value});
+            return slot.f64;
         }
     }
 
     template <typename T>
-    T pop() {
-        if (stack.empty()) {
-            throw std::runtime_error("Stack underflow");
-        }
-        Value val = stack.back();
-        stack.pop_back();
-
+    static void set(Value& slot, T value) {
         if constexpr (std::is_same_v<T, int32_t>) {
-            return val.i32;
+            slot = {.i32 = value};
         } else if constexpr (std::is_same_v<T, int64_t>) {
-            return val.i64;
+            slot = {.i64 = value};
         } else if constexpr (std::is_same_v<T, float>) {
-            return val.f32;
+            slot = {.f32 = value};
         } else if constexpr (std::is_same_v<T, double>) {
-            return val.f64;
+            slot = {.f64 = value};
         }
     }
 
-    template <typename T>
-    T decode_leb128_s(const std::vector<uint8_t>& code, size_t &pc);
-
-    template <typename T>
-    T decode_leb128_u(const std::vector<uint8_t>& code, size_t& pc);
+    // The dynamic address of a load or store plus its static memarg offset.
+    static uint64_t effective_address(const Value* regs, const RegisterInstruction& instr) {
+        return static_cast<uint64_t>(static_cast<uint32_t>(regs[instr.a].i32)) + static_cast<uint64_t>(instr.imm.i64);
+    }
 
+    // The bounds are checked by execute_load and execute_store, or by the guard pages
     template <typename T>
-    void store(uint32_t address, T value) {
-        if (address + sizeof(T) > memory.size()) {
-            throw std::runtime_error("Memory access out of bounds: store");
-        }
-        std::memcpy(&memory[address], &value, sizeof(T));
+    void store(uint64_t address, T value) {
+        std::memcpy(memory.data() + address, &value, sizeof(T));
     }
 
     template <typename T>
-    T load(uint32_t address) const {
-        if (address + sizeof(T) > memory.size()) {
-            throw std::runtime_error("Memory access out of bounds: load");
-        }
+    T load(uint64_t address) const {
         T value;
-        std::memcpy(&value, &memory[address], sizeof(T));
+        std::memcpy(&value, memory.data() + address, sizeof(T));
         return value;
     }
 
-    template <typename DestT, typename SourceT>
-    void execute_reinterpret_op() {
-        SourceT source_val = pop<SourceT>();
-        DestT dest_val;
-        static_assert(sizeof(source_val) == sizeof(dest_val), "Reinterpret types must be the same size");
-        std::memcpy(&dest_val, &source_val, sizeof(dest_val));
-        push<DestT>(dest_val);
-    }
-
-    template <typename DestT, typename SourceT>
-    void execute_conversion_op(const std::function<DestT(SourceT)>& op) {
-        push<DestT>(op(pop<SourceT>()));
+    // A load of a `Stored` value extended to `T`, and a store of a `T` value wrapped to `Stored`.
+    // With guard pages, an access past the end of the memory faults and invoke() reports the
+    // trap at the instruction the access is tagged with. Without them, every access is checked.
+    template <bool Guarded, typename T, typename Stored>
+    TrapCode execute_load(Value* regs, const RegisterInstruction& instr) {
+        uint64_t address = effective_address(regs, instr);
+#if WASM_GUARD_PAGE_MEMORY
+        if constexpr (Guarded) {
+            set<T>(regs[instr.r], static_cast<T>(memory.guarded_load<Stored>(address, &instr)));
+            return TRAP_NONE;
+        }
+#endif
+        if (address + sizeof(Stored) > memory.size()) {
+            return TRAP_OUT_OF_BOUNDS;
+        }
+        set<T>(regs[instr.r], static_cast<T>(load<Stored>(address)));
+        return TRAP_NONE;
     }
 
-    template <typename T>
-    void execute_unary_op(const std::function<T(T)>& op) {
-        push<T>(op(pop<T>()));
+    template <bool Guarded, typename T, typename Stored>
+    TrapCode execute_store(const Value* regs, const RegisterInstruction& instr) {
+        uint64_t address = effective_address(regs, instr);
+#if WASM_GUARD_PAGE_MEMORY
+        if constexpr (Guarded) {
+            memory.guarded_store<Stored>(address, static_cast<Stored>(get<T>(regs[instr.b])), &instr);
+            return TRAP_NONE;
+        }
+#endif
+        if (address + sizeof(Stored) > memory.size()) {
+            return TRAP_OUT_OF_BOUNDS;
+        }
+        store<Stored>(address, static_cast<Stored>(get<T>(regs[instr.b])));
+        return TRAP_NONE;
     }
 
-    template <typename T>
-    void execute_binary_op(const std::function<T(T, T)>& op) {
-        T b = pop<T>();
-        T a = pop<T>();
-        push<T>(op(a, b));
+    // Applies the kernel of a numeric instruction from Opcodes.h to its operand slots, unless
+    // its operands trap. The check is a constant TRAP_NONE for the instructions that never trap.
+    template <typename Kernel>
+    static TrapCode execute_unary_op(Value* regs, const RegisterInstruction& instr) {
+        using Operand = typename Kernel::operand_type;
+        Operand a = get<Operand>(regs[instr.a]);
+        if (TrapCode trap = NumericTrap<Kernel>::check(a)) {
+            return trap;
+        }
+        set<typename Kernel::result_type>(regs[instr.r], Kernel::apply(a));
+        return TRAP_NONE;
     }
 
-    template <typename T>
-    void execute_comparison_op(const std::function<bool(T, T)>& op) {
-        T b = pop<T>();
-        T a = pop<T>();
-        push<int32_t>(op(a, b) ? 1 : 0);
+    template <typename Kernel>
+    static TrapCode execute_binary_immediate_op(Value* regs, const RegisterInstruction& instr) {
+        using Operand = typename Kernel::operand_type;
+        return apply_binary<Kernel>(regs[instr.r], get<Operand>(regs[instr.a]), get<Operand>(instr.imm));
     }
 
-    template <typename T>
-    T read_immediate(const std::vector<uint8_t>& code, size_t& pc) {
-        T value;
-        std::memcpy(&value, &code[pc], sizeof(T));
-        pc += sizeof(T);
-        return value;
+    template <typename Kernel>
+    static bool compare(const Value& a, const Value& b) {
+        using Operand = typename Kernel::operand_type;
+        return Kernel::apply(get<Operand>(a), get<Operand>(b)) != 0;
     }
-};
 
-template <typename T>
-T Interpreter::decode_leb128_s(const std::vector<uint8_t>& code, size_t &pc) {
-    T result = 0;
-    int shift = 0;
-    uint8_t byte;
-    constexpr int bit_width = sizeof(T) * 8;
-
-    do {
-        byte = code[pc++];
-        result |= (static_cast<T>(byte & 0x7f) << shift);
-        shift += 7;
-    } while (byte & 0x80);
-
-    if ((shift < bit_width) && (byte & 0x40)) {
-        result |= (~static_cast<T>(0) << shift);
+    template <typename Kernel>
+    static TrapCode execute_binary_op(Value* regs, const RegisterInstruction& instr) {
+        using Operand = typename Kernel::operand_type;
+        return apply_binary<Kernel>(regs[instr.r], get<Operand>(regs[instr.a]), get<Operand>(regs[instr.b]));
     }
 
-    return result;
-}
-
-template <typename T>
-T Interpreter::decode_leb128_u(const std::vector<uint8_t>& code, size_t& pc) {
-    T result = 0;
-    int shift = 0;
-    while (true) {
-        uint8_t byte = code[pc++];
-        result |= (static_cast<T>(byte & 0x7f) << shift);
-        if ((byte & 0x80) == 0) {
-            break;
+    template <typename Kernel, typename Operand>
+    static TrapCode apply_binary(Value& result, Operand a, Operand b) {
+        if (TrapCode trap = NumericTrap<Kernel>::check(a, b)) {
+            return trap;
         }
-        shift += 7;
+        set<typename Kernel::result_type>(result, Kernel::apply(a, b));
+        return TRAP_NONE;
     }
-    return result;
-}
+
+};
 
 #endif //INTERPRETER_H
\ No newline at end of file
@@ -0,0 +1,1001 @@
+#include "JitCompiler.h"
+
+#if WASM_JIT
+
+#include "X64Assembler.h"
+#include "Opcodes.h"
+#include "LinearMemory.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+
+namespace {
+
+// Registers that hold their value for the whole function. They are callee-saved, so they
+// survive the calls into the runtime; everything else is scratch within one instruction.
+constexpr Reg FRAME = RBX;   // Address of the first local
+constexpr Reg CONTEXT = R12; // The JitContext
+constexpr Reg MEMORY = R13;  // Start of linear memory
+
+// Mandatory prefixes that select the single and double precision forms of the SSE instructions
+constexpr uint8_t F32_PREFIX = 0xF3;
+constexpr uint8_t F64_PREFIX = 0xF2;
+
+constexpr uint8_t SSE_SQRT = 0x51;
+constexpr uint8_t SSE_ADD = 0x58;
+constexpr uint8_t SSE_MUL = 0x59;
+constexpr uint8_t SSE_SUB = 0x5C;
+constexpr uint8_t SSE_DIV = 0x5E;
+
+template <typename T>
+T read_value(const Value& value) {
+    if constexpr (std::is_same_v<T, int32_t>) {
+        return value.i32;
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        return value.i64;
+    } else if constexpr (std::is_same_v<T, float>) {
+        return value.f32;
+    } else {
+        return value.f64;
+    }
+}
+
+template <typename T>
+void write_value(Value& value, T result) {
+    if constexpr (std::is_same_v<T, int32_t>) {
+        value.i32 = result;
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        value.i64 = result;
+    } else if constexpr (std::is_same_v<T, float>) {
+        value.f32 = result;
+    } else {
+        value.f64 = result;
+    }
+}
+
+template <typename Kernel>
+TrapCode apply_unary(Value* operands) {
+    using Operand = typename Kernel::operand_type;
+    Operand a = read_value<Operand>(operands[0]);
+    if (TrapCode trap = NumericTrap<Kernel>::check(a)) {
+        return trap;
+    }
+    write_value<typename Kernel::result_type>(operands[0], Kernel::apply(a));
+    return TRAP_NONE;
+}
+
+template <typename Kernel>
+TrapCode apply_binary(Value* operands) {
+    using Operand = typename Kernel::operand_type;
+    Operand a = read_value<Operand>(operands[0]);
+    Operand b = read_value<Operand>(operands[1]);
+    if (TrapCode trap = NumericTrap<Kernel>::check(a, b)) {
+        return trap;
+    }
+    write_value<typename Kernel::result_type>(operands[0], Kernel::apply(a, b));
+    return TRAP_NONE;
+}
+
+// Runs the kernel of a numeric instruction from Opcodes.h on operands in the value stack,
+// for the instructions the compiler has no native translation for.
+uint32_t run_numeric_kernel(JitContext*, uint32_t opcode, Value* operands) {
+    switch (opcode) {
+#define JIT_NUMERIC_CASE(opcode, name, shape, Operand, Result, expression) \
+        case opcode: return apply_##shape<name##_kernel>(operands);
+#define JIT_PREFIXED_NUMERIC_CASE(opcode, name, shape, Operand, Result, expression) \
+        case PREFIX_FC + opcode: return apply_##shape<name##_kernel>(operands);
+
+        WASM_NUMERIC_OPCODES(JIT_NUMERIC_CASE)
+        WASM_PREFIXED_NUMERIC_OPCODES(JIT_PREFIXED_NUMERIC_CASE)
+
+#undef JIT_PREFIXED_NUMERIC_CASE
+#undef JIT_NUMERIC_CASE
+    }
+    return JIT_OK;
+}
+
+/**
+ * @brief Translates one function. Operands live in the value stack at `FRAME + 8 * (locals + height)`,
+ * and `height` is tracked at compile time exactly as the Validator tracks it.
+ */
+class FunctionCompiler {
+public:
+    FunctionCompiler(const Module& module, uint32_t function_index, const JitHelpers& helpers)
+        : module(module), layout(module.functions.frames[function_index]),
+          instructions(module.functions.instructions[function_index]),
+          branch_table(module.functions.branch_table[function_index]), helpers(helpers),
+          local_count(layout.param_count + layout.local_count) {}
+
+    // Returns false if the function uses an instruction that is not supported
+    bool compile();
+
+    const std::vector<uint8_t>& code() const { return assembler.code; }
+
+    // The code offsets of the loop entries, by the PC of the first instruction of the loop body
+    const std::vector<std::pair<size_t, size_t>>& loop_entries() const { return loop_entry_offsets; }
+
+private:
+    // A block, loop or if that is open at the current instruction
+    struct Block {
+        uint16_t opcode;
+        size_t height;      // Operand stack height below the block's parameters
+        uint32_t params;
+        uint32_t results;
+        Label start;        // Target of branches to a loop
+        Label end;          // Target of branches to any other block
+        Label else_branch;  // Where an if continues when its condition is false
+        bool has_else;
+        bool unreachable;   // Whether the rest of the block is dead code
+    };
+
+    const Module& module;
+    const FrameLayout& layout;
+    std::span<const Instruction> instructions;
+    std::span<const uint32_t> branch_table;
+    const JitHelpers& helpers;
+    size_t local_count;
+
+    X64Assembler assembler;
+    std::vector<Block> blocks;
+    size_t height = 0;
+    size_t dead_nesting = 0; // Blocks opened inside dead code, which is skipped
+    size_t pc = 0;
+
+    std::vector<std::pair<size_t, int64_t>> loop_headers;     // Loop body PC and the code offset of its header
+    std::vector<std::pair<size_t, size_t>> loop_entry_offsets;
+
+    // Where an instruction jumps to trap, which records its PC for Interpreter::invoke
+    struct TrapSite {
+        Label label;
+        TrapCode trap; // TRAP_NONE where a helper already returned the status in eax
+        uint32_t pc;
+    };
+
+    Label exit;
+    std::deque<TrapSite> trap_sites; // A deque, as the jumps to each label refer to it
+
+    int32_t local_offset(uint32_t index) const { return static_cast<int32_t>(index * sizeof(Value)); }
+    int32_t operand_offset(size_t index) const { return static_cast<int32_t>((local_count + index) * sizeof(Value)); }
+    // The operand `depth` values below the top of the stack
+    int32_t top(size_t depth = 0) const { return operand_offset(height - 1 - depth); }
+
+    bool compile_instruction(const Instruction& instr);
+    bool compile_numeric(uint16_t opcode);
+
+    void emit_prologue();
+    void emit_epilogue();
+    Label& trap_site(TrapCode trap);
+    void emit_trap(TrapSite& site);
+
+    std::pair<uint32_t, uint32_t> block_signature(int64_t block_type) const;
+    void open_block(uint16_t opcode, int64_t block_type);
+    void emit_branch(uint32_t label_index);
+    void set_unreachable();
+
+    void emit_helper_call(const void* helper);
+    void emit_call(uint32_t function_index);
+    void emit_address(const Instruction& instr, size_t address_slot, uint32_t access_size);
+    void emit_load(const Instruction& instr);
+    void emit_store(const Instruction& instr);
+
+    void emit_compare(bool wide, Condition cc);
+    void emit_binary(bool wide, AluOp op);
+    void emit_multiply(bool wide);
+    void emit_shift(bool wide, GroupOp op);
+    void emit_divide(bool wide, bool is_signed, bool remainder);
+    void emit_float_binary(bool is_double, uint8_t op);
+    void emit_float_sqrt(bool is_double);
+    void emit_float_compare(bool is_double, uint16_t relation);
+    void emit_numeric_fallback(uint16_t opcode, uint32_t arity);
+};
+
+bool FunctionCompiler::compile() {
+    emit_prologue();
+
+    // The function body is the outermost block, branching to it returns
+    uint32_t result_count = layout.result_count;
+    blocks.push_back(Block{0x02, 0, 0, result_count, {}, {}, {}, false, false});
+
+    for (pc = 0; pc < instructions.size(); ++pc) {
+        if (!compile_instruction(instructions[pc])) {
+            return false;
+        }
+    }
+
+    for (TrapSite& site : trap_sites) {
+        emit_trap(site);
+    }
+
+    // A loop entry sets up the registers like the regular entry and jumps to the loop header,
+    // where the compiled code expects the frame in the same state as the interpreter leaves it
+    for (auto [loop_pc, header] : loop_headers) {
+        loop_entry_offsets.emplace_back(loop_pc, assembler.position());
+        emit_prologue();
+        Label target;
+        target.position = header;
+        assembler.jmp(target);
+    }
+    return true;
+}
+
+void FunctionCompiler::emit_prologue() {
+    // Five pushes on top of the return address keep rsp 16-byte aligned for the helper calls
+    assembler.push(RBX);
+    assembler.push(R12);
+    assembler.push(R13);
+    assembler.push(R14);
+    assembler.push(R15);
+    assembler.mov(true, CONTEXT, RDI);
+    assembler.mov(true, FRAME, RSI);
+    assembler.load64(MEMORY, CONTEXT, offsetof(JitContext, memory_base));
+}
+
+void FunctionCompiler::emit_epilogue() {
+    // The results replace the arguments and locals, as in Interpreter::pop_call_frame
+    uint32_t result_count = layout.result_count;
+    if (local_count > 0) {
+        for (uint32_t i = 0; i < result_count; ++i) {
+            assembler.load64(RAX, FRAME, operand_offset(i));
+            assembler.store64(FRAME, local_offset(i), RAX);
+        }
+    }
+    assembler.alu(ALU_XOR, false, RAX, RAX); // JIT_OK
+
+    // Traps jump here with their status in eax
+    assembler.bind(exit);
+    assembler.pop(R15);
+    assembler.pop(R14);
+    assembler.pop(R13);
+    assembler.pop(R12);
+    assembler.pop(RBX);
+    assembler.ret();
+}
+
+// A label for the current instruction to jump to when it traps
+Label& FunctionCompiler::trap_site(TrapCode trap) {
+    return trap_sites.emplace_back(TrapSite{{}, trap, static_cast<uint32_t>(pc)}).label;
+}
+
+void FunctionCompiler::emit_trap(TrapSite& site) {
+    assembler.bind(site.label);
+    assembler.mov_imm32(RCX, site.pc);
+    assembler.store32(CONTEXT, offsetof(JitContext, trap_pc), RCX);
+    if (site.trap != TRAP_NONE) {
+        assembler.mov_imm32(RAX, site.trap);
+    }
+    assembler.jmp(exit);
+}
+
+std::pair<uint32_t, uint32_t> FunctionCompiler::block_signature(int64_t block_type) const {
+    if (block_type == -64) { // 0x40: empty block type
+        return {0, 0};
+    }
+    if (block_type < 0) { // A single value type
+        return {0, 1};
+    }
+    const FunctionType& type = module.types[block_type];
+    return {type.params.size(), type.results.size()};
+}
+
+void FunctionCompiler::open_block(uint16_t opcode, int64_t block_type) {
+    auto [param_count, result_count] = block_signature(block_type);
+    blocks.push_back(Block{opcode, height - param_count, param_count, result_count, {}, {}, {}, false, false});
+    if (opcode == 0x03) {
+        assembler.bind(blocks.back().start);
+        loop_headers.emplace_back(pc + 1, blocks.back().start.position);
+    }
+}
+
+void FunctionCompiler::emit_branch(uint32_t label_index) {
+    Block& target = blocks[blocks.size() - 1 - label_index];
+    bool is_loop = target.opcode == 0x03;
+    uint32_t arity = is_loop ? target.params : target.results;
+
+    // Keep the label's values and drop everything the block pushed below them
+    if (height - arity != target.height) {
+        for (uint32_t i = 0; i < arity; ++i) {
+            assembler.load64(RAX, FRAME, operand_offset(height - arity + i));
+            assembler.store64(FRAME, operand_offset(target.height + i), RAX);
+        }
+    }
+    assembler.jmp(is_loop ? target.start : target.end);
+}
+
+void FunctionCompiler::set_unreachable() {
+    blocks.back().unreachable = true;
+    height = blocks.back().height;
+}
+
+bool FunctionCompiler::compile_instruction(const Instruction& instr) {
+    // Dead code is skipped up to the else or end of the block that became unreachable
+    if (blocks.back().unreachable) {
+        switch (instr.opcode) {
+            case 0x02: case 0x03: case 0x04:
+                ++dead_nesting;
+                return true;
+            case 0x05:
+                if (dead_nesting > 0) return true;
+                break;
+            case 0x0B:
+                if (dead_nesting > 0) {
+                    --dead_nesting;
+                    return true;
+                }
+                break;
+            default:
+                return true;
+        }
+    }
+
+    switch (instr.opcode) {
+        // === CONTROL FLOW ===
+        case 0x00: // unreachable
+            assembler.jmp(trap_site(TRAP_UNREACHABLE));
+            set_unreachable();
+            return true;
+        case 0x01: // nop
+            return true;
+        case 0x02: // block
+        case 0x03: // loop
+            open_block(instr.opcode, instr.value.i64);
+            return true;
+        case 0x04: { // if
+            // The then branch overwrites the slots of the parameters the else branch needs
+            if (block_signature(instr.value.i64).first != 0) {
+                return false;
+            }
+            assembler.load32(RAX, FRAME, top());
+            --height;
+            open_block(instr.opcode, instr.value.i64);
+            assembler.alu(ALU_TEST, false, RAX, RAX);
+            assembler.jcc(CC_E, blocks.back().else_branch);
+            return true;
+        }
+        case 0x05: { // else
+            Block& block = blocks.back();
+            if (!block.unreachable) {
+                assembler.jmp(block.end);
+            }
+            assembler.bind(block.else_branch);
+            block.has_else = true;
+            block.unreachable = false;
+            height = block.height + block.params;
+            return true;
+        }
+        case 0x0B: { // end
+            Block& block = blocks.back();
+            if (block.opcode == 0x04 && !block.has_else) {
+                assembler.bind(block.else_branch);
+            }
+            assembler.bind(block.end);
+            height = block.height + block.results;
+            blocks.pop_back();
+            if (blocks.empty()) {
+                emit_epilogue();
+            }
+            return true;
+        }
+        case 0x0C: // br
+            emit_branch(instr.a);
+            set_unreachable();
+            return true;
+        case 0x0D: { // br_if
+            Label not_taken;
+            assembler.load32(RAX, FRAME, top());
+            --height;
+            assembler.alu(ALU_TEST, false, RAX, RAX);
+            assembler.jcc(CC_E, not_taken);
+            emit_branch(instr.a);
+            assembler.bind(not_taken);
+            return true;
+        }
+        case 0x0E: { // br_table
+            assembler.load32(RCX, FRAME, top());
+            --height;
+            for (uint32_t i = 0; i < instr.b; ++i) {
+                Label next;
+                assembler.alu_imm32(GROUP_CMP, false, RCX, static_cast<int32_t>(i));
+                assembler.jcc(CC_NE, next);
+                emit_branch(branch_table[instr.a + i]);
+                assembler.bind(next);
+            }
+            emit_branch(branch_table[instr.a + instr.b]);
+            set_unreachable();
+            return true;
+        }
+        case 0x0F: // return
+            emit_branch(blocks.size() - 1);
+            set_unreachable();
+            return true;
+        case 0x10: // call
+            emit_call(instr.a);
+            return true;
+        case 0x1A: // drop
+            --height;
+            return true;
+        case 0x1B: // select
+        case 0x1C: // select t
+            assembler.load64(RAX, FRAME, top(2));
+            assembler.load64(RCX, FRAME, top(1));
+            assembler.load32(RDX, FRAME, top());
+            assembler.alu(ALU_TEST, false, RDX, RDX);
+            assembler.cmov(CC_E, true, RAX, RCX);
+            assembler.store64(FRAME, top(2), RAX);
+            height -= 2;
+            return true;
+
+        // === VARIABLES ===
+        case 0x20: // local.get
+            assembler.load64(RAX, FRAME, local_offset(instr.a));
+            ++height;
+            assembler.store64(FRAME, top(), RAX);
+            return true;
+        case 0x21: // local.set
+            assembler.load64(RAX, FRAME, top());
+            --height;
+            assembler.store64(FRAME, local_offset(instr.a), RAX);
+            return true;
+        case 0x22: // local.tee
+            assembler.load64(RAX, FRAME, top());
+            assembler.store64(FRAME, local_offset(instr.a), RAX);
+            return true;
+        case 0x23: // global.get
+            assembler.load64(RCX, CONTEXT, offsetof(JitContext, globals));
+            assembler.load64(RAX, RCX, static_cast<int32_t>(instr.a * sizeof(Value)));
+            ++height;
+            assembler.store64(FRAME, top(), RAX);
+            return true;
+        case 0x24: // global.set
+            assembler.load64(RCX, CONTEXT, offsetof(JitContext, globals));
+            assembler.load64(RAX, FRAME, top());
+            --height;
+            assembler.store64(RCX, static_cast<int32_t>(instr.a * sizeof(Value)), RAX);
+            return true;
+
+        // === MEMORY ===
+        case 0x28: case 0x29: case 0x2A: case 0x2B: case 0x2C: case 0x2D: case 0x2E: case 0x2F:
+        case 0x30: case 0x31: case 0x32: case 0x33: case 0x34: case 0x35:
+            emit_load(instr);
+            return true;
+        case 0x36: case 0x37: case 0x38: case 0x39: case 0x3A: case 0x3B: case 0x3C: case 0x3D: case 0x3E:
+            emit_store(instr);
+            return true;
+        case 0x3F: // memory.size
+            assembler.load64(RAX, CONTEXT, offsetof(JitContext, memory_size));
+            assembler.shift_imm(GROUP_SHR, true, RAX, 16);
+            ++height;
+            assembler.store32(FRAME, top(), RAX);
+            return true;
+        case 0x40: // memory.grow
+            assembler.mov(true, RDI, CONTEXT);
+            assembler.load32(RSI, FRAME, top());
+            assembler.mov_imm64(RAX, reinterpret_cast<uint64_t>(helpers.memory_grow));
+            assembler.call(RAX);
+            assembler.store32(FRAME, top(), RAX);
+            assembler.load64(MEMORY, CONTEXT, offsetof(JitContext, memory_base));
+            return true;
+
+        // === CONSTANTS ===
+        case 0x41: // i32.const
+        case 0x43: // f32.const
+            assembler.mov_imm32(RAX, static_cast<uint32_t>(instr.value.i32));
+            ++height;
+            assembler.store32(FRAME, top(), RAX);
+            return true;
+        case 0x42: // i64.const
+        case 0x44: // f64.const
+            assembler.mov_imm64(RAX, static_cast<uint64_t>(instr.value.i64));
+            ++height;
+            assembler.store64(FRAME, top(), RAX);
+            return true;
+
+        default:
+            return compile_numeric(instr.opcode);
+    }
+}
+
+bool FunctionCompiler::compile_numeric(uint16_t opcode) {
+    switch (opcode) {
+        case 0x45: // i32.eqz
+        case 0x50: { // i64.eqz
+            bool wide = opcode == 0x50;
+            if (wide) {
+                assembler.load64(RAX, FRAME, top());
+            } else {
+                assembler.load32(RAX, FRAME, top());
+            }
+            assembler.alu(ALU_TEST, wide, RAX, RAX);
+            assembler.setcc(CC_E, RAX);
+            assembler.store32(FRAME, top(), RAX);
+            return true;
+        }
+
+        case 0x46: emit_compare(false, CC_E); return true;  // i32.eq
+        case 0x47: emit_compare(false, CC_NE); return true; // i32.ne
+        case 0x48: emit_compare(false, CC_L); return true;  // i32.lt_s
+        case 0x49: emit_compare(false, CC_B); return true;  // i32.lt_u
+        case 0x4A: emit_compare(false, CC_G); return true;  // i32.gt_s
+        case 0x4B: emit_compare(false, CC_A); return true;  // i32.gt_u
+        case 0x4C: emit_compare(false, CC_LE); return true; // i32.le_s
+        case 0x4D: emit_compare(false, CC_BE); return true; // i32.le_u
+        case 0x4E: emit_compare(false, CC_GE); return true; // i32.ge_s
+        case 0x4F: emit_compare(false, CC_AE); return true; // i32.ge_u
+        case 0x51: emit_compare(true, CC_E); return true;   // i64.eq
+        case 0x52: emit_compare(true, CC_NE); return true;  // i64.ne
+        case 0x53: emit_compare(true, CC_L); return true;   // i64.lt_s
+        case 0x54: emit_compare(true, CC_B); return true;   // i64.lt_u
+        case 0x55: emit_compare(true, CC_G); return true;   // i64.gt_s
+        case 0x56: emit_compare(true, CC_A); return true;   // i64.gt_u
+        case 0x57: emit_compare(true, CC_LE); return true;  // i64.le_s
+        case 0x58: emit_compare(true, CC_BE); return true;  // i64.le_u
+        case 0x59: emit_compare(true, CC_GE); return true;  // i64.ge_s
+        case 0x5A: emit_compare(true, CC_AE); return true;  // i64.ge_u
+
+        case 0x5B: case 0x5C: case 0x5D: case 0x5E: case 0x5F: case 0x60: // f32.eq ... f32.ge
+            emit_float_compare(false, opcode - 0x5B);
+            return true;
+        case 0x61: case 0x62: case 0x63: case 0x64: case 0x65: case 0x66: // f64.eq ... f64.ge
+            emit_float_compare(true, opcode - 0x61);
+            return true;
+
+        case 0x6A: emit_binary(false, ALU_ADD); return true;    // i32.add
+        case 0x6B: emit_binary(false, ALU_SUB); return true;    // i32.sub
+        case 0x6C: emit_multiply(false); return true;           // i32.mul
+        case 0x6D: emit_divide(false, true, false); return true;  // i32.div_s
+        case 0x6E: emit_divide(false, false, false); return true; // i32.div_u
+        case 0x6F: emit_divide(false, true, true); return true;   // i32.rem_s
+        case 0x70: emit_divide(false, false, true); return true;  // i32.rem_u
+        case 0x71: emit_binary(false, ALU_AND); return true;    // i32.and
+        case 0x72: emit_binary(false, ALU_OR); return true;     // i32.or
+        case 0x73: emit_binary(false, ALU_XOR); return true;    // i32.xor
+        case 0x74: emit_shift(false, GROUP_SHL); return true;   // i32.shl
+        case 0x75: emit_shift(false, GROUP_SAR); return true;   // i32.shr_s
+        case 0x76: emit_shift(false, GROUP_SHR); return true;   // i32.shr_u
+        case 0x77: emit_shift(false, GROUP_ROL); return true;   // i32.rotl
+        case 0x78: emit_shift(false, GROUP_ROR); return true;   // i32.rotr
+
+        case 0x7C: emit_binary(true, ALU_ADD); return true;     // i64.add
+        case 0x7D: emit_binary(true, ALU_SUB); return true;     // i64.sub
+        case 0x7E: emit_multiply(true); return true;            // i64.mul
+        case 0x7F: emit_divide(true, true, false); return true;   // i64.div_s
+        case 0x80: emit_divide(true, false, false); return true;  // i64.div_u
+        case 0x81: emit_divide(true, true, true); return true;    // i64.rem_s
+        case 0x82: emit_divide(true, false, true); return true;   // i64.rem_u
+        case 0x83: emit_binary(true, ALU_AND); return true;     // i64.and
+        case 0x84: emit_binary(true, ALU_OR); return true;      // i64.or
+        case 0x85: emit_binary(true, ALU_XOR); return true;     // i64.xor
+        case 0x86: emit_shift(true, GROUP_SHL); return true;    // i64.shl
+        case 0x87: emit_shift(true, GROUP_SAR); return true;    // i64.shr_s
+        case 0x88: emit_shift(true, GROUP_SHR); return true;    // i64.shr_u
+        case 0x89: emit_shift(true, GROUP_ROL); return true;    // i64.rotl
+        case 0x8A: emit_shift(true, GROUP_ROR); return true;    // i64.rotr
+
+        case 0x91: emit_float_sqrt(false); return true;              // f32.sqrt
+        case 0x92: emit_float_binary(false, SSE_ADD); return true;   // f32.add
+        case 0x93: emit_float_binary(false, SSE_SUB); return true;   // f32.sub
+        case 0x94: emit_float_binary(false, SSE_MUL); return true;   // f32.mul
+        case 0x95: emit_float_binary(false, SSE_DIV); return true;   // f32.div
+        case 0x9F: emit_float_sqrt(true); return true;               // f64.sqrt
+        case 0xA0: emit_float_binary(true, SSE_ADD); return true;    // f64.add
+        case 0xA1: emit_float_binary(true, SSE_SUB); return true;    // f64.sub
+        case 0xA2: emit_float_binary(true, SSE_MUL); return true;    // f64.mul
+        case 0xA3: emit_float_binary(true, SSE_DIV); return true;    // f64.div
+
+        // The low half of a slot already is the wrapped value, and reinterpretations only change
+        // how the bits are read, so these instructions need no code at all.
+        case 0xA7: // i32.wrap_i64
+        case 0xBC: // i32.reinterpret_f32
+        case 0xBD: // i64.reinterpret_f64
+        case 0xBE: // f32.reinterpret_i32
+        case 0xBF: // f64.reinterpret_i64
+            return true;
+
+        case 0xAC: // i64.extend_i32_s
+        case 0xC4: // i64.extend32_s
+            assembler.load_sign_extend32(RAX, FRAME, top());
+            assembler.store64(FRAME, top(), RAX);
+            return true;
+        case 0xAD: // i64.extend_i32_u
+            assembler.load32(RAX, FRAME, top());
+            assembler.store64(FRAME, top(), RAX);
+            return true;
+        case 0xC0: // i32.extend8_s
+            assembler.load_extend(0xBE, false, RAX, FRAME, top());
+            assembler.store32(FRAME, top(), RAX);
+            return true;
+        case 0xC1: // i32.extend16_s
+            assembler.load_extend(0xBF, false, RAX, FRAME, top());
+            assembler.store32(FRAME, top(), RAX);
+            return true;
+        case 0xC2: // i64.extend8_s
+            assembler.load_extend(0xBE, true, RAX, FRAME, top());
+            assembler.store64(FRAME, top(), RAX);
+            return true;
+        case 0xC3: // i64.extend16_s
+            assembler.load_extend(0xBF, true, RAX, FRAME, top());
+            assembler.store64(FRAME, top(), RAX);
+            return true;
+
+        default: {
+            uint32_t arity = numeric_arity(opcode);
+            if (arity == 0) {
+                return false;
+            }
+            emit_numeric_fallback(opcode, arity);
+            return true;
+        }
+    }
+}
+
+void FunctionCompiler::emit_helper_call(const void* helper) {
+    assembler.mov_imm64(RAX, reinterpret_cast<uint64_t>(helper));
+    assembler.call(RAX);
+    assembler.alu(ALU_TEST, false, RAX, RAX);
+    assembler.jcc(CC_NE, trap_site(TRAP_NONE));
+}
+
+void FunctionCompiler::emit_call(uint32_t function_index) {
+    const FrameLayout& callee = module.functions.frames[function_index];
+    size_t arguments = height - callee.param_count;
+
+    assembler.mov(true, RDI, CONTEXT);
+    assembler.mov_imm32(RSI, function_index);
+    assembler.lea(RDX, FRAME, operand_offset(arguments));
+    emit_helper_call(reinterpret_cast<const void*>(helpers.call));
+    // The callee may have grown the memory
+    assembler.load64(MEMORY, CONTEXT, offsetof(JitContext, memory_base));
+
+    height = arguments + callee.result_count;
+}
+
+void FunctionCompiler::emit_numeric_fallback(uint16_t opcode, uint32_t arity) {
+    assembler.mov(true, RDI, CONTEXT);
+    assembler.mov_imm32(RSI, opcode);
+    assembler.lea(RDX, FRAME, operand_offset(height - arity));
+    emit_helper_call(reinterpret_cast<const void*>(&run_numeric_kernel));
+    height -= arity - 1;
+}
+
+// Leaves the host address of a memory access in rax
+void FunctionCompiler::emit_address(const Instruction& instr, size_t address_slot, uint32_t access_size) {
+    assembler.load32(RAX, FRAME, operand_offset(address_slot));
+    if (instr.a != 0) {
+        if (instr.a <= INT32_MAX) {
+            assembler.alu_imm32(GROUP_ADD, true, RAX, static_cast<int32_t>(instr.a));
+        } else {
+            assembler.mov_imm64(RCX, instr.a);
+            assembler.alu(ALU_ADD, true, RAX, RCX);
+        }
+    }
+    // Memories without guard pages are checked, in the others anything past the end hits a guard page
+    if (LinearMemory::checks_bounds(module.memory_max_pages)) {
+        assembler.lea(RDX, RAX, static_cast<int32_t>(access_size));
+        assembler.cmp_mem(true, RDX, CONTEXT, offsetof(JitContext, memory_size));
+        assembler.jcc(CC_A, trap_site(TRAP_OUT_OF_BOUNDS));
+    } else {
+        // The fault handler reads the PC from the register that tags a guarded access
+        assembler.mov_imm32(R11, static_cast<uint32_t>(pc));
+    }
+    assembler.alu(ALU_ADD, true, RAX, MEMORY);
+}
+
+void FunctionCompiler::emit_load(const Instruction& instr) {
+    size_t address_slot = height - 1;
+    switch (instr.opcode) {
+        case 0x28: // i32.load
+        case 0x2A: // f32.load
+            emit_address(instr, address_slot, 4);
+            assembler.load32(RCX, RAX, 0);
+            assembler.store32(FRAME, top(), RCX);
+            break;
+        case 0x29: // i64.load
+        case 0x2B: // f64.load
+            emit_address(instr, address_slot, 8);
+            assembler.load64(RCX, RAX, 0);
+            assembler.store64(FRAME, top(), RCX);
+            break;
+        case 0x2C: // i32.load8_s
+            emit_address(instr, address_slot, 1);
+            assembler.load_extend(0xBE, false, RCX, RAX, 0);
+            assembler.store32(FRAME, top(), RCX);
+            break;
+        case 0x2D: // i32.load8_u
+            emit_address(instr, address_slot, 1);
+            assembler.load_extend(0xB6, false, RCX, RAX, 0);
+            assembler.store32(FRAME, top(), RCX);
+            break;
+        case 0x2E: // i32.load16_s
+            emit_address(instr, address_slot, 2);
+            assembler.load_extend(0xBF, false, RCX, RAX, 0);
+            assembler.store32(FRAME, top(), RCX);
+            break;
+        case 0x2F: // i32.load16_u
+            emit_address(instr, address_slot, 2);
+            assembler.load_extend(0xB7, false, RCX, RAX, 0);
+            assembler.store32(FRAME, top(), RCX);
+            break;
+        case 0x30: // i64.load8_s
+            emit_address(instr, address_slot, 1);
+            assembler.load_extend(0xBE, true, RCX, RAX, 0);
+            assembler.store64(FRAME, top(), RCX);
+            break;
+        case 0x31: // i64.load8_u
+            emit_address(instr, address_slot, 1);
+            assembler.load_extend(0xB6, false, RCX, RAX, 0);
+            assembler.store64(FRAME, top(), RCX);
+            break;
+        case 0x32: // i64.load16_s
+            emit_address(instr, address_slot, 2);
+            assembler.load_extend(0xBF, true, RCX, RAX, 0);
+            assembler.store64(FRAME, top(), RCX);
+            break;
+        case 0x33: // i64.load16_u
+            emit_address(instr, address_slot, 2);
+            assembler.load_extend(0xB7, false, RCX, RAX, 0);
+            assembler.store64(FRAME, top(), RCX);
+            break;
+        case 0x34: // i64.load32_s
+            emit_address(instr, address_slot, 4);
+            assembler.load_sign_extend32(RCX, RAX, 0);
+            assembler.store64(FRAME, top(), RCX);
+            break;
+        case 0x35: // i64.load32_u
+            emit_address(instr, address_slot, 4);
+            assembler.load32(RCX, RAX, 0);
+            assembler.store64(FRAME, top(), RCX);
+            break;
+    }
+}
+
+void FunctionCompiler::emit_store(const Instruction& instr) {
+    size_t address_slot = height - 2;
+    switch (instr.opcode) {
+        case 0x36: // i32.store
+        case 0x38: // f32.store
+        case 0x3E: // i64.store32
+            emit_address(instr, address_slot, 4);
+            assembler.load32(RCX, FRAME, top());
+            assembler.store32(RAX, 0, RCX);
+            break;
+        case 0x37: // i64.store
+        case 0x39: // f64.store
+            emit_address(instr, address_slot, 8);
+            assembler.load64(RCX, FRAME, top());
+            assembler.store64(RAX, 0, RCX);
+            break;
+        case 0x3A: // i32.store8
+        case 0x3C: // i64.store8
+            emit_address(instr, address_slot, 1);
+            assembler.load32(RCX, FRAME, top());
+            assembler.store8(RAX, 0, RCX);
+            break;
+        case 0x3B: // i32.store16
+        case 0x3D: // i64.store16
+            emit_address(instr, address_slot, 2);
+            assembler.load32(RCX, FRAME, top());
+            assembler.store16(RAX, 0, RCX);
+            break;
+    }
+    height -= 2;
+}
+
+void FunctionCompiler::emit_compare(bool wide, Condition cc) {
+    if (wide) {
+        assembler.load64(RAX, FRAME, top(1));
+        assembler.load64(RCX, FRAME, top());
+    } else {
+        assembler.load32(RAX, FRAME, top(1));
+        assembler.load32(RCX, FRAME, top());
+    }
+    assembler.alu(ALU_CMP, wide, RAX, RCX);
+    assembler.setcc(cc, RAX);
+    --height;
+    assembler.store32(FRAME, top(), RAX);
+}
+
+void FunctionCompiler::emit_binary(bool wide, AluOp op) {
+    if (wide) {
+        assembler.load64(RAX, FRAME, top(1));
+        assembler.load64(RCX, FRAME, top());
+        assembler.alu(op, true, RAX, RCX);
+        --height;
+        assembler.store64(FRAME, top(), RAX);
+    } else {
+        assembler.load32(RAX, FRAME, top(1));
+        assembler.load32(RCX, FRAME, top());
+        assembler.alu(op, false, RAX, RCX);
+        --height;
+        assembler.store32(FRAME, top(), RAX);
+    }
+}
+
+void FunctionCompiler::emit_multiply(bool wide) {
+    if (wide) {
+        assembler.load64(RAX, FRAME, top(1));
+        assembler.load64(RCX, FRAME, top());
+        assembler.imul(true, RAX, RCX);
+        --height;
+        assembler.store64(FRAME, top(), RAX);
+    } else {
+        assembler.load32(RAX, FRAME, top(1));
+        assembler.load32(RCX, FRAME, top());
+        assembler.imul(false, RAX, RCX);
+        --height;
+        assembler.store32(FRAME, top(), RAX);
+    }
+}
+
+// x86 masks the shift count to the operand width, just as wasm does
+void FunctionCompiler::emit_shift(bool wide, GroupOp op) {
+    if (wide) {
+        assembler.load64(RAX, FRAME, top(1));
+        assembler.load64(RCX, FRAME, top());
+        assembler.shift_cl(op, true, RAX);
+        --height;
+        assembler.store64(FRAME, top(), RAX);
+    } else {
+        assembler.load32(RAX, FRAME, top(1));
+        assembler.load32(RCX, FRAME, top());
+        assembler.shift_cl(op, false, RAX);
+        --height;
+        assembler.store32(FRAME, top(), RAX);
+    }
+}
+
+void FunctionCompiler::emit_divide(bool wide, bool is_signed, bool remainder) {
+    if (wide) {
+        assembler.load64(RAX, FRAME, top(1));
+        assembler.load64(RCX, FRAME, top());
+    } else {
+        assembler.load32(RAX, FRAME, top(1));
+        assembler.load32(RCX, FRAME, top());
+    }
+    assembler.alu(ALU_TEST, wide, RCX, RCX);
+    assembler.jcc(CC_E, trap_site(TRAP_DIVIDE_BY_ZERO));
+
+    Label done;
+    if (is_signed) {
+        // MIN / -1 overflows, and idiv faults on it for the remainder too, whose result is 0
+        Label divide;
+        assembler.alu_imm32(GROUP_CMP, wide, RCX, -1);
+        assembler.jcc(CC_NE, divide);
+        if (remainder) {
+            assembler.alu(ALU_XOR, false, RDX, RDX);
+            assembler.jmp(done);
+        } else if (wide) {
+            assembler.mov_imm64(RDX, static_cast<uint64_t>(INT64_MIN));
+            assembler.alu(ALU_CMP, true, RAX, RDX);
+            assembler.jcc(CC_E, trap_site(TRAP_INTEGER_OVERFLOW));
+        } else {
+            assembler.alu_imm32(GROUP_CMP, false, RAX, INT32_MIN);
+            assembler.jcc(CC_E, trap_site(TRAP_INTEGER_OVERFLOW));
+        }
+        assembler.bind(divide);
+        assembler.sign_extend_accumulator(wide);
+        assembler.divide(GROUP_IDIV, wide, RCX);
+    } else {
+        assembler.alu(ALU_XOR, false, RDX, RDX);
+        assembler.divide(GROUP_DIV, wide, RCX);
+    }
+    assembler.bind(done);
+
+    Reg result = remainder ? RDX : RAX;
+    --height;
+    if (wide) {
+        assembler.store64(FRAME, top(), result);
+    } else {
+        assembler.store32(FRAME, top(), result);
+    }
+}
+
+void FunctionCompiler::emit_float_binary(bool is_double, uint8_t op) {
+    uint8_t prefix = is_double ? F64_PREFIX : F32_PREFIX;
+    assembler.sse_load(prefix, XMM0, FRAME, top(1));
+    assembler.sse_load(prefix, XMM1, FRAME, top());
+    assembler.sse_op(prefix, op, XMM0, XMM1);
+    --height;
+    assembler.sse_store(prefix, FRAME, top(), XMM0);
+}
+
+void FunctionCompiler::emit_float_sqrt(bool is_double) {
+    uint8_t prefix = is_double ? F64_PREFIX : F32_PREFIX;
+    assembler.sse_load(prefix, XMM0, FRAME, top());
+    assembler.sse_op(prefix, SSE_SQRT, XMM0, XMM0);
+    assembler.sse_store(prefix, FRAME, top(), XMM0);
+}
+
+// `relation` counts from eq: eq, ne, lt, gt, le, ge. An unordered comparison (a NaN operand)
+// sets ZF, PF and CF, so every relation but ne has to come out false for it.
+void FunctionCompiler::emit_float_compare(bool is_double, uint16_t relation) {
+    uint8_t prefix = is_double ? F64_PREFIX : F32_PREFIX;
+    assembler.sse_load(prefix, XMM0, FRAME, top(1));
+    assembler.sse_load(prefix, XMM1, FRAME, top());
+    switch (relation) {
+        case 0: // eq
+            assembler.ucomis(is_double, XMM0, XMM1);
+            assembler.setcc(CC_E, RAX);
+            assembler.setcc(CC_NP, RCX);
+            assembler.alu(ALU_AND, false, RAX, RCX);
+            break;
+        case 1: // ne
+            assembler.ucomis(is_double, XMM0, XMM1);
+            assembler.setcc(CC_NE, RAX);
+            assembler.setcc(CC_P, RCX);
+            assembler.alu(ALU_OR, false, RAX, RCX);
+            break;
+        case 2: // lt: b > a
+            assembler.ucomis(is_double, XMM1, XMM0);
+            assembler.setcc(CC_A, RAX);
+            break;
+        case 3: // gt
+            assembler.ucomis(is_double, XMM0, XMM1);
+            assembler.setcc(CC_A, RAX);
+            break;
+        case 4: // le: b >= a
+            assembler.ucomis(is_double, XMM1, XMM0);
+            assembler.setcc(CC_AE, RAX);
+            break;
+        case 5: // ge
+            assembler.ucomis(is_double, XMM0, XMM1);
+            assembler.setcc(CC_AE, RAX);
+            break;
+    }
+    --height;
+    assembler.store32(FRAME, top(), RAX);
+}
+
+} // namespace
+
+JitCompiler::JitCompiler(const Module& module, const JitHelpers& helpers) : module(module), helpers(helpers) {}
+
+JitCompiler::~JitCompiler() {
+    for (auto [block, size] : code_blocks) {
+        munmap(block, size);
+    }
+}
+
+JitCode CompiledFunction::loop_entry(size_t loop_pc) const {
+    for (const auto& [pc, code] : loop_entries) {
+        if (pc == loop_pc) {
+            return code;
+        }
+    }
+    return nullptr;
+}
+
+CompiledFunction JitCompiler::compile(uint32_t function_index) {
+    FunctionCompiler compiler(module, function_index, helpers);
+    CompiledFunction compiled;
+    if (!compiler.compile()) {
+        return compiled;
+    }
+
+    uint8_t* code = install(compiler.code());
+    compiled.entry = reinterpret_cast<JitCode>(code);
+    for (auto [loop_pc, offset] : compiler.loop_entries()) {
+        compiled.loop_entries.emplace_back(loop_pc, reinterpret_cast<JitCode>(code + offset));
+    }
+    return compiled;
+}
+
+uint8_t* JitCompiler::install(const std::vector<uint8_t>& code) {
+    // The pages are written while writable and only then made executable, never both at once
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t size = (code.size() + page_size - 1) / page_size * page_size;
+    void* block = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED) {
+        throw std::runtime_error("Failed to allocate memory for compiled code");
+    }
+    std::memcpy(block, code.data(), code.size());
+    if (mprotect(block, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(block, size);
+        throw std::runtime_error("Failed to make compiled code executable");
+    }
+    std::lock_guard<std::mutex> lock(code_blocks_mutex);
+    code_blocks.emplace_back(block, size);
+    return static_cast<uint8_t*>(block);
+}
+
+#endif
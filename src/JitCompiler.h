@@ -0,0 +1,115 @@
+#ifndef JIT_COMPILER_H
+#define JIT_COMPILER_H
+
+#include "Module.h"
+#include "Trap.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+
+#ifndef WASM_JIT
+#define WASM_JIT 0
+#endif
+
+#if WASM_JIT
+
+/**
+ * @struct JitContext
+ * @brief The runtime state that compiled code reads; every compiled function receives its address.
+ */
+struct JitContext {
+    void* runtime;                         // The Interpreter running the code, passed back to the helpers
+    Value* globals;                        // The instance's global values
+    uint8_t* memory_base;                  // Start of linear memory
+    uint64_t memory_size;                  // Size of linear memory in bytes
+    std::exception_ptr* pending_exception; // Where a helper leaves the exception it caught
+    uint32_t trap_pc;                      // Index of the wasm instruction that compiled code trapped at
+};
+
+/**
+ * @brief How a compiled function returned: JIT_OK, the TrapCode of a trap, or JIT_EXCEPTION.
+ *
+ * Compiled code has no unwind information, so C++ exceptions must never pass through it.
+ * Traps are returned like in the interpreter, and an exception thrown by a helper is stored
+ * in the context and reported as JIT_EXCEPTION, to be rethrown once the native frames are gone.
+ */
+enum JitStatus : uint32_t {
+    JIT_OK = TRAP_NONE,
+    JIT_EXCEPTION = 0x100, // Above every TrapCode
+};
+
+/**
+ * @brief A compiled function. `frame` points at its first local in the value stack, and the
+ * results are left in the first slots of the frame, exactly where the interpreter leaves them.
+ */
+using JitCode = uint32_t (*)(JitContext* context, Value* frame);
+
+/**
+ * @struct JitHelpers
+ * @brief The runtime functions compiled code calls for what it does not do itself.
+ */
+struct JitHelpers {
+    // Runs a function with its arguments at `arguments` and leaves its results there
+    uint32_t (*call)(JitContext* context, uint32_t function_index, Value* arguments);
+    // memory.grow, returning the old size in pages or -1
+    int32_t (*memory_grow)(JitContext* context, uint32_t delta_pages);
+};
+
+/**
+ * @struct CompiledFunction
+ * @brief The entry points of a compiled function.
+ *
+ * Besides the regular entry, every loop has its own entry at its header, which expects the
+ * locals and the loop's parameters in the frame exactly where the interpreter keeps them.
+ * That lets a call that is already running in the interpreter continue in compiled code.
+ */
+struct CompiledFunction {
+    JitCode entry = nullptr;                            // nullptr if the function could not be compiled
+    std::vector<std::pair<size_t, JitCode>> loop_entries; // By the PC of the first instruction of the loop body
+
+    JitCode loop_entry(size_t loop_pc) const;
+};
+
+/**
+ * @class JitCompiler
+ * @brief A baseline single-pass compiler from validated functions to x86-64 machine code.
+ *
+ * The compiled code keeps the wasm locals and operands in the same value stack slots the
+ * interpreter uses: the Validator fixes the operand stack height at every instruction, so
+ * every operand has a static offset from the frame, and each instruction is translated into
+ * a few loads, the operation and a store. Blocks become plain jumps and branches copy their
+ * values at compile-time known offsets, so no control stack is needed at run time.
+ *
+ * Calls, memory.grow and the numeric instructions without a native translation call back
+ * into the runtime. Functions using anything else (tables, references, bulk memory) are
+ * not compiled and stay in the interpreter.
+ */
+class JitCompiler {
+public:
+    JitCompiler(const Module& module, const JitHelpers& helpers);
+    ~JitCompiler();
+
+    JitCompiler(const JitCompiler&) = delete;
+    JitCompiler& operator=(const JitCompiler&) = delete;
+
+    /**
+     * @brief Compiles a function of the module into executable memory. Safe to call from several threads.
+     * @param function_index A validated function of the module.
+     * @return The compiled entry points, without any if the function uses an instruction the JIT does not support.
+     */
+    CompiledFunction compile(uint32_t function_index);
+
+private:
+    const Module& module;
+    JitHelpers helpers;
+    std::mutex code_blocks_mutex; // Functions may be compiled on several threads at once
+    std::vector<std::pair<void*, size_t>> code_blocks; // The mapped pages of every compiled function
+
+    uint8_t* install(const std::vector<uint8_t>& code);
+};
+
+#endif
+
+#endif //JIT_COMPILER_H
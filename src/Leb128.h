@@ -0,0 +1,175 @@
+#ifndef LEB128_H
+#define LEB128_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Whether `byte` can be the last byte of a LEB128 number of the largest length T allows.
+ *
+ * The last byte must end the number and, of its 7 bits, only use the ones that still fit into
+ * T: the rest must be zero for an unsigned T, and copies of the sign bit for a signed one.
+ */
+template <typename T>
+constexpr bool leb128_last_byte_fits(uint8_t byte) {
+    constexpr int bits = sizeof(T) * 8;
+    constexpr int max_bytes = (bits + 6) / 7;
+    constexpr int used_bits = bits - 7 * (max_bytes - 1); // 4 for 32-bit, 1 for 64-bit numbers
+    if (byte & 0x80) {
+        return false;
+    }
+    if constexpr (std::is_signed_v<T>) {
+        uint8_t top = byte >> (used_bits - 1); // The sign bit and the bits above it
+        return top == 0 || top == (0x7f >> (used_bits - 1));
+    } else {
+        return (byte >> used_bits) == 0;
+    }
+}
+
+/**
+ * @brief Packs the 7-bit groups of the low bytes of `payload` together, the lowest group first.
+ */
+inline uint64_t leb128_pack_groups(uint64_t payload) {
+#if defined(__BMI2__)
+    return _pext_u64(payload, 0x7f7f7f7f7f7f7f7fULL);
+#else
+    uint64_t result = payload & 0x7f7f7f7f7f7f7f7fULL;
+    result = (result & 0x007f007f007f007fULL) | (result & 0x7f007f007f007f00ULL) >> 1;
+    result = (result & 0x00003fff00003fffULL) | (result & 0x3fff00003fff0000ULL) >> 2;
+    result = (result & 0x000000000fffffffULL) | (result & 0x0fffffff00000000ULL) >> 4;
+    return result;
+#endif
+}
+
+/**
+ * @brief Decodes a LEB128 number of more than two bytes, or one near the end of the bytes,
+ * see decode_leb128.
+ */
+template <typename T>
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+T decode_multibyte_leb128(std::span<const uint8_t> bytes, size_t& offset, const char* end_message) {
+    constexpr int bits = sizeof(T) * 8;
+    constexpr size_t max_bytes = (bits + 6) / 7;
+
+    if (std::endian::native == std::endian::little && offset <= bytes.size() && bytes.size() - offset >= 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes.data() + offset, 8);
+        uint64_t ends = ~word & 0x8080808080808080ULL;
+
+        if constexpr (max_bytes <= 8) {
+            // Numbers padded to the full length, as linkers leave them, get a branch of their own:
+            // when it is predicted, the offset moves on by a constant instead of a computed length,
+            // so the next number does not wait for this one to be loaded
+            constexpr uint64_t length_mask = ~uint64_t{0} >> (64 - 8 * max_bytes);
+            constexpr uint64_t full_length = uint64_t{0x80} << (8 * (max_bytes - 1));
+            if ((ends & length_mask) == full_length) {
+                uint64_t payload = word & length_mask;
+                if (!leb128_last_byte_fits<T>(static_cast<uint8_t>(payload >> (8 * (max_bytes - 1))))) {
+                    throw std::runtime_error("Malformed LEB128 number.");
+                }
+                offset += max_bytes;
+                // The checked bits past the width of T, zeros or copies of its sign bit, are cut off
+                return static_cast<T>(leb128_pack_groups(payload));
+            }
+        }
+
+        if (ends != 0) {
+            int end_bit = std::countr_zero(ends); // The top bit of the last byte
+            size_t length = (end_bit + 1) / 8;
+            uint64_t payload = word & (~uint64_t{0} >> (63 - end_bit));
+            uint8_t last_byte = static_cast<uint8_t>(payload >> (end_bit - 7));
+            if (length >= max_bytes && (length > max_bytes || !leb128_last_byte_fits<T>(last_byte))) {
+                throw std::runtime_error("Malformed LEB128 number.");
+            }
+            uint64_t result = leb128_pack_groups(payload);
+            offset += length;
+            if constexpr (std::is_signed_v<T>) {
+                // Moves the sign bit of the last group to the top, and back with copies of it
+                int unused_bits = 64 - static_cast<int>(length) * 7;
+                return static_cast<T>(static_cast<int64_t>(result << unused_bits) >> unused_bits);
+            }
+            return static_cast<T>(result);
+        }
+    }
+
+    // Near the end of the bytes, or a 64-bit number of more than 8 bytes
+    uint64_t result = 0;
+    int shift = 0;
+    uint8_t byte;
+    for (size_t length = 1;; ++length) {
+        if (offset >= bytes.size()) {
+            throw std::runtime_error(end_message);
+        }
+        byte = bytes[offset++];
+        if (length == max_bytes && !leb128_last_byte_fits<T>(byte)) {
+            throw std::runtime_error("Malformed LEB128 number.");
+        }
+        result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        shift += 7;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    if constexpr (std::is_signed_v<T>) {
+        if (shift < 64 && (byte & 0x40)) {
+            result |= ~uint64_t{0} << shift;
+        }
+    }
+    return static_cast<T>(result);
+}
+
+/**
+ * @brief Decodes the LEB128 number at `offset` in `bytes` into a T and moves `offset` past it.
+ *
+ * A signed T decodes signed LEB128, an unsigned T unsigned LEB128. Numbers of one and two
+ * bytes, the most common kinds by far, are decoded inline, each on a branch of its own: the
+ * branch predictor then moves on to the next number before this one is even loaded, which a
+ * length computed from the bytes would have to wait for. Longer ones are decoded out of line:
+ * numbers of the full length of a 32-bit T, as linkers pad them, take a branch of their own
+ * for the same reason. Otherwise, with at least 8 bytes left, the bytes are loaded as one
+ * word, the first byte without the continuation bit is the lowest zero among the top bits of
+ * all bytes, and the 7-bit groups before it are packed together with three shift-and-mask
+ * steps (one pext with BMI2), with neither a loop nor a branch per byte. Longer 64-bit
+ * numbers and numbers in the last few bytes of `bytes` are decoded one byte at a time.
+ *
+ * @param end_message What to report if the number runs past the end of `bytes`.
+ * @throws std::runtime_error if the number runs past the end of `bytes`, is longer than a T
+ *         needs, or has bits that do not fit into a T.
+ */
+template <typename T>
+inline T decode_leb128(std::span<const uint8_t> bytes, size_t& offset, const char* end_message) {
+    static_assert(std::is_integral_v<T> && (sizeof(T) == 4 || sizeof(T) == 8));
+    if (offset < bytes.size()) {
+        uint8_t byte = bytes[offset];
+        if ((byte & 0x80) == 0) {
+            ++offset;
+            if constexpr (std::is_signed_v<T>) {
+                return static_cast<T>(static_cast<int8_t>(byte << 1) >> 1);
+            } else {
+                return byte;
+            }
+        }
+        if (bytes.size() - offset >= 2 && (bytes[offset + 1] & 0x80) == 0) {
+            uint64_t result = (byte & 0x7f) | static_cast<uint64_t>(bytes[offset + 1]) << 7;
+            offset += 2;
+            if constexpr (std::is_signed_v<T>) {
+                return static_cast<T>(static_cast<int64_t>(result << 50) >> 50);
+            }
+            return static_cast<T>(result);
+        }
+    }
+    return decode_multibyte_leb128<T>(bytes, offset, end_message);
+}
+
+#endif //LEB128_H
@@ -0,0 +1,286 @@
+#include "LinearMemory.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// On 64-bit POSIX systems the memory reserves its whole address range up front, so it never
+// moves and growing only commits the new pages. Elsewhere it falls back to a heap block.
+#if WASM_GUARD_PAGE_MEMORY || ((defined(__unix__) || defined(__APPLE__)) && UINTPTR_MAX > UINT32_MAX)
+#define LINEAR_MEMORY_RESERVES_ADDRESS_SPACE 1
+#include <sys/mman.h>
+#else
+#define LINEAR_MEMORY_RESERVES_ADDRESS_SPACE 0
+#endif
+
+// Images are memory files mapped copy-on-write, which needs memfd_create and a fixed address range
+#if LINEAR_MEMORY_RESERVES_ADDRESS_SPACE && defined(__linux__)
+#define LINEAR_MEMORY_MAPS_IMAGES 1
+#include <unistd.h>
+#else
+#define LINEAR_MEMORY_MAPS_IMAGES 0
+#endif
+
+#if WASM_GUARD_PAGE_MEMORY
+#include <mutex>
+#include <ucontext.h>
+
+// Everything a load or store can address: a 32-bit address plus a 32-bit static offset,
+// plus the width of the widest access. One extra wasm page covers the latter.
+static constexpr size_t GUARDED_RESERVATION = (size_t{1} << 33) + PAGE_SIZE;
+
+thread_local LinearMemory::FaultScope* LinearMemory::active_fault_scope = nullptr;
+
+static struct sigaction previous_segv_action;
+static struct sigaction previous_bus_action;
+#endif
+
+// True if no byte in the range is set
+static bool is_zero(const uint8_t* bytes, size_t size) {
+    return size == 0 || (bytes[0] == 0 && std::memcmp(bytes, bytes + 1, size - 1) == 0);
+}
+
+MemoryImage::MemoryImage(const LinearMemory& memory) : size_bytes(memory.size()) {
+#if LINEAR_MEMORY_MAPS_IMAGES
+    file = memfd_create("wasm-memory-image", MFD_CLOEXEC);
+    if (file < 0) {
+        throw std::runtime_error("Failed to create the file of a memory image");
+    }
+    if (ftruncate(file, size_bytes) != 0) {
+        close(file);
+        throw std::runtime_error("Failed to size the file of a memory image");
+    }
+
+    // Pages that were never written stay holes, which read as zero and take no space
+    for (size_t page = 0; page < size_bytes; page += PAGE_SIZE) {
+        const uint8_t* bytes = memory.data() + page;
+        if (is_zero(bytes, PAGE_SIZE)) {
+            continue;
+        }
+        for (size_t written = 0; written < PAGE_SIZE;) {
+            ssize_t result = pwrite(file, bytes + written, PAGE_SIZE - written, page + written);
+            if (result <= 0) {
+                close(file);
+                throw std::runtime_error("Failed to write the file of a memory image");
+            }
+            written += result;
+        }
+    }
+#else
+    contents.assign(memory.data(), memory.data() + size_bytes);
+#endif
+}
+
+MemoryImage::~MemoryImage() {
+#if LINEAR_MEMORY_MAPS_IMAGES
+    // Memories that mapped the file keep it alive on their own
+    close(file);
+#endif
+}
+
+uint32_t MemoryImage::pages() const {
+    return size_bytes / PAGE_SIZE;
+}
+
+LinearMemory::LinearMemory(std::shared_ptr<const MemoryImage> image, uint32_t maximum_pages)
+    : LinearMemory(image->pages(), maximum_pages) {
+    this->image = std::move(image);
+    load_image();
+}
+
+void LinearMemory::load_image() {
+    if (image->size_bytes == 0) {
+        return;
+    }
+#if LINEAR_MEMORY_MAPS_IMAGES
+    // Replaces the zeroed pages at the start of the reservation by a private view of the file
+    if (mmap(base, image->size_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, image->file, 0) == MAP_FAILED) {
+        throw std::runtime_error("Failed to map a memory image");
+    }
+#else
+    std::memcpy(base, image->contents.data(), image->size_bytes);
+#endif
+}
+
+#if LINEAR_MEMORY_RESERVES_ADDRESS_SPACE
+
+LinearMemory::LinearMemory(uint32_t initial_pages, uint32_t maximum_pages)
+    : initial_pages(initial_pages), maximum_pages(maximum_pages) {
+    reserved_bytes = static_cast<size_t>(maximum_pages) * PAGE_SIZE;
+#if WASM_GUARD_PAGE_MEMORY
+    if (!checks_bounds()) {
+        install_fault_handler();
+        reserved_bytes = GUARDED_RESERVATION;
+    }
+#endif
+
+    if (reserved_bytes > 0) {
+        void* reservation = mmap(nullptr, reserved_bytes, PROT_NONE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (reservation == MAP_FAILED) {
+            throw std::runtime_error("Failed to reserve address space for linear memory");
+        }
+        base = static_cast<uint8_t*>(reservation);
+    }
+
+    if (grow(initial_pages) < 0) {
+        if (base != nullptr) {
+            munmap(base, reserved_bytes);
+        }
+        throw std::runtime_error("Failed to allocate linear memory");
+    }
+}
+
+LinearMemory::~LinearMemory() {
+    if (base != nullptr) {
+        munmap(base, reserved_bytes);
+    }
+}
+
+int32_t LinearMemory::grow(uint32_t delta_pages) {
+    uint32_t old_pages = pages();
+    if (delta_pages > maximum_pages - old_pages) {
+        return -1;
+    }
+    if (delta_pages == 0) {
+        return old_pages;
+    }
+
+    // The pages behind the current end are already reserved and fresh anonymous pages read as
+    // zero, so growing is a single mprotect over the new pages: nothing is moved or cleared.
+    size_t delta_bytes = static_cast<size_t>(delta_pages) * PAGE_SIZE;
+    if (mprotect(base + size_bytes, delta_bytes, PROT_READ | PROT_WRITE) != 0) {
+        return -1;
+    }
+    size_bytes += delta_bytes;
+    return old_pages;
+}
+
+void LinearMemory::reset() {
+    size_t initial_bytes = static_cast<size_t>(initial_pages) * PAGE_SIZE;
+    if (size_bytes > initial_bytes) {
+        if (mprotect(base + initial_bytes, size_bytes - initial_bytes, PROT_NONE) != 0) {
+            throw std::runtime_error("Failed to release grown linear memory");
+        }
+    }
+
+    // Dropped pages of a private mapping read as zero again on the next access, or as the
+    // image when they map its file. Elsewhere MADV_DONTNEED may keep the contents, so the
+    // range is replaced by a new mapping.
+    if (size_bytes > 0) {
+#ifdef __linux__
+        bool released = madvise(base, size_bytes, MADV_DONTNEED) == 0;
+#else
+        bool released = mmap(base, size_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+                             -1, 0) != MAP_FAILED;
+        if (released && mprotect(base, std::min(size_bytes, initial_bytes), PROT_READ | PROT_WRITE) != 0) {
+            throw std::runtime_error("Failed to restore linear memory");
+        }
+#endif
+        if (!released) {
+            std::memset(base, 0, std::min(size_bytes, initial_bytes));
+        }
+        if (image != nullptr && (!released || !LINEAR_MEMORY_MAPS_IMAGES)) {
+            load_image();
+        }
+    }
+    size_bytes = initial_bytes;
+}
+
+#else
+
+LinearMemory::LinearMemory(uint32_t initial_pages, uint32_t maximum_pages)
+    : initial_pages(initial_pages), maximum_pages(maximum_pages) {
+    if (grow(initial_pages) < 0) {
+        throw std::runtime_error("Failed to allocate linear memory");
+    }
+}
+
+LinearMemory::~LinearMemory() {
+    std::free(base);
+}
+
+int32_t LinearMemory::grow(uint32_t delta_pages) {
+    uint32_t old_pages = pages();
+    if (delta_pages > maximum_pages - old_pages) {
+        return -1;
+    }
+    if (delta_pages == 0) {
+        return old_pages;
+    }
+
+    size_t new_size = size_bytes + static_cast<size_t>(delta_pages) * PAGE_SIZE;
+    void* grown = std::realloc(base, new_size);
+    if (grown == nullptr) {
+        return -1;
+    }
+    base = static_cast<uint8_t*>(grown);
+    std::memset(base + size_bytes, 0, new_size - size_bytes);
+    size_bytes = new_size;
+    reserved_bytes = new_size;
+    return old_pages;
+}
+
+void LinearMemory::reset() {
+    size_t initial_bytes = static_cast<size_t>(initial_pages) * PAGE_SIZE;
+    if (initial_bytes == 0) {
+        std::free(base);
+        base = nullptr;
+    } else {
+        // Should shrinking fail, the larger block is kept, which is harmless
+        if (size_bytes > initial_bytes) {
+            if (void* shrunk = std::realloc(base, initial_bytes)) {
+                base = static_cast<uint8_t*>(shrunk);
+            }
+        }
+        std::memset(base, 0, initial_bytes);
+    }
+    size_bytes = initial_bytes;
+    reserved_bytes = initial_bytes;
+    if (image != nullptr) {
+        load_image();
+    }
+}
+
+#endif
+
+#if WASM_GUARD_PAGE_MEMORY
+
+void LinearMemory::install_fault_handler() {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        struct sigaction action{};
+        action.sa_sigaction = handle_fault;
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGSEGV, &action, &previous_segv_action);
+        sigaction(SIGBUS, &action, &previous_bus_action);
+    });
+}
+
+void LinearMemory::handle_fault(int signal, siginfo_t* info, void* context) {
+    FaultScope* scope = active_fault_scope;
+    if (scope != nullptr) {
+        const uint8_t* address = static_cast<const uint8_t*>(info->si_addr);
+        const LinearMemory* memory = scope->memory;
+        if (address >= memory->base && address < memory->base + memory->reserved_bytes) {
+#ifdef LINEAR_MEMORY_TAG_REGISTER
+            // A guarded access holds its tag in r11 (see guarded_load)
+            memory->fault_tag = reinterpret_cast<const void*>(static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_R11]);
+#endif
+            siglongjmp(*scope->jump_buffer, 1);
+        }
+    }
+
+    // Not a wasm memory access: hand the fault to whoever handled it before us
+    const struct sigaction& previous = (signal == SIGSEGV) ? previous_segv_action : previous_bus_action;
+    if (previous.sa_flags & SA_SIGINFO) {
+        previous.sa_sigaction(signal, info, context);
+    } else if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN) {
+        previous.sa_handler(signal);
+    } else {
+        // Returning re-executes the faulting instruction, which now gets the default action
+        sigaction(signal, &previous, nullptr);
+    }
+}
+
+#endif
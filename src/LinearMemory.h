@@ -0,0 +1,294 @@
+#ifndef LINEAR_MEMORY_H
+#define LINEAR_MEMORY_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <stdexcept>
+#include <vector>
+
+#ifndef WASM_GUARD_PAGE_MEMORY
+#define WASM_GUARD_PAGE_MEMORY 0
+#endif
+
+#if WASM_GUARD_PAGE_MEMORY
+#include <csetjmp>
+#include <signal.h>
+#endif
+
+static constexpr size_t PAGE_SIZE = 65536;
+
+// A 32-bit memory can address at most 4 GiB
+static constexpr uint32_t MAX_PAGES = 65536;
+
+class LinearMemory;
+
+/**
+ * @class MemoryImage
+ * @brief The saved contents of a linear memory, which new memories can start out with.
+ *
+ * On Linux the contents are written once into an anonymous memory file, in which pages that
+ * were never written stay holes. Memories map the file copy-on-write, so starting from an
+ * image costs a single mmap however large it is, and pages are only copied when an instance
+ * writes to them. Elsewhere the image keeps a copy of the contents, which every memory copies.
+ * An image is immutable and can be shared between threads.
+ */
+class MemoryImage {
+public:
+    /**
+     * @brief Saves the current contents of a memory.
+     * @throws std::runtime_error if the memory file cannot be created.
+     */
+    explicit MemoryImage(const LinearMemory& memory);
+    ~MemoryImage();
+
+    MemoryImage(const MemoryImage&) = delete;
+    MemoryImage& operator=(const MemoryImage&) = delete;
+
+    /**
+     * @brief The size of the saved memory in pages.
+     */
+    uint32_t pages() const;
+
+private:
+    friend class LinearMemory;
+
+    size_t size_bytes;
+    int file = -1;                 // The memory file, where images are mapped
+    std::vector<uint8_t> contents; // The copy of the contents, where they are not
+};
+
+/**
+ * @class LinearMemory
+ * @brief The linear memory of a module instance, addressed in bytes and grown in 64 KiB pages.
+ *
+ * On 64-bit POSIX systems the memory reserves the address space for its maximum size when it
+ * is created and never moves: growing only makes the next pages accessible, which costs time
+ * in the number of new pages and leaves the existing contents untouched. Other platforms use
+ * a heap block that is reallocated on growth.
+ *
+ * With WASM_GUARD_PAGE_MEMORY, the memory reserves all the address space that a load or store
+ * can reach (a 32-bit address plus a 32-bit offset) as inaccessible pages up front, and only
+ * makes the pages up to the current size accessible. Every out-of-bounds access then faults in
+ * hardware, and `run_trapping_faults` turns that fault into a wasm trap, so the interpreter can
+ * access memory without bounds checks. That reservation is 8 GiB whatever the memory's size, so
+ * a memory whose maximum is at most CHECKED_MAXIMUM_PAGES only reserves its maximum, as without
+ * guard pages, and a module without a memory (a maximum of 0) reserves nothing. Without guard
+ * pages, the interpreter checks every access (see checks_bounds).
+ *
+ * A memory created from a MemoryImage starts out with the image's size and contents instead
+ * of zeros, and goes back to them on reset.
+ */
+class LinearMemory {
+public:
+    /**
+     * @brief Allocates a memory of the given size, filled with zeros.
+     * @param initial_pages The initial size in pages.
+     * @param maximum_pages The size in pages the memory may never grow beyond.
+     */
+    explicit LinearMemory(uint32_t initial_pages, uint32_t maximum_pages = MAX_PAGES);
+
+    /**
+     * @brief Creates a memory with the size and contents of an image.
+     * @param image The saved contents, which the memory holds on to.
+     * @param maximum_pages The size in pages the memory may never grow beyond, at least the image's size.
+     */
+    LinearMemory(std::shared_ptr<const MemoryImage> image, uint32_t maximum_pages);
+    ~LinearMemory();
+
+    LinearMemory(const LinearMemory&) = delete;
+    LinearMemory& operator=(const LinearMemory&) = delete;
+
+    /**
+     * @brief Whether the accesses to a memory with a maximum size must be checked, as it has no guard pages.
+     */
+    static constexpr bool checks_bounds(uint32_t maximum_pages) {
+        return !WASM_GUARD_PAGE_MEMORY || maximum_pages <= CHECKED_MAXIMUM_PAGES;
+    }
+
+    bool checks_bounds() const { return checks_bounds(maximum_pages); }
+
+    // Memories that can grow to at most this many pages (256 MiB) are checked rather than guarded
+    static constexpr uint32_t CHECKED_MAXIMUM_PAGES = 4096;
+
+    uint8_t* data() { return base; }
+    const uint8_t* data() const { return base; }
+
+    /**
+     * @brief The current size in bytes.
+     */
+    size_t size() const { return size_bytes; }
+
+    /**
+     * @brief The current size in pages.
+     */
+    uint32_t pages() const { return size_bytes / PAGE_SIZE; }
+
+    /**
+     * @brief Grows the memory by a number of pages, the new pages are filled with zeros.
+     * @param delta_pages The number of pages to add.
+     * @return The previous size in pages, or -1 if the new size would exceed the maximum
+     *         or the pages cannot be committed. The memory is unchanged in that case.
+     */
+    int32_t grow(uint32_t delta_pages);
+
+    /**
+     * @brief Returns the memory to its initial size and contents (zeros or its image), as if it were new.
+     *
+     * With a reserved address range, the pages are handed back to the kernel rather than
+     * cleared, so the cost is in the pages that were written, and the memory stays in place.
+     * The pages of a mapped image read as the image again.
+     * @throws std::runtime_error if the pages beyond the initial size cannot be released.
+     */
+    void reset();
+
+    /**
+     * @brief Runs `body` and stops it when it faults on an access to this memory.
+     *
+     * Without WASM_GUARD_PAGE_MEMORY the body is just called. The body must not own objects
+     * with non-trivial destructors across a memory access, as the fault unwinds without them.
+     * @return false if the body was stopped by a fault, which is an out of bounds trap.
+     */
+    template <typename Body>
+    bool run_trapping_faults(Body&& body);
+
+#if WASM_GUARD_PAGE_MEMORY
+    /**
+     * @brief A load or store with no bounds check, for a memory whose guard pages catch the
+     * accesses past its end (see checks_bounds).
+     *
+     * When the access faults, run_trapping_faults returns false and faulting_access() returns
+     * `tag`. On x86-64 the tag is only held in a register during the access, from which the fault
+     * handler reads it, so the access costs nothing over a plain one.
+     */
+    template <typename T>
+    T guarded_load(uint64_t address, const void* tag) const;
+
+    template <typename T>
+    void guarded_store(uint64_t address, T value, const void* tag);
+
+    /**
+     * @brief The tag of the guarded access that made the last run_trapping_faults return false.
+     * Compiled code tags its accesses with their wasm PC in the same register.
+     */
+    const void* faulting_access() const { return fault_tag; }
+#endif
+
+private:
+    uint8_t* base = nullptr;
+    size_t size_bytes = 0;
+    size_t reserved_bytes = 0;
+    uint32_t initial_pages;
+    uint32_t maximum_pages;
+    std::shared_ptr<const MemoryImage> image; // The initial contents, or nullptr for zeros
+
+    // Makes the first pages of the memory hold the image, on top of zeroed pages
+    void load_image();
+
+#if WASM_GUARD_PAGE_MEMORY
+    mutable const void* fault_tag = nullptr; // Set by the fault handler, or by guarded accesses where it cannot read it
+
+    // The active memory and its jump target, per thread, for the fault handler
+    struct FaultScope {
+        const LinearMemory* memory;
+        sigjmp_buf* jump_buffer;
+        FaultScope* previous;
+    };
+
+    static thread_local FaultScope* active_fault_scope;
+
+    static void install_fault_handler();
+    static void handle_fault(int signal, siginfo_t* info, void* context);
+#endif
+};
+
+template <typename Body>
+bool LinearMemory::run_trapping_faults(Body&& body) {
+#if WASM_GUARD_PAGE_MEMORY
+    sigjmp_buf jump_buffer;
+    FaultScope scope{this, &jump_buffer, active_fault_scope};
+
+    // The fault handler jumps back here. It runs with SA_NODEFER and an empty sa_mask, so the
+    // signal mask is unchanged and saving it (a system call on every invoke) is not needed.
+    if (sigsetjmp(jump_buffer, 0) != 0) {
+        active_fault_scope = scope.previous;
+        return false;
+    }
+
+    active_fault_scope = &scope;
+    try {
+        body();
+    } catch (...) {
+        active_fault_scope = scope.previous;
+        throw;
+    }
+    active_fault_scope = scope.previous;
+#else
+    body();
+#endif
+    return true;
+}
+
+#if WASM_GUARD_PAGE_MEMORY
+#if defined(__x86_64__)
+// The register that holds the tag of a guarded access while it runs, where the fault handler finds it
+#define LINEAR_MEMORY_TAG_REGISTER "r11"
+
+template <typename T>
+T LinearMemory::guarded_load(uint64_t address, const void* tag) const {
+    using Bits [[gnu::may_alias]] = std::conditional_t<sizeof(T) == 8, uint64_t, std::conditional_t<sizeof(T) == 4, uint32_t,
+                                     std::conditional_t<sizeof(T) == 2, uint16_t, uint8_t>>>;
+    const Bits& bytes = *reinterpret_cast<const Bits*>(base + address);
+    register const void* tag_register asm(LINEAR_MEMORY_TAG_REGISTER) = tag;
+    uint64_t bits;
+    if constexpr (sizeof(T) == 8) {
+        asm volatile("movq %1, %q0" : "=r"(bits) : "m"(bytes), "r"(tag_register));
+    } else if constexpr (sizeof(T) == 4) {
+        asm volatile("movl %1, %k0" : "=r"(bits) : "m"(bytes), "r"(tag_register));
+    } else if constexpr (sizeof(T) == 2) {
+        asm volatile("movzwl %1, %k0" : "=r"(bits) : "m"(bytes), "r"(tag_register));
+    } else {
+        asm volatile("movzbl %1, %k0" : "=r"(bits) : "m"(bytes), "r"(tag_register));
+    }
+    return std::bit_cast<T>(static_cast<Bits>(bits));
+}
+
+template <typename T>
+void LinearMemory::guarded_store(uint64_t address, T value, const void* tag) {
+    using Bits [[gnu::may_alias]] = std::conditional_t<sizeof(T) == 8, uint64_t, std::conditional_t<sizeof(T) == 4, uint32_t,
+                                     std::conditional_t<sizeof(T) == 2, uint16_t, uint8_t>>>;
+    Bits& bytes = *reinterpret_cast<Bits*>(base + address);
+    register const void* tag_register asm(LINEAR_MEMORY_TAG_REGISTER) = tag;
+    uint64_t bits = std::bit_cast<Bits>(value);
+    if constexpr (sizeof(T) == 8) {
+        asm volatile("movq %q1, %0" : "=m"(bytes) : "r"(bits), "r"(tag_register));
+    } else if constexpr (sizeof(T) == 4) {
+        asm volatile("movl %k1, %0" : "=m"(bytes) : "r"(bits), "r"(tag_register));
+    } else if constexpr (sizeof(T) == 2) {
+        asm volatile("movw %w1, %0" : "=m"(bytes) : "r"(bits), "r"(tag_register));
+    } else {
+        asm volatile("movb %b1, %0" : "=m"(bytes) : "r"(bits), "r"(tag_register));
+    }
+}
+#else
+// Elsewhere the tag is written before every access
+template <typename T>
+T LinearMemory::guarded_load(uint64_t address, const void* tag) const {
+    fault_tag = tag;
+    T value;
+    std::memcpy(&value, base + address, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void LinearMemory::guarded_store(uint64_t address, T value, const void* tag) {
+    fault_tag = tag;
+    std::memcpy(base + address, &value, sizeof(T));
+}
+#endif
+#endif
+
+#endif //LINEAR_MEMORY_H
@@ -3,7 +3,11 @@
 
 #include <vector>
 #include <cstdint>
-#include <string>
+#include <memory>
+#include <span>
+#include <string_view>
+
+#include "ModuleArena.h"
 
 /**
  * @brief Represents the value types in WebAssembly.
@@ -13,6 +17,8 @@ enum class ValueType : uint8_t {
     I64 = 0x7e,
     F32 = 0x7d,
     F64 = 0x7c,
+    FUNCREF = 0x70,
+    EXTERNREF = 0x6f,
 };
 
 /**
@@ -28,10 +34,14 @@ union Value {
 /**
  * @brief Represents a function signature (parameter types and result types).
  * This corresponds to an entry in the Type Section (ID 1).
+ *
+ * The types of all signatures are interned in one pool in the module's arena: equal
+ * signatures share their types and their canonical index, the index of the first of them.
  */
 struct FunctionType {
-    std::vector<ValueType> params;
-    std::vector<ValueType> results;
+    std::span<const ValueType> params;
+    std::span<const ValueType> results;
+    uint32_t canonical_index = 0; // Equal for two types exactly if they are the same signature.
 };
 
 /**
@@ -45,14 +55,138 @@ struct GlobalType {
 };
 
 /**
- * @brief Represents a single, complete function, combining its signature
- * and its actual executable code.
- * This is populated from the Function Section (ID 3) and the Code Section (ID 10).
+ * @brief Opcodes behind the 0xFC prefix are stored as PREFIX_FC + sub-opcode,
+ * so every decoded opcode fits into a single, dense 16-bit space.
+ */
+static constexpr uint16_t PREFIX_FC = 0x100;
+
+/**
+ * @brief Represents a single pre-decoded instruction.
+ *
+ * All LEB128 immediates are decoded once at load time, so the interpreter can
+ * read them directly instead of re-decoding the raw bytecode on every execution.
+ * For block, loop and if, `a` holds the index of the matching end and `b` the index
+ * right after the matching else (0 if there is none); for else, `a` holds the end.
+ */
+struct Instruction {
+    uint16_t opcode; // The wasm opcode (see PREFIX_FC for prefixed opcodes).
+    uint32_t a;      // First immediate: index, label, memarg offset, ...
+    uint32_t b;      // Second immediate: memarg alignment, table index, ...
+    Value value;     // Constant immediate (i32/i64/f32/f64.const) or block type.
+};
+
+/**
+ * @brief Opcodes that only exist in register code. They follow all decoded wasm opcodes,
+ * so wasm and register opcodes share one dense 16-bit space.
+ */
+static constexpr uint16_t REG_COPY = 0x120;         // r = a
+static constexpr uint16_t REG_JUMP = 0x121;         // Continue at imm
+static constexpr uint16_t REG_JUMP_IF = 0x122;      // Continue at imm if a is not zero
+static constexpr uint16_t REG_JUMP_UNLESS = 0x123;  // Continue at imm if a is zero
+static constexpr uint16_t REG_LOOP_JUMP = 0x124;    // Continue at the loop header imm; b is the loop's PC in the wasm code
+static constexpr uint16_t REG_LOOP_JUMP_IF = 0x125; // The same, if a is not zero
+static constexpr uint16_t REG_BR_TABLE = 0x126;     // Continue at branch_table[imm + min(a, b)]
+
+/**
+ * @brief Superinstructions that the Fuser makes of common sequences of register code, as a
+ * base that the opcode of the instruction they are made of is added to.
+ */
+static constexpr uint16_t REG_WITH_IMMEDIATE = 0x200;         // A binary numeric opcode with the constant imm as b
+static constexpr uint16_t REG_COMPARE_JUMP = 0x300;           // An integer comparison: continue at r if it holds for a and b
+static constexpr uint16_t REG_COMPARE_IMMEDIATE_JUMP = 0x380; // The same, comparing a with the constant imm
+
+/**
+ * @brief Represents a single instruction of register code.
+ *
+ * In register code every operand is a slot of the function's frame in the value stack:
+ * the locals come first, followed by one slot per operand stack height. Instructions read
+ * their operands from slots `a` and `b` and write their result to slot `r`, so values are
+ * never pushed or popped, and local.get and local.set mostly disappear. Numeric, constant,
+ * load and store instructions keep their wasm opcode, with the memarg offset in `imm`.
+ * select keeps its opcode with the condition slot in `imm`, global.get and global.set with
+ * the global index in `imm`, call with the first argument slot in `r` (where the callee's
+ * results end up) and the function index in `imm`, and return with the `b` results starting
+ * at slot `a`. Blocks turn into the jumps listed above, with targets in `imm`.
+ */
+struct RegisterInstruction {
+    uint16_t opcode; // A wasm opcode or one of the REG_ opcodes.
+    uint32_t r;      // The result slot.
+    uint32_t a;      // The first operand slot.
+    uint32_t b;      // The second operand slot, or a count.
+    Value imm;       // Constant, memarg offset, jump target, function or global index.
+};
+
+/**
+ * @brief A run of locals of the same type, as the Code section declares them.
+ */
+struct LocalDeclaration {
+    uint32_t count;
+    ValueType type;
+};
+
+/**
+ * @brief The sizes of a function's frame in the value stack, which is all a call needs to know
+ * about its callee besides the register code.
  */
-struct Function {
-    uint32_t type_index; // An index into the Module's 'types' vector.
-    std::vector<ValueType> locals; // A list of local variables.
-    std::vector<uint8_t> code; // The raw bytecode of the function body.
+struct FrameLayout {
+    uint32_t param_count = 0;      // The number of parameters of the type.
+    uint32_t local_count = 0;      // The number of locals after the parameters.
+    uint32_t result_count = 0;     // The number of results of the type.
+    uint32_t max_stack_height = 0; // Highest operand stack height above the locals, set by the Validator.
+};
+
+/**
+ * @brief The functions of a module, populated from the Function Section (ID 3) and the Code
+ * Section (ID 10).
+ *
+ * Every field of the functions is an array of its own in the module's arena, indexed by the
+ * function index, so a call only touches the frame layout and the register code of its callee:
+ * four frame layouts share a cache line, and the arrays that are only needed to compile a
+ * function, or to map register code back to wasm instructions, stay out of the way. The type
+ * of a function is in Module::function_type_indices. The views of a function are filled in
+ * once it is compiled (see FunctionCode).
+ */
+struct FunctionTable {
+    std::span<FrameLayout> frames; // What a call reads, together with the register code.
+    std::span<std::span<const RegisterInstruction>> register_code; // The body as register code, set by the Translator.
+    std::span<std::span<const uint32_t>> register_branch_table; // The jump targets of all br_table instructions in register code.
+
+    std::span<std::span<const LocalDeclaration>> local_declarations; // The locals after the parameters, run-length encoded.
+    std::span<std::span<const uint8_t>> code; // The raw bytecode of the function body, in the module's binary.
+    std::span<std::span<const Instruction>> instructions; // The pre-decoded function body.
+    std::span<std::span<const uint32_t>> branch_table; // The label lists of all br_table instructions.
+    std::span<std::span<const uint32_t>> register_origins; // For each register instruction, the index of the wasm instruction it came from.
+
+    size_t size() const { return frames.size(); }
+
+    /**
+     * @brief Allocates the arrays for a number of functions in an arena, all of them empty.
+     */
+    void allocate(ModuleArena& arena, size_t count) {
+        frames = arena.allocate<FrameLayout>(count);
+        register_code = arena.allocate<std::span<const RegisterInstruction>>(count);
+        register_branch_table = arena.allocate<std::span<const uint32_t>>(count);
+        local_declarations = arena.allocate<std::span<const LocalDeclaration>>(count);
+        code = arena.allocate<std::span<const uint8_t>>(count);
+        instructions = arena.allocate<std::span<const Instruction>>(count);
+        branch_table = arena.allocate<std::span<const uint32_t>>(count);
+        register_origins = arena.allocate<std::span<const uint32_t>>(count);
+    }
+};
+
+/**
+ * @brief The code of a function while it is compiled, before it is copied into the module's arena.
+ *
+ * The Decoder, Validator, Translator and Fuser build the arrays one after the other and
+ * change their sizes as they go, so they work on this and not on the FunctionTable.
+ */
+struct FunctionCode {
+    std::vector<Instruction> instructions;
+    std::vector<uint32_t> branch_table;
+    uint32_t max_stack_height = 0;
+    std::vector<RegisterInstruction> register_code;
+    std::vector<uint32_t> register_branch_table;
+    std::vector<uint32_t> register_origins;
 };
 
 /**
@@ -60,31 +194,56 @@ struct Function {
  * This corresponds to an entry in the Export Section (ID 7).
  */
 struct Export {
-    std::string name;
+    std::string_view name; // In the module's binary.
     uint8_t kind; // The kind of export: 0=func, 1=table, 2=mem, 3=global
     uint32_t index; // The index into the corresponding space (e.g., function index).
 };
 
+/**
+ * @brief Represents a data segment, a range of bytes that initializes linear memory.
+ * This corresponds to an entry in the Data Section (ID 11).
+ */
+struct DataSegment {
+    bool is_active;                 // Active segments are written to memory at instantiation, passive ones only by memory.init.
+    uint32_t memory_offset = 0;     // Where an active segment starts in memory.
+    std::span<const uint8_t> bytes; // The contents, which point into the binary the module was parsed from.
+};
+
 
 /**
  * @class Module
  * @brief A static, in-memory representation of a parsed .wasm file.
  *
  * This class acts as a blueprint, holding all the definitions that are read from the binary file.
+ * Every array of it is in its arena, where each section is copied in one go once it is parsed.
  */
 class Module {
 public:
-    std::vector<FunctionType> types;
+    std::unique_ptr<ModuleArena> arena = std::make_unique<ModuleArena>();
+
+    std::span<FunctionType> types;
 
-    std::vector<uint32_t> function_type_indices;
+    std::span<const uint32_t> function_type_indices; // The type of every function, an index into types.
+
+    bool has_memory = false;
 
     uint32_t memory_initial_pages = 0;
 
-    std::vector<GlobalType> globals;
+    uint32_t memory_max_pages = 65536; // The declared maximum, or 65536 pages (4 GiB) if there is none.
+
+    std::span<const ValueType> tables; // The element type (funcref or externref) of every table.
+
+    uint32_t element_segment_count = 0;
+
+    uint32_t data_segment_count = 0;
+
+    std::span<DataSegment> data_segments;
+
+    std::span<const GlobalType> globals;
 
-    std::vector<Export> exports;
+    std::span<Export> exports;
 
-    std::vector<Function> functions;
+    FunctionTable functions;
 };
 
 #endif //MODULE_H
\ No newline at end of file
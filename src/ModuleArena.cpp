@@ -0,0 +1,35 @@
+#include "ModuleArena.h"
+#include <utility>
+
+void ModuleArena::adopt(ModuleBinary mapping) {
+    std::lock_guard<std::mutex> lock(mutex);
+    mappings.push_back(std::move(mapping));
+}
+
+size_t ModuleArena::allocated_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return allocated;
+}
+
+void* ModuleArena::allocate_bytes(size_t size, size_t alignment) {
+    std::lock_guard<std::mutex> lock(mutex);
+    allocated += size;
+
+    // A new chunk is aligned for every type (see __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    if (size >= CHUNK_SIZE / 4) {
+        chunks.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+        return chunks.back().get();
+    }
+
+    auto address = reinterpret_cast<uintptr_t>(free_begin);
+    size_t padding = (alignment - address % alignment) % alignment;
+    if (free_begin == nullptr || static_cast<size_t>(free_end - free_begin) < padding + size) {
+        chunks.push_back(std::make_unique_for_overwrite<std::byte[]>(CHUNK_SIZE));
+        free_begin = chunks.back().get();
+        free_end = free_begin + CHUNK_SIZE;
+        padding = 0;
+    }
+    void* memory = free_begin + padding;
+    free_begin += padding + size;
+    return memory;
+}
@@ -0,0 +1,94 @@
+#ifndef MODULE_ARENA_H
+#define MODULE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "ModuleBinary.h"
+
+/**
+ * @class ModuleArena
+ * @brief The memory that holds every array of a Module: its sections, type signatures, local declarations and code.
+ *
+ * Arrays are copied in once they are final and stay where they are for the lifetime of the
+ * arena, which moves along with its Module, so a Module holds plain views into it. They are
+ * packed into large chunks one after the other, so a module has a few allocations instead of
+ * several per function, and the arrays of a function end up next to each other.
+ *
+ * Functions compiled on several threads, or lazily while the module runs, copy their code in
+ * concurrently, which a mutex serializes. An arena can also take over a mapped file, such as a
+ * ModuleCache artifact, for views that point right into the mapping.
+ */
+class ModuleArena {
+public:
+    ModuleArena() = default;
+
+    ModuleArena(const ModuleArena&) = delete;
+    ModuleArena& operator=(const ModuleArena&) = delete;
+
+    /**
+     * @brief Copies an array into the arena.
+     * @return A view of the copy, or an empty view if the array is empty.
+     */
+    template <typename T>
+    std::span<T> copy(std::span<const T> values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (values.empty()) {
+            return {};
+        }
+        void* memory = allocate_bytes(values.size_bytes(), alignof(T));
+        std::memcpy(memory, values.data(), values.size_bytes());
+        return {static_cast<T*>(memory), values.size()};
+    }
+
+    template <typename T>
+    std::span<T> copy(const std::vector<T>& values) {
+        return copy(std::span<const T>(values));
+    }
+
+    /**
+     * @brief Allocates an array of value-initialized elements in the arena, to be filled in later.
+     * @return A view of the array, or an empty view if the count is zero.
+     */
+    template <typename T>
+    std::span<T> allocate(size_t count) {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+        if (count == 0) {
+            return {};
+        }
+        T* values = static_cast<T*>(allocate_bytes(count * sizeof(T), alignof(T)));
+        std::uninitialized_value_construct_n(values, count);
+        return {values, count};
+    }
+
+    /**
+     * @brief Keeps a mapped file alive as long as the arena, for views into it.
+     */
+    void adopt(ModuleBinary mapping);
+
+    /**
+     * @brief The bytes taken by the arrays copied in so far, without the unused rest of the chunks.
+     */
+    size_t allocated_bytes() const;
+
+private:
+    // Arrays of at least a quarter of a chunk get a chunk of their own, so little of a chunk is wasted
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<std::byte[]>> chunks;
+    std::byte* free_begin = nullptr; // The unused rest of the last chunk
+    std::byte* free_end = nullptr;
+    size_t allocated = 0;
+    std::vector<ModuleBinary> mappings;
+
+    void* allocate_bytes(size_t size, size_t alignment);
+};
+
+#endif //MODULE_ARENA_H
@@ -0,0 +1,71 @@
+#include "ModuleBinary.h"
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MODULE_BINARY_MAPS_FILES 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define MODULE_BINARY_MAPS_FILES 0
+#include <fstream>
+#include <iterator>
+#endif
+
+ModuleBinary::ModuleBinary(std::vector<uint8_t> bytes)
+    : data(bytes.data()), size(bytes.size()), owned(std::move(bytes)) {}
+
+ModuleBinary::ModuleBinary(const uint8_t* mapping, size_t size) : data(mapping), size(size), mapped(true) {}
+
+ModuleBinary::ModuleBinary(ModuleBinary&& other) noexcept
+    : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)),
+      mapped(std::exchange(other.mapped, false)), owned(std::move(other.owned)) {}
+
+ModuleBinary::~ModuleBinary() {
+#if MODULE_BINARY_MAPS_FILES
+    if (mapped) {
+        munmap(const_cast<uint8_t*>(data), size);
+    }
+#endif
+}
+
+#if MODULE_BINARY_MAPS_FILES
+
+ModuleBinary ModuleBinary::map_file(const std::string& path) {
+    int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0) {
+        close(file);
+        throw std::runtime_error("Failed to read the size of file: " + path);
+    }
+
+    // An empty file cannot be mapped, and is rejected by the parser anyway
+    size_t size = static_cast<size_t>(status.st_size);
+    if (size == 0) {
+        close(file);
+        return ModuleBinary(std::vector<uint8_t>{});
+    }
+
+    // The mapping holds on to the file by itself
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+    return ModuleBinary(static_cast<const uint8_t*>(mapping), size);
+}
+
+#else
+
+ModuleBinary ModuleBinary::map_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("Failed to open file: " + path);
+    return ModuleBinary(std::vector<uint8_t>{(std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()});
+}
+
+#endif
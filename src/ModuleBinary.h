@@ -0,0 +1,51 @@
+#ifndef MODULE_BINARY_H
+#define MODULE_BINARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * @class ModuleBinary
+ * @brief The bytes of a wasm file, which a parsed module points into instead of copying them.
+ *
+ * On POSIX systems a file is mapped read-only rather than read, so loading it copies nothing
+ * and its pages are only read in as the parser reaches them. Bytes that are already in memory
+ * can be handed over as a vector. Moving a ModuleBinary leaves the bytes where they are, so
+ * spans into them stay valid.
+ */
+class ModuleBinary {
+public:
+    /**
+     * @brief Maps a wasm file into memory.
+     * @param path The path of the file.
+     * @throws std::runtime_error if the file cannot be opened or mapped.
+     */
+    static ModuleBinary map_file(const std::string& path);
+
+    /**
+     * @param bytes The raw bytes of the wasm file, which the ModuleBinary takes over.
+     */
+    explicit ModuleBinary(std::vector<uint8_t> bytes);
+
+    ModuleBinary(ModuleBinary&& other) noexcept;
+    ~ModuleBinary();
+
+    ModuleBinary(const ModuleBinary&) = delete;
+    ModuleBinary& operator=(const ModuleBinary&) = delete;
+    ModuleBinary& operator=(ModuleBinary&&) = delete;
+
+    std::span<const uint8_t> bytes() const { return {data, size}; }
+
+private:
+    ModuleBinary(const uint8_t* mapping, size_t size);
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;        // True if data is a mapping of the file, which the ModuleBinary unmaps
+    std::vector<uint8_t> owned; // The bytes, if they were not mapped
+};
+
+#endif //MODULE_BINARY_H
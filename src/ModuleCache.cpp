@@ -0,0 +1,466 @@
+#include "ModuleCache.h"
+#include "ModuleBinary.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Leads every artifact, followed by the version and the layout it was written with
+constexpr char ARTIFACT_MAGIC[8] = {'W', 'A', 'S', 'M', 'C', 'A', 'C', 'H'};
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Arrays start at multiples of this, so an artifact mapped at a page boundary has them aligned
+constexpr size_t ARRAY_ALIGNMENT = 8;
+
+struct ArtifactHeader {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t byte_order;                // BYTE_ORDER_MARK, as the writing machine stores it
+    uint32_t instruction_size;          // sizeof(Instruction)
+    uint32_t register_instruction_size; // sizeof(RegisterInstruction)
+    uint64_t artifact_size;             // The size of the whole file, so one that was cut short is noticed
+    uint64_t binary_size;
+    uint64_t binary_hash[2];
+    uint64_t contents_hash[2];          // Of everything after the header, so a corrupted artifact is noticed
+};
+
+ArtifactHeader expected_header(std::span<const uint8_t> binary, const uint64_t (&hash)[2]) {
+    ArtifactHeader header{};
+    std::memcpy(header.magic, ARTIFACT_MAGIC, sizeof(ARTIFACT_MAGIC));
+    header.format_version = ModuleCache::FORMAT_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.instruction_size = sizeof(Instruction);
+    header.register_instruction_size = sizeof(RegisterInstruction);
+    header.binary_size = binary.size();
+    header.binary_hash[0] = hash[0];
+    header.binary_hash[1] = hash[1];
+    return header;
+}
+
+uint64_t rotate_left(uint64_t value, int bits) {
+    return value << bits | value >> (64 - bits);
+}
+
+// The finalizer of MurmurHash3, which spreads every input bit over the whole result
+uint64_t mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+/**
+ * @brief Hashes the binary to 128 bits, eight bytes per step on two independent lanes.
+ *
+ * Not a cryptographic hash: it names artifacts and notices corrupted ones, but binaries made to
+ * collide are told apart by the copy of the binary every artifact holds.
+ */
+void hash_binary(std::span<const uint8_t> binary, uint64_t (&hash)[2]) {
+    uint64_t first = 0x9e3779b97f4a7c15ULL ^ binary.size();
+    uint64_t second = 0xc2b2ae3d27d4eb4fULL + binary.size();
+    size_t position = 0;
+    for (; position + 8 <= binary.size(); position += 8) {
+        uint64_t word;
+        std::memcpy(&word, binary.data() + position, 8);
+        first = rotate_left(first ^ word * 0x87c37b91114253d5ULL, 31) * 0x4cf5ad432745937fULL;
+        second = rotate_left(second + word * 0x52dce729da3ed7b5ULL, 27) * 0x38495ab5ULL + first;
+    }
+    // The size is in both lanes already, so a tail padded with zeros is unambiguous
+    uint64_t tail = 0;
+    if (position < binary.size()) {
+        std::memcpy(&tail, binary.data() + position, binary.size() - position);
+    }
+    first = mix(first ^ tail * 0x87c37b91114253d5ULL);
+    second = mix(second + tail);
+    hash[0] = first + second;
+    hash[1] = second + hash[0];
+}
+
+class ArtifactWriter {
+public:
+    explicit ArtifactWriter(std::span<const uint8_t> binary) : binary(binary) {}
+
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        append(&value, sizeof(T));
+    }
+
+    template <typename T>
+    void put_array(std::span<const T> values) {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= ARRAY_ALIGNMENT);
+        put<uint64_t>(values.size());
+        bytes.resize((bytes.size() + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT);
+        append(values.data(), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    void put_array(const std::vector<T>& values) {
+        put_array(std::span<const T>(values));
+    }
+
+    // An array of structs with padding, written member by member with zeros in between, so that
+    // equal modules give equal artifacts whatever the padding in their arrays happens to hold
+    template <typename T, typename... Members>
+    void put_struct_array(std::span<const T> values, Members T::*... members) {
+        static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= ARRAY_ALIGNMENT);
+        put<uint64_t>(values.size());
+        bytes.resize((bytes.size() + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT);
+        size_t begin = bytes.size();
+        bytes.resize(begin + values.size() * sizeof(T), 0);
+        for (size_t i = 0; i < values.size(); ++i) {
+            uint8_t* element = bytes.data() + begin + i * sizeof(T);
+            (put_member(element, values[i], values[i].*members), ...);
+        }
+    }
+
+    // A range of the binary, stored as its offset and size
+    void put_range(const void* data, size_t size) {
+        put<uint64_t>(size == 0 ? 0 : static_cast<const uint8_t*>(data) - binary.data());
+        put<uint64_t>(size);
+    }
+
+    std::vector<uint8_t> bytes;
+
+private:
+    std::span<const uint8_t> binary;
+
+    template <typename T, typename Member>
+    static void put_member(uint8_t* element, const T& value, const Member& member) {
+        size_t offset = reinterpret_cast<const uint8_t*>(&member) - reinterpret_cast<const uint8_t*>(&value);
+        std::memcpy(element + offset, &member, sizeof(Member));
+    }
+
+    void append(const void* data, size_t size) {
+        const uint8_t* begin = static_cast<const uint8_t*>(data);
+        bytes.insert(bytes.end(), begin, begin + size);
+    }
+};
+
+class ArtifactReader {
+public:
+    ArtifactReader(std::span<const uint8_t> artifact, std::span<const uint8_t> binary, size_t position, ModuleArena& arena)
+        : artifact(artifact), binary(binary), position(position), arena(arena) {}
+
+    template <typename T>
+    T get() {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    // A view of the array in the artifact itself, which the module's arena keeps mapped
+    template <typename T>
+    std::span<const T> get_array() {
+        uint64_t count = get<uint64_t>();
+        position = (position + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT;
+        if (position > artifact.size() || count > (artifact.size() - position) / sizeof(T)) {
+            throw std::runtime_error("Module cache artifact is cut short.");
+        }
+        const uint8_t* data = take(count * sizeof(T));
+        if (count == 0) {
+            return {};
+        }
+        // Mapped artifacts start at a page, but one read into memory need not be aligned as well
+        if (reinterpret_cast<uintptr_t>(data) % alignof(T) != 0) {
+            std::vector<T> copy(count);
+            std::memcpy(copy.data(), data, count * sizeof(T));
+            return arena.copy(copy);
+        }
+        return {reinterpret_cast<const T*>(data), static_cast<size_t>(count)};
+    }
+
+    std::span<const uint8_t> get_range() {
+        uint64_t offset = get<uint64_t>();
+        uint64_t size = get<uint64_t>();
+        if (offset > binary.size() || size > binary.size() - offset) {
+            throw std::runtime_error("Module cache artifact points outside the binary.");
+        }
+        return binary.subspan(offset, size);
+    }
+
+    bool at_end() const { return position == artifact.size(); }
+
+private:
+    std::span<const uint8_t> artifact;
+    std::span<const uint8_t> binary;
+    size_t position;
+    ModuleArena& arena;
+
+    const uint8_t* take(size_t size) {
+        if (position > artifact.size() || size > artifact.size() - position) {
+            throw std::runtime_error("Module cache artifact is cut short.");
+        }
+        const uint8_t* data = artifact.data() + position;
+        position += size;
+        return data;
+    }
+};
+
+// The types of the signatures again in one pool, each canonical signature once
+void write_types(ArtifactWriter& writer, const Module& module) {
+    std::vector<ValueType> pool;
+    std::vector<uint64_t> offsets(module.types.size());
+    for (uint32_t i = 0; i < module.types.size(); ++i) {
+        const FunctionType& type = module.types[i];
+        if (type.canonical_index == i) {
+            offsets[i] = pool.size();
+            pool.insert(pool.end(), type.params.begin(), type.params.end());
+            pool.insert(pool.end(), type.results.begin(), type.results.end());
+        } else {
+            offsets[i] = offsets[type.canonical_index];
+        }
+    }
+    writer.put_array(pool);
+    writer.put<uint32_t>(module.types.size());
+    for (uint32_t i = 0; i < module.types.size(); ++i) {
+        writer.put(offsets[i]);
+        writer.put<uint32_t>(module.types[i].params.size());
+        writer.put<uint32_t>(module.types[i].results.size());
+        writer.put(module.types[i].canonical_index);
+    }
+}
+
+void read_types(ArtifactReader& reader, Module& module) {
+    std::span<const ValueType> pool = reader.get_array<ValueType>();
+    module.types = module.arena->allocate<FunctionType>(reader.get<uint32_t>());
+    for (uint32_t i = 0; i < module.types.size(); ++i) {
+        FunctionType& type = module.types[i];
+        uint64_t offset = reader.get<uint64_t>();
+        uint32_t param_count = reader.get<uint32_t>();
+        uint32_t result_count = reader.get<uint32_t>();
+        type.canonical_index = reader.get<uint32_t>();
+        if (offset > pool.size() || uint64_t{param_count} + result_count > pool.size() - offset ||
+            type.canonical_index > i) {
+            throw std::runtime_error("Module cache artifact has an invalid type.");
+        }
+        if (param_count + result_count != 0) {
+            type.params = pool.subspan(offset, param_count);
+            type.results = pool.subspan(offset + param_count, result_count);
+        }
+    }
+}
+
+void write_module(ArtifactWriter& writer, const Module& module) {
+    write_types(writer, module);
+    writer.put_array(module.function_type_indices);
+
+    writer.put<uint8_t>(module.has_memory);
+    writer.put(module.memory_initial_pages);
+    writer.put(module.memory_max_pages);
+    writer.put_array(module.tables);
+    writer.put(module.element_segment_count);
+    writer.put(module.data_segment_count);
+
+    writer.put<uint32_t>(module.data_segments.size());
+    for (const DataSegment& segment : module.data_segments) {
+        writer.put<uint8_t>(segment.is_active);
+        writer.put(segment.memory_offset);
+        writer.put_range(segment.bytes.data(), segment.bytes.size());
+    }
+
+    writer.put<uint32_t>(module.globals.size());
+    for (const GlobalType& global : module.globals) {
+        writer.put(global.type);
+        writer.put<uint8_t>(global.is_mutable);
+        writer.put(global.initial_value);
+    }
+
+    writer.put<uint32_t>(module.exports.size());
+    for (const Export& exported : module.exports) {
+        writer.put_range(exported.name.data(), exported.name.size());
+        writer.put(exported.kind);
+        writer.put(exported.index);
+    }
+
+    const FunctionTable& functions = module.functions;
+    writer.put<uint32_t>(functions.size());
+    for (uint32_t i = 0; i < functions.size(); ++i) {
+        writer.put_range(functions.code[i].data(), functions.code[i].size());
+        writer.put(functions.frames[i].local_count);
+        writer.put(functions.frames[i].max_stack_height);
+        writer.put_struct_array(functions.local_declarations[i], &LocalDeclaration::count, &LocalDeclaration::type);
+        writer.put_struct_array(functions.instructions[i], &Instruction::opcode, &Instruction::a, &Instruction::b,
+                                &Instruction::value);
+        writer.put_array(functions.branch_table[i]);
+        writer.put_struct_array(functions.register_code[i], &RegisterInstruction::opcode, &RegisterInstruction::r,
+                                &RegisterInstruction::a, &RegisterInstruction::b, &RegisterInstruction::imm);
+        writer.put_array(functions.register_branch_table[i]);
+        writer.put_array(functions.register_origins[i]);
+    }
+}
+
+// Reads the module write_module wrote, checking the indices the interpreter uses without checks of its own
+void read_module(ArtifactReader& reader, Module& module) {
+    read_types(reader, module);
+    module.function_type_indices = reader.get_array<uint32_t>();
+    for (uint32_t type_index : module.function_type_indices) {
+        if (type_index >= module.types.size()) {
+            throw std::runtime_error("Module cache artifact has an invalid type index.");
+        }
+    }
+
+    module.has_memory = reader.get<uint8_t>() != 0;
+    module.memory_initial_pages = reader.get<uint32_t>();
+    module.memory_max_pages = reader.get<uint32_t>();
+    module.tables = reader.get_array<ValueType>();
+    module.element_segment_count = reader.get<uint32_t>();
+    module.data_segment_count = reader.get<uint32_t>();
+
+    module.data_segments = module.arena->allocate<DataSegment>(reader.get<uint32_t>());
+    for (DataSegment& segment : module.data_segments) {
+        segment.is_active = reader.get<uint8_t>() != 0;
+        segment.memory_offset = reader.get<uint32_t>();
+        segment.bytes = reader.get_range();
+    }
+
+    std::span<GlobalType> globals = module.arena->allocate<GlobalType>(reader.get<uint32_t>());
+    for (GlobalType& global : globals) {
+        global.type = reader.get<ValueType>();
+        global.is_mutable = reader.get<uint8_t>() != 0;
+        global.initial_value = reader.get<Value>();
+    }
+    module.globals = globals;
+
+    module.exports = module.arena->allocate<Export>(reader.get<uint32_t>());
+    for (Export& exported : module.exports) {
+        std::span<const uint8_t> name = reader.get_range();
+        exported.name = std::string_view(reinterpret_cast<const char*>(name.data()), name.size());
+        exported.kind = reader.get<uint8_t>();
+        exported.index = reader.get<uint32_t>();
+    }
+
+    uint32_t num_functions = reader.get<uint32_t>();
+    if (num_functions != module.function_type_indices.size()) {
+        throw std::runtime_error("Module cache artifact is inconsistent.");
+    }
+    FunctionTable& functions = module.functions;
+    functions.allocate(*module.arena, num_functions);
+    for (uint32_t i = 0; i < num_functions; ++i) {
+        const FunctionType& type = module.types[module.function_type_indices[i]];
+        FrameLayout& frame = functions.frames[i];
+        functions.code[i] = reader.get_range();
+        frame.param_count = type.params.size();
+        frame.local_count = reader.get<uint32_t>();
+        frame.result_count = type.results.size();
+        frame.max_stack_height = reader.get<uint32_t>();
+        functions.local_declarations[i] = reader.get_array<LocalDeclaration>();
+        functions.instructions[i] = reader.get_array<Instruction>();
+        functions.branch_table[i] = reader.get_array<uint32_t>();
+        functions.register_code[i] = reader.get_array<RegisterInstruction>();
+        functions.register_branch_table[i] = reader.get_array<uint32_t>();
+        functions.register_origins[i] = reader.get_array<uint32_t>();
+    }
+
+    if (!reader.at_end()) {
+        throw std::runtime_error("Module cache artifact is inconsistent.");
+    }
+}
+
+} // namespace
+
+ModuleCache::ModuleCache(std::string directory) : directory(std::move(directory)) {}
+
+std::string ModuleCache::artifact_path(std::span<const uint8_t> binary) const {
+    uint64_t hash[2];
+    hash_binary(binary, hash);
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    std::string name;
+    for (uint64_t half : hash) {
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            name += HEX_DIGITS[half >> shift & 0xf];
+        }
+    }
+    return (std::filesystem::path(directory) / (name + ".wasmc")).string();
+}
+
+std::optional<Module> ModuleCache::load(std::span<const uint8_t> binary) const {
+    uint64_t hash[2];
+    hash_binary(binary, hash);
+    ArtifactHeader expected = expected_header(binary, hash);
+
+    try {
+        ModuleBinary artifact = ModuleBinary::map_file(artifact_path(binary));
+        std::span<const uint8_t> bytes = artifact.bytes();
+        if (bytes.size() < sizeof(ArtifactHeader)) {
+            return std::nullopt;
+        }
+        ArtifactHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        expected.artifact_size = bytes.size();
+        expected.contents_hash[0] = header.contents_hash[0];
+        expected.contents_hash[1] = header.contents_hash[1];
+        if (std::memcmp(&header, &expected, sizeof(header)) != 0) {
+            return std::nullopt; // Another version or build, another binary, or cut short
+        }
+        hash_binary(bytes.subspan(sizeof(ArtifactHeader)), expected.contents_hash);
+        if (std::memcmp(&header, &expected, sizeof(header)) != 0) {
+            return std::nullopt; // Corrupted
+        }
+        Module module;
+        ArtifactReader reader(bytes, binary, sizeof(ArtifactHeader), *module.arena);
+        // Two binaries with the same hash must not share an artifact
+        std::span<const uint8_t> stored_binary = reader.get_array<uint8_t>();
+        if (!std::ranges::equal(stored_binary, binary)) {
+            return std::nullopt;
+        }
+        read_module(reader, module);
+        module.arena->adopt(std::move(artifact));
+        return module;
+    } catch (const std::runtime_error&) {
+        return std::nullopt; // Missing or unreadable, so the module is compiled and stored again
+    }
+}
+
+bool ModuleCache::store(std::span<const uint8_t> binary, const Module& module) const {
+    uint64_t hash[2];
+    hash_binary(binary, hash);
+    ArtifactWriter writer(binary);
+    writer.put(expected_header(binary, hash));
+    writer.put_array(binary);
+    write_module(writer, module);
+    uint64_t artifact_size = writer.bytes.size();
+    std::memcpy(writer.bytes.data() + offsetof(ArtifactHeader, artifact_size), &artifact_size, sizeof(artifact_size));
+    uint64_t contents_hash[2];
+    hash_binary(std::span<const uint8_t>(writer.bytes).subspan(sizeof(ArtifactHeader)), contents_hash);
+    std::memcpy(writer.bytes.data() + offsetof(ArtifactHeader, contents_hash), contents_hash, sizeof(contents_hash));
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        return false;
+    }
+
+    // A name of its own per writer, so concurrent writers of the same artifact do not mix their bytes
+    std::string path = artifact_path(binary);
+    std::string temporary_path = path + ".tmp" +
+        std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+                       static_cast<size_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(writer.bytes.data()), static_cast<std::streamsize>(writer.bytes.size()));
+        if (!file.flush()) {
+            file.close();
+            std::filesystem::remove(temporary_path, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        std::filesystem::remove(temporary_path, error);
+        return false;
+    }
+    return true;
+}
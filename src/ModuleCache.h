@@ -0,0 +1,70 @@
+#ifndef MODULE_CACHE_H
+#define MODULE_CACHE_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+
+#include "Module.h"
+
+/**
+ * @class ModuleCache
+ * @brief A directory of compiled modules, so that a module compiled once is loaded instead of compiled again.
+ *
+ * Every entry is an artifact file named after a 128-bit hash of the wasm binary. It holds the
+ * whole processed module: the types, the decoded and register code of every function with its
+ * branch tables, the exports, globals and data segments. Function bodies, export names and data
+ * segments point into the binary by offset, as in a parsed module, so loading needs the binary.
+ * The artifact also holds a copy of the binary, which loading compares with the binary it is
+ * given: the hash names the artifact, but two binaries with the same hash never share one.
+ *
+ * An artifact is a flat image with every array at an aligned offset, and zeros wherever the
+ * structs in the arrays have padding, so a module always gives the same artifact. Loading maps
+ * it and points the arrays of the module right into the mapping, which the module's arena
+ * keeps: nothing is copied, there is no LEB128 to decode, no pointer to relocate, and no
+ * validation or translation. The header holds a format version, which any change to Module, the Decoder, the
+ * Translator or the Fuser that changes what they produce must increase, the layout of the
+ * instruction structs, and a hash of the rest of the artifact. An artifact written by a
+ * different version or build, for a different binary, cut short or corrupted is ignored and
+ * written anew.
+ *
+ * The interpreter runs the register code of an artifact as it is, so the cache directory must
+ * be as trusted as the interpreter itself. Artifacts are written to a temporary file and then
+ * renamed, so processes that share a directory never see half of one.
+ */
+class ModuleCache {
+public:
+    /**
+     * @param directory The directory of the artifacts, created when the first one is stored.
+     */
+    explicit ModuleCache(std::string directory);
+
+    /**
+     * @brief Loads the compiled module of a binary, if an artifact for it is in the cache.
+     * @param binary The wasm binary, which the spans of the module point into.
+     * @return The module, validated and translated as Parser::parse_into leaves it, or nothing.
+     */
+    std::optional<Module> load(std::span<const uint8_t> binary) const;
+
+    /**
+     * @brief Writes the artifact of a compiled module, replacing any there is for its binary.
+     * @param binary The wasm binary the module was parsed from.
+     * @param module The module, with every function validated and translated.
+     * @return False if the artifact could not be written, which leaves the cache as it was.
+     */
+    bool store(std::span<const uint8_t> binary, const Module& module) const;
+
+    /**
+     * @brief The path of the artifact of a binary, whether or not it exists.
+     */
+    std::string artifact_path(std::span<const uint8_t> binary) const;
+
+    // Increased whenever the artifacts that store() writes change
+    static constexpr uint32_t FORMAT_VERSION = 5;
+
+private:
+    std::string directory;
+};
+
+#endif //MODULE_CACHE_H
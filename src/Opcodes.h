@@ -0,0 +1,402 @@
+#ifndef OPCODES_H
+#define OPCODES_H
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "cross_platform.h"
+#include "Module.h"
+#include "Trap.h"
+
+/*
+ * Helpers for numeric instructions whose WebAssembly semantics differ from the plain C++ operator:
+ * integer division traps, float-to-int truncation traps or saturates, and min/max propagate NaN
+ * and order -0 below +0. The kernels of trapping instructions expect their trap check (see
+ * WASM_NUMERIC_TRAPS) to have passed.
+ */
+
+template <typename T>
+TrapCode wasm_division_trap(T b) {
+    return b == 0 ? TRAP_DIVIDE_BY_ZERO : TRAP_NONE;
+}
+
+template <typename T>
+TrapCode wasm_signed_division_trap(T a, T b) {
+    if (b == 0) return TRAP_DIVIDE_BY_ZERO;
+    if (a == std::numeric_limits<T>::min() && b == -1) return TRAP_INTEGER_OVERFLOW;
+    return TRAP_NONE;
+}
+
+template <typename T>
+T wasm_div_s(T a, T b) {
+    return a / b;
+}
+
+template <typename T>
+T wasm_div_u(T a, T b) {
+    using U = std::make_unsigned_t<T>;
+    return static_cast<T>(static_cast<U>(a) / static_cast<U>(b));
+}
+
+template <typename T>
+T wasm_rem_s(T a, T b) {
+    // INT_MIN % -1 overflows in C++, but is defined as 0 in WebAssembly
+    return (b == -1) ? 0 : a % b;
+}
+
+template <typename T>
+T wasm_rem_u(T a, T b) {
+    using U = std::make_unsigned_t<T>;
+    return static_cast<T>(static_cast<U>(a) % static_cast<U>(b));
+}
+
+// The exclusive upper bound of an integer type as a float, i.e. 2^31, 2^32, 2^63 or 2^64
+template <typename Int, typename Float>
+constexpr Float integer_upper_bound() {
+    return static_cast<Float>(std::numeric_limits<Int>::max() / 2 + 1) * 2;
+}
+
+template <typename Int, typename Float>
+TrapCode wasm_trunc_trap(Float value) {
+    if (std::isnan(value)) return TRAP_INVALID_CONVERSION;
+    Float truncated = std::trunc(value);
+    if (truncated < static_cast<Float>(std::numeric_limits<Int>::min()) ||
+        truncated >= integer_upper_bound<Int, Float>()) {
+        return TRAP_INTEGER_OVERFLOW;
+    }
+    return TRAP_NONE;
+}
+
+template <typename Int, typename Float>
+Int wasm_trunc(Float value) {
+    return static_cast<Int>(std::trunc(value));
+}
+
+template <typename Int, typename Float>
+Int wasm_trunc_sat(Float value) {
+    if (std::isnan(value)) return 0;
+    Float truncated = std::trunc(value);
+    if (truncated < static_cast<Float>(std::numeric_limits<Int>::min())) return std::numeric_limits<Int>::min();
+    if (truncated >= integer_upper_bound<Int, Float>()) return std::numeric_limits<Int>::max();
+    return static_cast<Int>(truncated);
+}
+
+template <typename T>
+T wasm_min(T a, T b) {
+    if (std::isnan(a) || std::isnan(b)) return std::numeric_limits<T>::quiet_NaN();
+    if (a == b) return std::signbit(a) ? a : b;
+    return a < b ? a : b;
+}
+
+template <typename T>
+T wasm_max(T a, T b) {
+    if (std::isnan(a) || std::isnan(b)) return std::numeric_limits<T>::quiet_NaN();
+    if (a == b) return std::signbit(a) ? b : a;
+    return a > b ? a : b;
+}
+
+/*
+ * The numeric opcode table: every arithmetic, comparison and conversion instruction as
+ *
+ *     X(opcode, name, shape, Operand, Result, expression)
+ *
+ * `shape` is `unary` (operand `a`) or `binary` (operands `a` and `b`), and `expression`
+ * computes the result from the operands. For every row a kernel struct `name##_kernel`
+ * is generated below, and the interpreter generates one handler per row, so each
+ * instruction is a fully inlined pop/compute/push sequence.
+ */
+#define WASM_NUMERIC_OPCODES(X) \
+    X(0x45, i32_eqz,    unary,  int32_t, int32_t, a == 0) \
+    X(0x46, i32_eq,     binary, int32_t, int32_t, a == b) \
+    X(0x47, i32_ne,     binary, int32_t, int32_t, a != b) \
+    X(0x48, i32_lt_s,   binary, int32_t, int32_t, a < b) \
+    X(0x49, i32_lt_u,   binary, int32_t, int32_t, static_cast<uint32_t>(a) < static_cast<uint32_t>(b)) \
+    X(0x4A, i32_gt_s,   binary, int32_t, int32_t, a > b) \
+    X(0x4B, i32_gt_u,   binary, int32_t, int32_t, static_cast<uint32_t>(a) > static_cast<uint32_t>(b)) \
+    X(0x4C, i32_le_s,   binary, int32_t, int32_t, a <= b) \
+    X(0x4D, i32_le_u,   binary, int32_t, int32_t, static_cast<uint32_t>(a) <= static_cast<uint32_t>(b)) \
+    X(0x4E, i32_ge_s,   binary, int32_t, int32_t, a >= b) \
+    X(0x4F, i32_ge_u,   binary, int32_t, int32_t, static_cast<uint32_t>(a) >= static_cast<uint32_t>(b)) \
+    \
+    X(0x50, i64_eqz,    unary,  int64_t, int32_t, a == 0) \
+    X(0x51, i64_eq,     binary, int64_t, int32_t, a == b) \
+    X(0x52, i64_ne,     binary, int64_t, int32_t, a != b) \
+    X(0x53, i64_lt_s,   binary, int64_t, int32_t, a < b) \
+    X(0x54, i64_lt_u,   binary, int64_t, int32_t, static_cast<uint64_t>(a) < static_cast<uint64_t>(b)) \
+    X(0x55, i64_gt_s,   binary, int64_t, int32_t, a > b) \
+    X(0x56, i64_gt_u,   binary, int64_t, int32_t, static_cast<uint64_t>(a) > static_cast<uint64_t>(b)) \
+    X(0x57, i64_le_s,   binary, int64_t, int32_t, a <= b) \
+    X(0x58, i64_le_u,   binary, int64_t, int32_t, static_cast<uint64_t>(a) <= static_cast<uint64_t>(b)) \
+    X(0x59, i64_ge_s,   binary, int64_t, int32_t, a >= b) \
+    X(0x5A, i64_ge_u,   binary, int64_t, int32_t, static_cast<uint64_t>(a) >= static_cast<uint64_t>(b)) \
+    \
+    X(0x5B, f32_eq,     binary, float,   int32_t, a == b) \
+    X(0x5C, f32_ne,     binary, float,   int32_t, a != b) \
+    X(0x5D, f32_lt,     binary, float,   int32_t, a < b) \
+    X(0x5E, f32_gt,     binary, float,   int32_t, a > b) \
+    X(0x5F, f32_le,     binary, float,   int32_t, a <= b) \
+    X(0x60, f32_ge,     binary, float,   int32_t, a >= b) \
+    \
+    X(0x61, f64_eq,     binary, double,  int32_t, a == b) \
+    X(0x62, f64_ne,     binary, double,  int32_t, a != b) \
+    X(0x63, f64_lt,     binary, double,  int32_t, a < b) \
+    X(0x64, f64_gt,     binary, double,  int32_t, a > b) \
+    X(0x65, f64_le,     binary, double,  int32_t, a <= b) \
+    X(0x66, f64_ge,     binary, double,  int32_t, a >= b) \
+    \
+    X(0x67, i32_clz,    unary,  int32_t, int32_t, a ? clz32(a) : 32) \
+    X(0x68, i32_ctz,    unary,  int32_t, int32_t, a ? ctz32(a) : 32) \
+    X(0x69, i32_popcnt, unary,  int32_t, int32_t, std::popcount(static_cast<uint32_t>(a))) \
+    X(0x6A, i32_add,    binary, int32_t, int32_t, static_cast<uint32_t>(a) + static_cast<uint32_t>(b)) \
+    X(0x6B, i32_sub,    binary, int32_t, int32_t, static_cast<uint32_t>(a) - static_cast<uint32_t>(b)) \
+    X(0x6C, i32_mul,    binary, int32_t, int32_t, static_cast<uint32_t>(a) * static_cast<uint32_t>(b)) \
+    X(0x6D, i32_div_s,  binary, int32_t, int32_t, wasm_div_s(a, b)) \
+    X(0x6E, i32_div_u,  binary, int32_t, int32_t, wasm_div_u(a, b)) \
+    X(0x6F, i32_rem_s,  binary, int32_t, int32_t, wasm_rem_s(a, b)) \
+    X(0x70, i32_rem_u,  binary, int32_t, int32_t, wasm_rem_u(a, b)) \
+    X(0x71, i32_and,    binary, int32_t, int32_t, a & b) \
+    X(0x72, i32_or,     binary, int32_t, int32_t, a | b) \
+    X(0x73, i32_xor,    binary, int32_t, int32_t, a ^ b) \
+    X(0x74, i32_shl,    binary, int32_t, int32_t, static_cast<uint32_t>(a) << (b & 31)) \
+    X(0x75, i32_shr_s,  binary, int32_t, int32_t, a >> (b & 31)) \
+    X(0x76, i32_shr_u,  binary, int32_t, int32_t, static_cast<uint32_t>(a) >> (b & 31)) \
+    X(0x77, i32_rotl,   binary, int32_t, int32_t, std::rotl(static_cast<uint32_t>(a), b & 31)) \
+    X(0x78, i32_rotr,   binary, int32_t, int32_t, std::rotr(static_cast<uint32_t>(a), b & 31)) \
+    \
+    X(0x79, i64_clz,    unary,  int64_t, int64_t, a ? clz64(a) : 64) \
+    X(0x7A, i64_ctz,    unary,  int64_t, int64_t, a ? ctz64(a) : 64) \
+    X(0x7B, i64_popcnt, unary,  int64_t, int64_t, std::popcount(static_cast<uint64_t>(a))) \
+    X(0x7C, i64_add,    binary, int64_t, int64_t, static_cast<uint64_t>(a) + static_cast<uint64_t>(b)) \
+    X(0x7D, i64_sub,    binary, int64_t, int64_t, static_cast<uint64_t>(a) - static_cast<uint64_t>(b)) \
+    X(0x7E, i64_mul,    binary, int64_t, int64_t, static_cast<uint64_t>(a) * static_cast<uint64_t>(b)) \
+    X(0x7F, i64_div_s,  binary, int64_t, int64_t, wasm_div_s(a, b)) \
+    X(0x80, i64_div_u,  binary, int64_t, int64_t, wasm_div_u(a, b)) \
+    X(0x81, i64_rem_s,  binary, int64_t, int64_t, wasm_rem_s(a, b)) \
+    X(0x82, i64_rem_u,  binary, int64_t, int64_t, wasm_rem_u(a, b)) \
+    X(0x83, i64_and,    binary, int64_t, int64_t, a & b) \
+    X(0x84, i64_or,     binary, int64_t, int64_t, a | b) \
+    X(0x85, i64_xor,    binary, int64_t, int64_t, a ^ b) \
+    X(0x86, i64_shl,    binary, int64_t, int64_t, static_cast<uint64_t>(a) << (b & 63)) \
+    X(0x87, i64_shr_s,  binary, int64_t, int64_t, a >> (b & 63)) \
+    X(0x88, i64_shr_u,  binary, int64_t, int64_t, static_cast<uint64_t>(a) >> (b & 63)) \
+    X(0x89, i64_rotl,   binary, int64_t, int64_t, std::rotl(static_cast<uint64_t>(a), static_cast<int>(b & 63))) \
+    X(0x8A, i64_rotr,   binary, int64_t, int64_t, std::rotr(static_cast<uint64_t>(a), static_cast<int>(b & 63))) \
+    \
+    X(0x8B, f32_abs,      unary,  float,  float,  std::fabs(a)) \
+    X(0x8C, f32_neg,      unary,  float,  float,  -a) \
+    X(0x8D, f32_ceil,     unary,  float,  float,  std::ceil(a)) \
+    X(0x8E, f32_floor,    unary,  float,  float,  std::floor(a)) \
+    X(0x8F, f32_trunc,    unary,  float,  float,  std::trunc(a)) \
+    X(0x90, f32_nearest,  unary,  float,  float,  std::nearbyint(a)) \
+    X(0x91, f32_sqrt,     unary,  float,  float,  std::sqrt(a)) \
+    X(0x92, f32_add,      binary, float,  float,  a + b) \
+    X(0x93, f32_sub,      binary, float,  float,  a - b) \
+    X(0x94, f32_mul,      binary, float,  float,  a * b) \
+    X(0x95, f32_div,      binary, float,  float,  a / b) \
+    X(0x96, f32_min,      binary, float,  float,  wasm_min(a, b)) \
+    X(0x97, f32_max,      binary, float,  float,  wasm_max(a, b)) \
+    X(0x98, f32_copysign, binary, float,  float,  std::copysign(a, b)) \
+    \
+    X(0x99, f64_abs,      unary,  double, double, std::fabs(a)) \
+    X(0x9A, f64_neg,      unary,  double, double, -a) \
+    X(0x9B, f64_ceil,     unary,  double, double, std::ceil(a)) \
+    X(0x9C, f64_floor,    unary,  double, double, std::floor(a)) \
+    X(0x9D, f64_trunc,    unary,  double, double, std::trunc(a)) \
+    X(0x9E, f64_nearest,  unary,  double, double, std::nearbyint(a)) \
+    X(0x9F, f64_sqrt,     unary,  double, double, std::sqrt(a)) \
+    X(0xA0, f64_add,      binary, double, double, a + b) \
+    X(0xA1, f64_sub,      binary, double, double, a - b) \
+    X(0xA2, f64_mul,      binary, double, double, a * b) \
+    X(0xA3, f64_div,      binary, double, double, a / b) \
+    X(0xA4, f64_min,      binary, double, double, wasm_min(a, b)) \
+    X(0xA5, f64_max,      binary, double, double, wasm_max(a, b)) \
+    X(0xA6, f64_copysign, binary, double, double, std::copysign(a, b)) \
+    \
+    X(0xA7, i32_wrap_i64,        unary, int64_t, int32_t, static_cast<int32_t>(a)) \
+    X(0xA8, i32_trunc_f32_s,     unary, float,   int32_t, (wasm_trunc<int32_t, float>(a))) \
+    X(0xA9, i32_trunc_f32_u,     unary, float,   int32_t, (wasm_trunc<uint32_t, float>(a))) \
+    X(0xAA, i32_trunc_f64_s,     unary, double,  int32_t, (wasm_trunc<int32_t, double>(a))) \
+    X(0xAB, i32_trunc_f64_u,     unary, double,  int32_t, (wasm_trunc<uint32_t, double>(a))) \
+    X(0xAC, i64_extend_i32_s,    unary, int32_t, int64_t, static_cast<int64_t>(a)) \
+    X(0xAD, i64_extend_i32_u,    unary, int32_t, int64_t, static_cast<uint32_t>(a)) \
+    X(0xAE, i64_trunc_f32_s,     unary, float,   int64_t, (wasm_trunc<int64_t, float>(a))) \
+    X(0xAF, i64_trunc_f32_u,     unary, float,   int64_t, (wasm_trunc<uint64_t, float>(a))) \
+    X(0xB0, i64_trunc_f64_s,     unary, double,  int64_t, (wasm_trunc<int64_t, double>(a))) \
+    X(0xB1, i64_trunc_f64_u,     unary, double,  int64_t, (wasm_trunc<uint64_t, double>(a))) \
+    X(0xB2, f32_convert_i32_s,   unary, int32_t, float,   static_cast<float>(a)) \
+    X(0xB3, f32_convert_i32_u,   unary, int32_t, float,   static_cast<float>(static_cast<uint32_t>(a))) \
+    X(0xB4, f32_convert_i64_s,   unary, int64_t, float,   static_cast<float>(a)) \
+    X(0xB5, f32_convert_i64_u,   unary, int64_t, float,   static_cast<float>(static_cast<uint64_t>(a))) \
+    X(0xB6, f32_demote_f64,      unary, double,  float,   static_cast<float>(a)) \
+    X(0xB7, f64_convert_i32_s,   unary, int32_t, double,  static_cast<double>(a)) \
+    X(0xB8, f64_convert_i32_u,   unary, int32_t, double,  static_cast<double>(static_cast<uint32_t>(a))) \
+    X(0xB9, f64_convert_i64_s,   unary, int64_t, double,  static_cast<double>(a)) \
+    X(0xBA, f64_convert_i64_u,   unary, int64_t, double,  static_cast<double>(static_cast<uint64_t>(a))) \
+    X(0xBB, f64_promote_f32,     unary, float,   double,  static_cast<double>(a)) \
+    X(0xBC, i32_reinterpret_f32, unary, float,   int32_t, std::bit_cast<int32_t>(a)) \
+    X(0xBD, i64_reinterpret_f64, unary, double,  int64_t, std::bit_cast<int64_t>(a)) \
+    X(0xBE, f32_reinterpret_i32, unary, int32_t, float,   std::bit_cast<float>(a)) \
+    X(0xBF, f64_reinterpret_i64, unary, int64_t, double,  std::bit_cast<double>(a)) \
+    \
+    X(0xC0, i32_extend8_s,       unary, int32_t, int32_t, static_cast<int8_t>(a)) \
+    X(0xC1, i32_extend16_s,      unary, int32_t, int32_t, static_cast<int16_t>(a)) \
+    X(0xC2, i64_extend8_s,       unary, int64_t, int64_t, static_cast<int8_t>(a)) \
+    X(0xC3, i64_extend16_s,      unary, int64_t, int64_t, static_cast<int16_t>(a)) \
+    X(0xC4, i64_extend32_s,      unary, int64_t, int64_t, static_cast<int32_t>(a))
+
+/*
+ * The saturating truncations behind the 0xFC prefix, listed by their sub-opcode.
+ */
+#define WASM_PREFIXED_NUMERIC_OPCODES(X) \
+    X(0x00, i32_trunc_sat_f32_s, unary, float,  int32_t, (wasm_trunc_sat<int32_t, float>(a))) \
+    X(0x01, i32_trunc_sat_f32_u, unary, float,  int32_t, (wasm_trunc_sat<uint32_t, float>(a))) \
+    X(0x02, i32_trunc_sat_f64_s, unary, double, int32_t, (wasm_trunc_sat<int32_t, double>(a))) \
+    X(0x03, i32_trunc_sat_f64_u, unary, double, int32_t, (wasm_trunc_sat<uint32_t, double>(a))) \
+    X(0x04, i64_trunc_sat_f32_s, unary, float,  int64_t, (wasm_trunc_sat<int64_t, float>(a))) \
+    X(0x05, i64_trunc_sat_f32_u, unary, float,  int64_t, (wasm_trunc_sat<uint64_t, float>(a))) \
+    X(0x06, i64_trunc_sat_f64_s, unary, double, int64_t, (wasm_trunc_sat<int64_t, double>(a))) \
+    X(0x07, i64_trunc_sat_f64_u, unary, double, int64_t, (wasm_trunc_sat<uint64_t, double>(a)))
+
+/*
+ * The integer comparisons, each with the comparison that holds exactly when it does not:
+ *
+ *     X(opcode, name, negated_opcode)
+ *
+ * The Fuser folds them into the conditional jump on their result.
+ */
+#define WASM_INTEGER_COMPARE_OPCODES(X) \
+    X(0x46, i32_eq,   0x47) \
+    X(0x47, i32_ne,   0x46) \
+    X(0x48, i32_lt_s, 0x4E) \
+    X(0x49, i32_lt_u, 0x4F) \
+    X(0x4A, i32_gt_s, 0x4C) \
+    X(0x4B, i32_gt_u, 0x4D) \
+    X(0x4C, i32_le_s, 0x4A) \
+    X(0x4D, i32_le_u, 0x4B) \
+    X(0x4E, i32_ge_s, 0x48) \
+    X(0x4F, i32_ge_u, 0x49) \
+    X(0x51, i64_eq,   0x52) \
+    X(0x52, i64_ne,   0x51) \
+    X(0x53, i64_lt_s, 0x59) \
+    X(0x54, i64_lt_u, 0x5A) \
+    X(0x55, i64_gt_s, 0x57) \
+    X(0x56, i64_gt_u, 0x58) \
+    X(0x57, i64_le_s, 0x55) \
+    X(0x58, i64_le_u, 0x56) \
+    X(0x59, i64_ge_s, 0x53) \
+    X(0x5A, i64_ge_u, 0x54)
+
+/*
+ * The instructions of the numeric table that can trap, with the trap their operands raise:
+ *
+ *     X(name, shape, expression)
+ *
+ * `expression` computes a TrapCode from the operands, and the kernel of the instruction may
+ * only run when it is TRAP_NONE.
+ */
+#define WASM_NUMERIC_TRAPS(X) \
+    X(i32_div_s,       binary, wasm_signed_division_trap(a, b)) \
+    X(i32_div_u,       binary, wasm_division_trap(b)) \
+    X(i32_rem_s,       binary, wasm_division_trap(b)) \
+    X(i32_rem_u,       binary, wasm_division_trap(b)) \
+    X(i64_div_s,       binary, wasm_signed_division_trap(a, b)) \
+    X(i64_div_u,       binary, wasm_division_trap(b)) \
+    X(i64_rem_s,       binary, wasm_division_trap(b)) \
+    X(i64_rem_u,       binary, wasm_division_trap(b)) \
+    X(i32_trunc_f32_s, unary,  (wasm_trunc_trap<int32_t, float>(a))) \
+    X(i32_trunc_f32_u, unary,  (wasm_trunc_trap<uint32_t, float>(a))) \
+    X(i32_trunc_f64_s, unary,  (wasm_trunc_trap<int32_t, double>(a))) \
+    X(i32_trunc_f64_u, unary,  (wasm_trunc_trap<uint32_t, double>(a))) \
+    X(i64_trunc_f32_s, unary,  (wasm_trunc_trap<int64_t, float>(a))) \
+    X(i64_trunc_f32_u, unary,  (wasm_trunc_trap<uint64_t, float>(a))) \
+    X(i64_trunc_f64_s, unary,  (wasm_trunc_trap<int64_t, double>(a))) \
+    X(i64_trunc_f64_u, unary,  (wasm_trunc_trap<uint64_t, double>(a)))
+
+#define WASM_KERNEL_unary(name, Operand, Result, expression)          \
+    struct name##_kernel {                                            \
+        using operand_type = Operand;                                 \
+        using result_type = Result;                                   \
+        static Result apply(Operand a) {                              \
+            return static_cast<Result>(expression);                   \
+        }                                                             \
+    };
+
+#define WASM_KERNEL_binary(name, Operand, Result, expression)         \
+    struct name##_kernel {                                            \
+        using operand_type = Operand;                                 \
+        using result_type = Result;                                   \
+        static Result apply(Operand a, Operand b) {                   \
+            return static_cast<Result>(expression);                   \
+        }                                                             \
+    };
+
+#define WASM_DEFINE_KERNEL(opcode, name, shape, Operand, Result, expression) \
+    WASM_KERNEL_##shape(name, Operand, Result, expression)
+
+WASM_NUMERIC_OPCODES(WASM_DEFINE_KERNEL)
+WASM_PREFIXED_NUMERIC_OPCODES(WASM_DEFINE_KERNEL)
+
+#undef WASM_DEFINE_KERNEL
+#undef WASM_KERNEL_binary
+#undef WASM_KERNEL_unary
+
+/**
+ * @brief The trap check of a numeric kernel. Only the instructions in WASM_NUMERIC_TRAPS can
+ * trap, for all others the check is a constant the compiler drops.
+ */
+template <typename Kernel>
+struct NumericTrap {
+    template <typename... Operands>
+    static constexpr TrapCode check(Operands...) { return TRAP_NONE; }
+};
+
+#define WASM_TRAP_unary(name, expression)                                                   \
+    template <>                                                                             \
+    struct NumericTrap<name##_kernel> {                                                     \
+        static TrapCode check(name##_kernel::operand_type a) { return expression; }         \
+    };
+
+#define WASM_TRAP_binary(name, expression)                                                  \
+    template <>                                                                             \
+    struct NumericTrap<name##_kernel> {                                                     \
+        static TrapCode check([[maybe_unused]] name##_kernel::operand_type a,               \
+                              name##_kernel::operand_type b) { return expression; }         \
+    };
+
+#define WASM_DEFINE_TRAP(name, shape, expression) WASM_TRAP_##shape(name, expression)
+
+WASM_NUMERIC_TRAPS(WASM_DEFINE_TRAP)
+
+#undef WASM_DEFINE_TRAP
+#undef WASM_TRAP_binary
+#undef WASM_TRAP_unary
+
+/**
+ * @brief The number of operands of a numeric instruction from the tables above.
+ * @return 1 or 2, or 0 for any other instruction.
+ */
+constexpr uint32_t numeric_arity(uint16_t opcode) {
+    switch (opcode) {
+#define WASM_NUMERIC_ARITY_unary 1
+#define WASM_NUMERIC_ARITY_binary 2
+#define WASM_NUMERIC_ARITY(opcode, name, shape, Operand, Result, expression) \
+        case opcode: return WASM_NUMERIC_ARITY_##shape;
+#define WASM_PREFIXED_NUMERIC_ARITY(opcode, name, shape, Operand, Result, expression) \
+        case PREFIX_FC + opcode: return WASM_NUMERIC_ARITY_##shape;
+
+        WASM_NUMERIC_OPCODES(WASM_NUMERIC_ARITY)
+        WASM_PREFIXED_NUMERIC_OPCODES(WASM_PREFIXED_NUMERIC_ARITY)
+
+#undef WASM_PREFIXED_NUMERIC_ARITY
+#undef WASM_NUMERIC_ARITY
+#undef WASM_NUMERIC_ARITY_binary
+#undef WASM_NUMERIC_ARITY_unary
+        default:
+            return 0;
+    }
+}
+
+#endif //OPCODES_H
@@ -0,0 +1,126 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Runs `task(i)` for every i in [0, count) on up to `threads` threads, the calling thread included.
+ *
+ * The indices start out split into one contiguous range per thread. A thread takes indices
+ * from the front of its own range, and once that is empty steals the back half of another
+ * thread's range, so uneven tasks (a few huge functions among many small ones) still keep
+ * every thread busy. A range is a pair of 32-bit bounds in one 64-bit atomic, so taking and
+ * stealing are each a single compare-exchange.
+ *
+ * If tasks throw, the exception of the lowest index is rethrown once all threads are done,
+ * the same one a loop from 0 would have stopped at. Indices above a failed one are skipped.
+ */
+template <typename Task>
+void parallel_for(uint32_t count, uint32_t threads, const Task& task) {
+    threads = std::max(1u, std::min(threads, count));
+    if (threads == 1) {
+        for (uint32_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    // The range of indices still to take: begin in the low half, end in the high half
+    struct alignas(64) WorkRange {
+        std::atomic<uint64_t> bounds;
+    };
+    auto make_bounds = [](uint64_t begin, uint64_t end) { return end << 32 | begin; };
+
+    std::unique_ptr<WorkRange[]> ranges(new WorkRange[threads]);
+    for (uint32_t t = 0; t < threads; ++t) {
+        uint64_t begin = uint64_t{count} * t / threads;
+        uint64_t end = uint64_t{count} * (t + 1) / threads;
+        ranges[t].bounds.store(make_bounds(begin, end), std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> failed_index{UINT32_MAX};
+    std::exception_ptr failure;
+    std::mutex failure_mutex;
+
+    auto run = [&](uint32_t index) {
+        if (index > failed_index.load(std::memory_order_relaxed)) {
+            return;
+        }
+        try {
+            task(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(failure_mutex);
+            if (index < failed_index.load(std::memory_order_relaxed)) {
+                failed_index.store(index, std::memory_order_relaxed);
+                failure = std::current_exception();
+            }
+        }
+    };
+
+    auto work = [&](uint32_t self) {
+        std::atomic<uint64_t>& own = ranges[self].bounds;
+        while (true) {
+            uint64_t bounds = own.load(std::memory_order_acquire);
+            uint32_t begin = static_cast<uint32_t>(bounds), end = static_cast<uint32_t>(bounds >> 32);
+            if (begin < end) {
+                if (own.compare_exchange_weak(bounds, make_bounds(begin + 1, end), std::memory_order_acq_rel)) {
+                    run(begin);
+                }
+                continue;
+            }
+
+            // The own range is empty, which no other thread changes: steal into it
+            bool stole = false;
+            for (uint32_t offset = 1; offset < threads && !stole; ++offset) {
+                std::atomic<uint64_t>& victim = ranges[(self + offset) % threads].bounds;
+                uint64_t victim_bounds = victim.load(std::memory_order_acquire);
+                while (true) {
+                    uint32_t victim_begin = static_cast<uint32_t>(victim_bounds);
+                    uint32_t victim_end = static_cast<uint32_t>(victim_bounds >> 32);
+                    if (victim_begin >= victim_end) {
+                        break;
+                    }
+                    uint32_t middle = victim_begin + (victim_end - victim_begin) / 2;
+                    if (victim.compare_exchange_weak(victim_bounds, make_bounds(victim_begin, middle),
+                                                     std::memory_order_acq_rel)) {
+                        own.store(make_bounds(middle, victim_end), std::memory_order_release);
+                        stole = true;
+                        break;
+                    }
+                }
+            }
+            // Every range is empty: the indices still running belong to threads that finish them
+            if (!stole) {
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    helpers.reserve(threads - 1);
+    for (uint32_t t = 1; t < threads; ++t) {
+        try {
+            helpers.emplace_back(work, t);
+        } catch (const std::system_error&) {
+            break; // The ranges of threads that did not start are stolen by the others
+        }
+    }
+    work(0);
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+#endif //PARALLEL_FOR_H
@@ -1,88 +1,161 @@
 #include "Parser.h"
-
-Parser::Parser(const std::vector<uint8_t>& binary) : binary(binary), offset(0) {}
+#include "Decoder.h"
+#include "Validator.h"
+#include "Translator.h"
+#include "Fuser.h"
+#include "Leb128.h"
+#include "ParallelFor.h"
+#include <map>
+#include <utility>
+
+Parser::Parser(std::span<const uint8_t> binary, uint32_t compile_threads, bool compile_lazily)
+    : binary(binary), offset(0), compile_threads(compile_threads), compile_lazily(compile_lazily) {}
 
 void Parser::parse_into(Module& module) {
+    parse_available(binary, module);
+    finish(module);
+}
 
-    validate_header();
-    offset = 8; // Move past the header to the first section
+void Parser::parse_available(std::span<const uint8_t> available, Module& module) {
+    binary = available;
+    if (offset == 0) {
+        if (binary.size() < 8) {
+            return;
+        }
+        validate_header();
+        offset = 8; // Move past the header to the first section
+    }
 
-    while (offset < binary.size()) {
+    while (true) {
+        if (in_code_section) {
+            if (parsed_bodies == module.functions.size()) {
+                offset = code_section_end;
+                in_code_section = false;
+                continue;
+            }
+            if (!has_leb128(offset)) {
+                return;
+            }
+            size_t body_start = offset;
+            uint32_t body_size = read_body_size();
+            if (body_size > binary.size() - offset) {
+                offset = body_start; // Wait for the rest of the body
+                return;
+            }
+            uint32_t function_index = parsed_bodies++;
+            parse_function_body(module, function_index, offset + body_size);
+            if (!compile_lazily) {
+                compile_function(module, function_index);
+            }
+            continue;
+        }
+
+        if (offset >= binary.size() || !has_leb128(offset + 1)) {
+            return;
+        }
+        size_t section_start = offset;
         uint8_t section_id = read_byte();
         uint32_t section_size = decode_leb128_u();
         size_t section_end = offset + section_size;
 
-        switch (section_id) {
-            case 1: // Type Section
-                std::cout << "Parsing Type Section (ID 1)..." << std::endl;
-                parse_type_section(module);
-                break;
-            case 3: // Function Section
-                std::cout << "Parsing Function Section (ID 3)..." << std::endl;
-                parse_function_section(module);
-                break;
-            case 5: // Memory Section
-                std::cout << "Parsing Memory Section (ID 5)..." << std::endl;
-                parse_memory_section(module);
-                break;
-            case 6: // Global Section
-                std::cout << "Parsing Global Section (ID 6)..." << std::endl;
-                parse_global_section(module);
-                break;
-            case 7: // Export Section
-                std::cout << "Parsing Export Section (ID 7)..." << std::endl;
-                parse_export_section(module);
-                break;
-            case 10: // Code Section
-                std::cout << "Parsing Code Section (ID 10)..." << std::endl;
-                parse_code_section(module);
-                break;
-            default:
-                std::cout << "Skipping unhandled Section ID: " << (int)section_id << std::endl;
-                break;
+        if (section_id == 10) { // Code Section
+            if (!has_leb128(offset)) {
+                offset = section_start;
+                return;
+            }
+            begin_code_section(module);
+            code_section_end = section_end;
+            if (compile_threads > 1 && !compile_lazily && section_end <= binary.size()) {
+                parse_code_section_in_parallel(module);
+                offset = section_end;
+            } else {
+                in_code_section = true;
+            }
+            continue;
         }
 
+        // Any other section is parsed in one go, once it is complete
+        if (section_end > binary.size()) {
+            offset = section_start;
+            return;
+        }
+        parse_section(module, section_id);
         offset = section_end;
     }
 }
 
-uint8_t Parser::read_byte() {
-    return binary[offset++];
+void Parser::finish(Module& module) {
+    if (offset == 0) {
+        validate_header(); // Too small to have a header
+    }
+    if (in_code_section || offset < binary.size()) {
+        throw std::runtime_error("Unexpected end of the binary inside a section.");
+    }
+    if (module.functions.size() != module.function_type_indices.size()) {
+        throw std::runtime_error("Function and Code section counts mismatch.");
+    }
+
+    Validator validator(module);
+    validator.validate_definitions();
 }
 
-uint32_t Parser::decode_leb128_u() {
-    uint32_t result = 0;
-    int shift = 0;
-    while (true) {
-        uint8_t byte = read_byte();
-        result |= (byte & 0x7f) << shift;
-        if ((byte & 0x80) == 0) {
+void Parser::parse_section(Module& module, uint8_t section_id) {
+    switch (section_id) {
+        case 1: // Type Section
+            parse_type_section(module);
+            break;
+        case 3: // Function Section
+            parse_function_section(module);
+            break;
+        case 4: // Table Section
+            parse_table_section(module);
+            break;
+        case 5: // Memory Section
+            parse_memory_section(module);
+            break;
+        case 6: // Global Section
+            parse_global_section(module);
+            break;
+        case 7: // Export Section
+            parse_export_section(module);
+            break;
+        case 9: // Element Section
+            parse_element_section(module);
+            break;
+        case 11: // Data Section
+            parse_data_section(module);
+            break;
+        case 12: // Data Count Section
+            module.data_segment_count = decode_leb128_u();
+            break;
+        default: // Custom sections and those the interpreter has no use for
             break;
-        }
-        shift += 7;
     }
-    return result;
 }
 
-int32_t Parser::decode_leb128_s() {
-    int32_t result = 0;
-    int shift = 0;
+uint8_t Parser::read_byte() {
+    return binary[offset++];
+}
 
-    while (true) {
-        uint8_t byte = read_byte();
-        result |= (byte & 0x7f) << shift;
-        shift += 7;
-
-        if ((byte & 0x80) == 0) {
-            // Sign extension if the sign bit of the last byte is set
-            if ((shift < 32) && (byte & 0x40)) {
-                result |= (~0 << shift);
-            }
-            break;
+// Whether the bytes from `at` on hold a whole LEB128 number
+bool Parser::has_leb128(size_t at) const {
+    for (size_t i = at; i < binary.size(); ++i) {
+        if ((binary[i] & 0x80) == 0) {
+            return true;
+        }
+        if (i - at == 4) {
+            throw std::runtime_error("Malformed LEB128 number.");
         }
     }
+    return false;
+}
 
-    return result;
+uint32_t Parser::decode_leb128_u() {
+    return decode_leb128<uint32_t>(binary, offset, "Unexpected end of the binary inside a section.");
+}
+
+int32_t Parser::decode_leb128_s() {
+    return decode_leb128<int32_t>(binary, offset, "Unexpected end of the binary inside a section.");
 }
 
 void Parser::validate_header() {
@@ -96,53 +169,103 @@ void Parser::validate_header() {
     if (!std::equal(version.begin(), version.end(), binary.begin() + 4)) {
         throw std::runtime_error("Unsupported wasm version.");
     }
-    std::cout << "Wasm header validated." << std::endl;
 }
 
 
+// Equal signatures are interned once, so the pool holds the types of each distinct signature
 void Parser::parse_type_section(Module& module) {
     uint32_t num_types = decode_leb128_u();
-    module.types.reserve(num_types);
+    struct Signature {
+        size_t params_offset; // Into the pool
+        uint32_t num_params;
+        uint32_t num_results;
+        uint32_t canonical_index;
+    };
+    std::vector<Signature> signatures;
+    std::vector<ValueType> pool;
+    std::map<std::pair<std::vector<ValueType>, std::vector<ValueType>>, uint32_t> canonical_indices;
+    signatures.reserve(num_types);
     for (uint32_t i = 0; i < num_types; ++i) {
         if (read_byte() != 0x60) { // Form must be 0x60 for 'func'
             throw std::runtime_error("Expected function type form 0x60");
         }
-        FunctionType ftype;
+        std::vector<ValueType> params, results;
         uint32_t num_params = decode_leb128_u();
         for (uint32_t p = 0; p < num_params; ++p) {
-            ftype.params.push_back(static_cast<ValueType>(read_byte()));
+            params.push_back(static_cast<ValueType>(read_byte()));
         }
         uint32_t num_results = decode_leb128_u();
         for (uint32_t r = 0; r < num_results; ++r) {
-            ftype.results.push_back(static_cast<ValueType>(read_byte()));
+            results.push_back(static_cast<ValueType>(read_byte()));
+        }
+        auto [entry, inserted] = canonical_indices.try_emplace({params, results}, i);
+        if (inserted) {
+            signatures.push_back({pool.size(), num_params, num_results, entry->second});
+            pool.insert(pool.end(), params.begin(), params.end());
+            pool.insert(pool.end(), results.begin(), results.end());
+        } else {
+            signatures.push_back(signatures[entry->second]);
         }
-        module.types.push_back(ftype);
+    }
+
+    // Only now that the pool is complete can the types point into it
+    std::span<const ValueType> interned = module.arena->copy(pool);
+    module.types = module.arena->allocate<FunctionType>(num_types);
+    for (uint32_t i = 0; i < num_types; ++i) {
+        const Signature& signature = signatures[i];
+        FunctionType& ftype = module.types[i];
+        if (!interned.empty()) {
+            ftype.params = interned.subspan(signature.params_offset, signature.num_params);
+            ftype.results = interned.subspan(signature.params_offset + signature.num_params, signature.num_results);
+        }
+        ftype.canonical_index = signature.canonical_index;
     }
 }
 
 void Parser::parse_function_section(Module& module) {
     uint32_t num_functions = decode_leb128_u();
-    module.function_type_indices.reserve(num_functions);
+    std::vector<uint32_t> type_indices;
+    type_indices.reserve(num_functions);
     for (uint32_t i = 0; i < num_functions; ++i) {
-        module.function_type_indices.push_back(decode_leb128_u());
+        type_indices.push_back(decode_leb128_u());
+    }
+    module.function_type_indices = module.arena->copy(type_indices);
+}
+
+void Parser::parse_table_section(Module& module) {
+    uint32_t num_tables = decode_leb128_u();
+    std::vector<ValueType> tables;
+    for (uint32_t i = 0; i < num_tables; ++i) {
+        tables.push_back(static_cast<ValueType>(read_byte()));
+        uint8_t flags = read_byte();
+        decode_leb128_u(); // Initial size
+        if (flags == 0x01) {
+            decode_leb128_u(); // Maximum size
+        }
     }
+    module.tables = module.arena->copy(tables);
 }
 
 void Parser::parse_memory_section(Module& module) {
     uint32_t num_memories = decode_leb128_u();
+    if (num_memories > 1) {
+        throw std::runtime_error("Multiple memories are not supported");
+    }
     if (num_memories > 0) {
+        module.has_memory = true;
         uint8_t flags = read_byte();
         module.memory_initial_pages = decode_leb128_u();
         if (flags == 0x01) {
-            decode_leb128_u();
+            module.memory_max_pages = decode_leb128_u();
         }
     }
 }
 
 void Parser::parse_global_section(Module& module) {
     uint32_t num_globals = decode_leb128_u();
+    std::vector<GlobalType> globals;
     for (uint32_t i = 0; i < num_globals; ++i) {
-        GlobalType gtype;
+        GlobalType gtype{.initial_value = {.i64 = 0}};
         gtype.type = static_cast<ValueType>(read_byte());
         gtype.is_mutable = (read_byte() == 0x01);
 
@@ -155,52 +278,181 @@ void Parser::parse_global_section(Module& module) {
             throw std::runtime_error("Expected 'end' opcode after global initializer");
         }
 
-        module.globals.push_back(gtype);
+        globals.push_back(gtype);
     }
+    module.globals = module.arena->copy(globals);
 }
 
 void Parser::parse_export_section(Module& module) {
     uint32_t num_exports = decode_leb128_u();
+    std::vector<Export> exports;
     for (uint32_t i = 0; i < num_exports; ++i) {
         Export ex;
         uint32_t name_len = decode_leb128_u();
-        ex.name = std::string(binary.begin() + offset, binary.begin() + offset + name_len);
+        ex.name = std::string_view(reinterpret_cast<const char*>(binary.data()) + offset, name_len);
         offset += name_len;
 
         ex.kind = read_byte();
         ex.index = decode_leb128_u();
-        module.exports.push_back(ex);
+        exports.push_back(ex);
+    }
+    module.exports = module.arena->copy(exports);
+}
+
+// The segments are not instantiated yet, only their number is needed to validate their indices.
+void Parser::parse_element_section(Module& module) {
+    module.element_segment_count = decode_leb128_u();
+}
+
+void Parser::parse_data_section(Module& module) {
+    uint32_t num_segments = decode_leb128_u();
+    std::vector<DataSegment> data_segments;
+    data_segments.reserve(num_segments);
+    for (uint32_t i = 0; i < num_segments; ++i) {
+        DataSegment segment;
+        uint32_t flags = decode_leb128_u();
+        if (flags > 0x02) {
+            throw std::runtime_error("Invalid data segment flags");
+        }
+        segment.is_active = (flags != 0x01);
+        if (flags == 0x02) {
+            decode_leb128_u(); // Memory index
+        }
+        if (segment.is_active) {
+            segment.memory_offset = parse_offset_expression(module);
+        }
+
+        // The bytes are not copied, the segment refers to them in the binary
+        uint32_t size = decode_leb128_u();
+        if (size > binary.size() - offset) {
+            throw std::runtime_error("Data segment extends past the end of the binary");
+        }
+        segment.bytes = std::span<const uint8_t>(binary.data() + offset, size);
+        offset += size;
+
+        data_segments.push_back(segment);
+    }
+    module.data_segments = module.arena->copy(data_segments);
+    module.data_segment_count = num_segments;
+}
+
+// A constant expression: i32.const, or global.get of a global that has already been parsed
+uint32_t Parser::parse_offset_expression(const Module& module) {
+    uint32_t value;
+    uint8_t opcode = read_byte();
+    if (opcode == 0x41) { // i32.const
+        value = decode_leb128_s();
+    } else if (opcode == 0x23) { // global.get
+        uint32_t global_index = decode_leb128_u();
+        if (global_index >= module.globals.size()) {
+            throw std::runtime_error("Unknown global in offset expression");
+        }
+        value = module.globals[global_index].initial_value.i32;
+    } else {
+        throw std::runtime_error("Unsupported offset expression");
+    }
+
+    if (read_byte() != 0x0B) {
+        throw std::runtime_error("Expected 'end' opcode after offset expression");
     }
+    return value;
 }
 
-void Parser::parse_code_section(Module& module) {
+void Parser::begin_code_section(Module& module) {
     uint32_t num_functions = decode_leb128_u();
     if (num_functions != module.function_type_indices.size()) {
         throw std::runtime_error("Function and Code section counts mismatch.");
     }
+    module.functions.allocate(*module.arena, num_functions);
+}
 
-    module.functions.reserve(num_functions);
-    for (uint32_t i = 0; i < num_functions; ++i) {
-        uint32_t body_size = decode_leb128_u();
-        size_t body_end = offset + body_size;
+uint32_t Parser::read_body_size() {
+    uint32_t body_size = decode_leb128_u();
+    if (body_size > code_section_end - std::min(offset, code_section_end)) {
+        throw std::runtime_error("Function body extends past the end of the Code section");
+    }
+    return body_size;
+}
 
-        Function func;
-        func.type_index = module.function_type_indices[i];
+// The bodies are length-prefixed, so they are split up first and then decoded, validated and
+// translated on all compile threads. Every body only writes its own entries of the FunctionTable.
+void Parser::parse_code_section_in_parallel(Module& module) {
+    uint32_t num_functions = module.function_type_indices.size();
+    std::vector<std::span<const uint8_t>> bodies(num_functions);
+    for (std::span<const uint8_t>& body : bodies) {
+        uint32_t body_size = read_body_size();
+        body = binary.subspan(offset, body_size);
+        offset += body_size;
+    }
 
-        uint32_t num_local_entries = decode_leb128_u();
-        for (uint32_t j = 0; j < num_local_entries; ++j) {
-            uint32_t count = decode_leb128_u();
+    parallel_for(num_functions, compile_threads, [&module, &bodies](uint32_t function_index) {
+        Parser body_parser(bodies[function_index]);
+        body_parser.parse_function_body(module, function_index, bodies[function_index].size());
+        compile_function(module, function_index);
+    });
+    parsed_bodies = num_functions;
+}
 
-            ValueType type = static_cast<ValueType>(read_byte());
+// Parses the body that starts at the offset, after its size
+void Parser::parse_function_body(Module& module, uint32_t function_index, size_t body_end) {
+    FrameLayout& frame = module.functions.frames[function_index];
+    uint32_t type_index = module.function_type_indices[function_index];
+    // An unknown type fails validation, which reports it
+    if (type_index < module.types.size()) {
+        frame.param_count = module.types[type_index].params.size();
+        frame.result_count = module.types[type_index].results.size();
+    }
 
-            for (uint32_t k = 0; k < count; ++k) {
-                func.locals.push_back(type);
-            }
-        }
+    uint32_t num_local_entries = decode_leb128_u();
+    std::vector<LocalDeclaration> local_declarations;
+    uint64_t local_count = 0;
+    for (uint32_t j = 0; j < num_local_entries; ++j) {
+        uint32_t count = decode_leb128_u();
 
-        func.code.assign(binary.begin() + offset, binary.begin() + body_end -1);
+        ValueType type = static_cast<ValueType>(read_byte());
 
-        module.functions.push_back(func);
-        offset = body_end;
+        local_count += count;
+        if (count > 0) {
+            local_declarations.push_back({count, type});
+        }
+    }
+    if (local_count + frame.param_count > UINT32_MAX) {
+        throw std::runtime_error("Function declares too many locals.");
+    }
+    frame.local_count = local_count;
+    module.functions.local_declarations[function_index] = module.arena->copy(local_declarations);
+    if (offset >= body_end) {
+        throw std::runtime_error("Function body ends before its code.");
     }
-}
\ No newline at end of file
+
+    module.functions.code[function_index] = binary.subspan(offset, body_end - 1 - offset);
+    offset = body_end;
+}
+
+// The arrays are built in a FunctionCode and only copied into the arena once they are final,
+// so a function that fails leaves its entries of the FunctionTable as they were
+void Parser::compile_function(Module& module, uint32_t function_index) {
+    FunctionTable& functions = module.functions;
+    FrameLayout& frame = functions.frames[function_index];
+    FunctionCode code;
+
+    Decoder decoder(functions.code[function_index]);
+    decoder.decode_into(code);
+
+    Validator validator(module);
+    validator.validate_function(function_index, code);
+
+    Translator translator(module);
+    translator.translate_function(frame, code);
+
+    Fuser fuser(module);
+    fuser.fuse_function(frame, code);
+
+    ModuleArena& arena = *module.arena;
+    functions.register_code[function_index] = arena.copy(code.register_code);
+    functions.register_branch_table[function_index] = arena.copy(code.register_branch_table);
+    functions.instructions[function_index] = arena.copy(code.instructions);
+    functions.branch_table[function_index] = arena.copy(code.branch_table);
+    functions.register_origins[function_index] = arena.copy(code.register_origins);
+    frame.max_stack_height = code.max_stack_height;
+}
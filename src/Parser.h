@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <cstdint>
+#include <span>
 #include <string>
 #include <stdexcept>
 #include <iostream>
@@ -17,31 +18,78 @@ const std::vector<uint8_t> version = {0x01, 0x00, 0x00, 0x00};
  * @class Parser
  * @brief A single-pass parser for the WebAssembly binary format.
  *
- * This class reads a raw byte vector representing a .wasm file, validates its
- * header, and iterates through its sections to populate a static `Module` object.
+ * This class reads the raw bytes of a .wasm file, validates its header, and iterates
+ * through its sections to populate a static `Module` object. Function bodies, names and
+ * data segments are not copied: the module refers to them in the binary, which must
+ * outlive it (CompiledModule keeps both together).
  * It is designed to be a simple, forward-only parser that throws exceptions on malformed input.
+ *
+ * The parser can also start before the whole binary has arrived (see StreamingParser): it
+ * parses what is available and resumes where it stopped when it is given more. Sections are
+ * parsed once all their bytes are there, except for the Code section, whose function bodies
+ * are each decoded, validated and translated as soon as they are complete.
  */
 class Parser {
 public:
     /**
      * @brief Constructs a Parser with the binary data of a .wasm file.
      * @param binary The raw bytes of the wasm file.
+     * @param compile_threads The threads that decode, validate and translate the function bodies
+     *        of a Code section that is complete (see parallel_for). The results do not depend on it.
+     * @param compile_lazily Whether to leave the function bodies as raw code, for compile_function
+     *        to compile each one when it is first needed.
      */
-    explicit Parser(const std::vector<uint8_t>& binary);
+    explicit Parser(std::span<const uint8_t> binary, uint32_t compile_threads = 1, bool compile_lazily = false);
 
     /**
      * @brief Parses the binary data and populates a Module object.
+     *
+     * The parsed module is validated and translated to fused register code before this returns,
+     * so the Interpreter can execute it without checking operand types, stack heights or indices.
      * @param module The Module object to fill with parsed data.
      */
     void parse_into(Module& module);
 
+    /**
+     * @brief Parses as much as possible of a binary that is still arriving.
+     * @param available The bytes received so far, starting with the header. They may move
+     *        between calls, as long as the spans the module holds into them are moved along.
+     * @param module The Module to fill, the same on every call.
+     */
+    void parse_available(std::span<const uint8_t> available, Module& module);
+
+    /**
+     * @brief Completes a module once all of its bytes have been parsed, and validates the definitions outside the function bodies.
+     * @param module The Module that was filled.
+     * @throws std::runtime_error if the binary ends inside a section or the module is invalid.
+     */
+    void finish(Module& module);
+
+    /**
+     * @brief Decodes, validates and translates the code of one parsed function.
+     *
+     * A body only depends on the sections before the Code section, so this can run as soon as
+     * it is parsed, or later. Calls for different functions of a module can run concurrently.
+     * @throws std::runtime_error if the function is invalid.
+     */
+    static void compile_function(Module& module, uint32_t function_index);
+
 private:
 
-    const std::vector<uint8_t>& binary;
+    std::span<const uint8_t> binary;
     size_t offset;
+    uint32_t compile_threads;
+    bool compile_lazily;
+
+    // The Code section, while its function bodies are parsed one by one
+    bool in_code_section = false;
+    size_t code_section_end = 0;
+    uint32_t parsed_bodies = 0;
 
     uint8_t read_byte();
 
+    bool has_leb128(size_t at) const;
+
     uint32_t decode_leb128_u();
 
     int32_t decode_leb128_s();
@@ -52,13 +100,29 @@ private:
 
     void parse_function_section(Module& module);
 
+    void parse_table_section(Module& module);
+
     void parse_memory_section(Module& module);
 
     void parse_global_section(Module& module);
 
     void parse_export_section(Module& module);
 
-    void parse_code_section(Module& module);
+    void parse_element_section(Module& module);
+
+    void parse_section(Module& module, uint8_t section_id);
+
+    void begin_code_section(Module& module);
+
+    uint32_t read_body_size();
+
+    void parse_code_section_in_parallel(Module& module);
+
+    void parse_function_body(Module& module, uint32_t function_index, size_t body_end);
+
+    void parse_data_section(Module& module);
+
+    uint32_t parse_offset_expression(const Module& module);
 };
 
 #endif //PARSER_H
\ No newline at end of file
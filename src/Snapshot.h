@@ -0,0 +1,25 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "CompiledModule.h"
+#include "LinearMemory.h"
+#include <memory>
+#include <vector>
+
+/**
+ * @struct Snapshot
+ * @brief The state of an instance between calls, from which new instances can start.
+ *
+ * Taken with Interpreter::snapshot(), typically right after running a module's initialization,
+ * so new instances start out initialized without running it again (see Interpreter's snapshot
+ * constructor). The memory is saved as a MemoryImage that instances map copy-on-write. The
+ * stacks are empty between calls, so there is nothing else to save. A snapshot is immutable
+ * and can be shared between threads.
+ */
+struct Snapshot {
+    std::shared_ptr<const CompiledModule> compiled_module;
+    std::shared_ptr<const MemoryImage> memory;
+    std::vector<Value> globals;
+};
+
+#endif //SNAPSHOT_H
@@ -0,0 +1,47 @@
+#include "StreamingParser.h"
+#include <algorithm>
+#include <utility>
+
+StreamingParser::StreamingParser(size_t expected_size) : parser(std::span<const uint8_t>{}) {
+    buffer.reserve(expected_size);
+}
+
+void StreamingParser::feed(std::span<const uint8_t> chunk) {
+    if (chunk.size() > buffer.capacity() - buffer.size()) {
+        move_buffer(std::max(buffer.capacity() * 2, buffer.size() + chunk.size()));
+    }
+    buffer.insert(buffer.end(), chunk.begin(), chunk.end());
+    parser.parse_available(buffer, module);
+}
+
+std::shared_ptr<const CompiledModule> StreamingParser::finish() {
+    parser.finish(module);
+    // Moving the buffer leaves its bytes in place, so the spans of the module stay valid
+    return std::make_shared<const CompiledModule>(ModuleBinary(std::move(buffer)), std::move(module));
+}
+
+// Copies the bytes into a larger buffer, and points the spans of the module into it
+void StreamingParser::move_buffer(size_t capacity) {
+    std::vector<uint8_t> larger;
+    larger.reserve(capacity);
+    larger.assign(buffer.begin(), buffer.end());
+
+    const uint8_t* from = buffer.data();
+    const uint8_t* to = larger.data();
+    auto moved = [from, to](const uint8_t* bytes) { return to + (bytes - from); };
+
+    for (std::span<const uint8_t>& code : module.functions.code) {
+        if (code.data() != nullptr) { // Bodies that are not parsed yet have no code
+            code = std::span<const uint8_t>(moved(code.data()), code.size());
+        }
+    }
+    for (Export& ex : module.exports) {
+        auto name = reinterpret_cast<const uint8_t*>(ex.name.data());
+        ex.name = std::string_view(reinterpret_cast<const char*>(moved(name)), ex.name.size());
+    }
+    for (DataSegment& segment : module.data_segments) {
+        segment.bytes = std::span<const uint8_t>(moved(segment.bytes.data()), segment.bytes.size());
+    }
+
+    buffer = std::move(larger);
+}
@@ -0,0 +1,59 @@
+#ifndef STREAMING_PARSER_H
+#define STREAMING_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "CompiledModule.h"
+#include "Module.h"
+#include "Parser.h"
+
+/**
+ * @class StreamingParser
+ * @brief Compiles a module while its binary is still arriving, such as from a pipe or a socket.
+ *
+ * The bytes are fed in chunks of any size as they come in. Every chunk is parsed right away,
+ * as far as it completes sections, and every function body is decoded, validated and
+ * translated as soon as its last byte arrives. Compiling thus overlaps with receiving the
+ * rest of the binary, and once the last chunk is in only the last body and the definitions
+ * after the Code section remain.
+ *
+ * The chunks are collected into one buffer, which the finished CompiledModule owns. If the
+ * buffer has to grow, the spans the module already holds into it are moved along. Passing the
+ * expected size up front avoids that.
+ */
+class StreamingParser {
+public:
+    /**
+     * @param expected_size The size of the whole binary if it is known, or 0.
+     */
+    explicit StreamingParser(size_t expected_size = 0);
+
+    StreamingParser(const StreamingParser&) = delete;
+    StreamingParser& operator=(const StreamingParser&) = delete;
+
+    /**
+     * @brief Appends the next bytes of the binary and parses everything they complete.
+     * @param chunk The bytes, which are copied.
+     * @throws std::runtime_error if the binary is malformed or a completed function is invalid.
+     */
+    void feed(std::span<const uint8_t> chunk);
+
+    /**
+     * @brief Completes the module after its last byte was fed. The parser cannot be used afterwards.
+     * @throws std::runtime_error if the binary is incomplete, or the module is invalid or does not instantiate.
+     */
+    std::shared_ptr<const CompiledModule> finish();
+
+private:
+    std::vector<uint8_t> buffer;
+    Module module;
+    Parser parser;
+
+    void move_buffer(size_t capacity);
+};
+
+#endif //STREAMING_PARSER_H
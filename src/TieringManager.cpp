@@ -0,0 +1,16 @@
+#include "TieringManager.h"
+
+#if WASM_JIT
+
+const CompiledFunction TieringManager::not_compiled;
+
+TieringManager::TieringManager(const CompiledModule& compiled_module, const TieringPolicy& policy)
+    : compiled_module(compiled_module), policy(policy), tiers(compiled_module.module().functions.size()) {}
+
+void TieringManager::promote(uint32_t function_index) {
+    FunctionTier& tier = tiers[function_index];
+    tier.code = &compiled_module.compiled_function(function_index);
+    tier.state = tier.code->entry != nullptr ? TIER_COMPILED : TIER_UNSUPPORTED;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef TIERING_MANAGER_H
+#define TIERING_MANAGER_H
+
+#include "CompiledModule.h"
+#include "JitCompiler.h"
+#include <vector>
+#include <cstdint>
+
+/**
+ * @struct TieringPolicy
+ * @brief When a function leaves the interpreter for compiled code.
+ *
+ * A function is compiled once it has been called `call_threshold` times, or once its loops
+ * have branched back `back_edge_threshold` times in total. Both at 0 compile every function
+ * on its first call. Without WASM_JIT there is nothing to promote to and the policy is unused.
+ */
+struct TieringPolicy {
+    uint32_t call_threshold = 1000;
+    uint32_t back_edge_threshold = 10000;
+};
+
+#if WASM_JIT
+
+/**
+ * @class TieringManager
+ * @brief Counts how hot every function is and promotes hot functions to compiled code.
+ *
+ * The Interpreter reports every call and every branch back to a loop header. Functions that
+ * run briefly stay in the interpreter and never pay for compilation. A function that crosses
+ * a threshold is compiled once, after which its calls enter the compiled code, and a call that
+ * is still interpreting a long-running loop switches to the compiled code at the loop header.
+ *
+ * The counts belong to one instance, while the code comes from the CompiledModule, so an
+ * instance promoting a function another instance already compiled gets it without compiling.
+ */
+class TieringManager {
+public:
+    TieringManager(const CompiledModule& compiled_module, const TieringPolicy& policy);
+
+    /**
+     * @brief Records a call of a function.
+     * @return The compiled code to run the call with, or nullptr to interpret it.
+     */
+    JitCode on_call(uint32_t function_index) {
+        FunctionTier& tier = tiers[function_index];
+        if (tier.state == TIER_INTERPRETED && ++tier.calls >= policy.call_threshold) {
+            promote(function_index);
+        }
+        return tier.code->entry;
+    }
+
+    /**
+     * @brief Records a branch back to the header of a loop in an interpreted call.
+     * @param loop_pc The PC of the first instruction of the loop body.
+     * @return The compiled code to continue the call with at the loop header, or nullptr to keep interpreting.
+     */
+    JitCode on_back_edge(uint32_t function_index, size_t loop_pc) {
+        FunctionTier& tier = tiers[function_index];
+        if (tier.state == TIER_INTERPRETED && ++tier.back_edges >= policy.back_edge_threshold) {
+            promote(function_index);
+        }
+        return tier.state == TIER_COMPILED ? tier.code->loop_entry(loop_pc) : nullptr;
+    }
+
+private:
+    enum TierState : uint8_t {
+        TIER_INTERPRETED, // Counting towards promotion
+        TIER_COMPILED,
+        TIER_UNSUPPORTED, // The JIT cannot compile the function, it is interpreted for good
+    };
+
+    struct FunctionTier {
+        TierState state = TIER_INTERPRETED;
+        uint32_t calls = 0;
+        uint32_t back_edges = 0;
+        const CompiledFunction* code = &not_compiled;
+    };
+
+    static const CompiledFunction not_compiled;
+
+    const CompiledModule& compiled_module;
+    TieringPolicy policy;
+    std::vector<FunctionTier> tiers;
+
+    void promote(uint32_t function_index);
+};
+
+#endif
+
+#endif //TIERING_MANAGER_H
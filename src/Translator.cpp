@@ -0,0 +1,434 @@
+#include "Translator.h"
+#include "Opcodes.h"
+
+Translator::Translator(Module& module) : module(module) {}
+
+void Translator::translate_function(const FrameLayout& frame, FunctionCode& function_code) {
+    func = &function_code;
+    local_count = frame.param_count + frame.local_count;
+    code = &function_code.register_code;
+    code->clear();
+    function_code.register_branch_table.clear();
+    function_code.register_origins.clear();
+    operands.clear();
+    blocks.clear();
+    dead_nesting = 0;
+    jump_target = SIZE_MAX;
+    last_result = SIZE_MAX;
+
+    // The function body is the outermost block, branching to it returns
+    blocks.push_back(Block{0x02, 0, 0, frame.result_count, 0, 0, {}, SIZE_MAX, false, false});
+
+    for (pc = 0; pc < function_code.instructions.size(); ++pc) {
+        translate_instruction(function_code.instructions[pc]);
+    }
+}
+
+uint32_t Translator::push_result() {
+    uint32_t slot = slot_of_height(operands.size());
+    operands.push_back(slot);
+    return slot;
+}
+
+uint32_t Translator::pop_operand() {
+    uint32_t slot = operands.back();
+    operands.pop_back();
+    return slot;
+}
+
+void Translator::materialize(size_t height) {
+    uint32_t slot = slot_of_height(height);
+    if (operands[height] != slot) {
+        emit_copy(slot, operands[height]);
+        operands[height] = slot;
+    }
+}
+
+void Translator::materialize_all() {
+    for (size_t height = 0; height < operands.size(); ++height) {
+        materialize(height);
+    }
+}
+
+void Translator::materialize_aliases(uint32_t local) {
+    for (size_t height = 0; height < operands.size(); ++height) {
+        if (operands[height] == local) {
+            materialize(height);
+        }
+    }
+}
+
+bool Translator::can_retarget(uint32_t slot) const {
+    // The instruction right before must have computed the value into a slot of the operand stack,
+    // which nothing else reads once it is popped, and nothing may jump in between. A copy into a
+    // local, as local.tee makes, must keep writing that local.
+    return slot >= local_count && last_result != SIZE_MAX && last_result + 1 == code->size()
+           && (*code)[last_result].r == slot && jump_target != code->size();
+}
+
+size_t Translator::emit(uint16_t opcode, uint32_t r, uint32_t a, uint32_t b, Value imm) {
+    code->push_back(RegisterInstruction{opcode, r, a, b, imm});
+    func->register_origins.push_back(pc);
+    return code->size() - 1;
+}
+
+void Translator::emit_result(uint16_t opcode, uint32_t a, uint32_t b, Value imm) {
+    uint32_t r = push_result();
+    last_result = emit(opcode, r, a, b, imm);
+}
+
+void Translator::emit_copy(uint32_t to, uint32_t from) {
+    if (to != from) {
+        last_result = emit(REG_COPY, to, from);
+    }
+}
+
+void Translator::bind_here() {
+    jump_target = code->size();
+}
+
+void Translator::patch(const Fixup& fixup, uint32_t target) {
+    if (fixup.in_branch_table) {
+        func->register_branch_table[fixup.index] = target;
+    } else {
+        (*code)[fixup.index].imm.i64 = target;
+    }
+}
+
+std::pair<uint32_t, uint32_t> Translator::block_signature(int64_t block_type) const {
+    if (block_type == -64) { // 0x40: empty block type
+        return {0, 0};
+    }
+    if (block_type < 0) { // A single value type
+        return {0, 1};
+    }
+    const FunctionType& type = module.types[block_type];
+    return {type.params.size(), type.results.size()};
+}
+
+void Translator::open_block(uint16_t opcode, int64_t block_type) {
+    // Every operand gets its own slot, so all paths through the block agree on the stack layout
+    materialize_all();
+    auto [param_count, result_count] = block_signature(block_type);
+    blocks.push_back(Block{opcode, operands.size() - param_count, param_count, result_count, 0, 0, {}, SIZE_MAX, false, false});
+    if (opcode == 0x03) {
+        blocks.back().loop_header = code->size();
+        blocks.back().loop_pc = pc + 1;
+        bind_here();
+    }
+}
+
+void Translator::close_block() {
+    Block& block = blocks.back();
+
+    if (blocks.size() == 1) {
+        // Branches to the function body are returns, so nothing jumps to its end
+        if (!block.unreachable) {
+            emit_return();
+        }
+        blocks.pop_back();
+        return;
+    }
+
+    if (!block.unreachable) {
+        for (uint32_t i = 0; i < block.results; ++i) {
+            materialize(block.height + i);
+        }
+    }
+    if (block.opcode == 0x04 && !block.has_else) {
+        patch(Fixup{false, block.else_jump}, code->size());
+    }
+    for (const Fixup& fixup : block.fixups) {
+        patch(fixup, code->size());
+    }
+    bind_here();
+
+    operands.resize(block.height);
+    for (uint32_t i = 0; i < block.results; ++i) {
+        push_result();
+    }
+    blocks.pop_back();
+}
+
+void Translator::set_unreachable() {
+    blocks.back().unreachable = true;
+    operands.resize(blocks.back().height);
+}
+
+bool Translator::needs_copies(const Block& target) const {
+    uint32_t arity = target.opcode == 0x03 ? target.params : target.results;
+    size_t first = operands.size() - arity;
+    for (uint32_t i = 0; i < arity; ++i) {
+        if (operands[first + i] != slot_of_height(target.height + i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Translator::emit_branch_copies(const Block& target) {
+    // The label's values move down to the slots right above the block's base. Every value sits
+    // at or above its destination, so copying them in order never overwrites one still to be moved.
+    uint32_t arity = target.opcode == 0x03 ? target.params : target.results;
+    size_t first = operands.size() - arity;
+    for (uint32_t i = 0; i < arity; ++i) {
+        emit_copy(slot_of_height(target.height + i), operands[first + i]);
+    }
+}
+
+void Translator::emit_jump(Block& target) {
+    if (&target == &blocks.front()) {
+        emit_return();
+        return;
+    }
+    emit_branch_copies(target);
+    if (target.opcode == 0x03) {
+        emit(REG_LOOP_JUMP, 0, 0, target.loop_pc, Value{.i64 = target.loop_header});
+    } else {
+        target.fixups.push_back(Fixup{false, emit(REG_JUMP)});
+    }
+}
+
+void Translator::emit_jump_if(Block& target, uint32_t condition) {
+    if (&target == &blocks.front() || needs_copies(target)) {
+        // The copies may only happen when the branch is taken
+        size_t skip = emit(REG_JUMP_UNLESS, 0, condition);
+        emit_jump(target);
+        patch(Fixup{false, skip}, code->size());
+        bind_here();
+        return;
+    }
+    if (target.opcode == 0x03) {
+        emit(REG_LOOP_JUMP_IF, 0, condition, target.loop_pc, Value{.i64 = target.loop_header});
+    } else {
+        target.fixups.push_back(Fixup{false, emit(REG_JUMP_IF, 0, condition)});
+    }
+}
+
+void Translator::emit_return() {
+    uint32_t result_count = blocks.front().results;
+    size_t first = operands.size() - result_count;
+    if (result_count > 1) {
+        for (size_t height = first; height < operands.size(); ++height) {
+            materialize(height);
+        }
+    }
+    uint32_t slot = result_count == 1 ? operands.back() : slot_of_height(first);
+    emit(0x0F, 0, slot, result_count);
+}
+
+void Translator::emit_local_set(uint32_t local) {
+    uint32_t value = pop_operand();
+    if (value == local) {
+        return;
+    }
+
+    // Operands that still read the old value of the local need their own copy first
+    bool aliased = false;
+    for (uint32_t slot : operands) {
+        aliased |= slot == local;
+    }
+    if (aliased) {
+        materialize_aliases(local);
+    } else if (can_retarget(value)) {
+        code->back().r = local;
+        last_result = SIZE_MAX;
+        return;
+    }
+    emit_copy(local, value);
+}
+
+void Translator::emit_br_table(const Instruction& instr) {
+    uint32_t index = pop_operand();
+    uint32_t label_count = instr.b;
+    size_t table_base = func->register_branch_table.size();
+    func->register_branch_table.resize(table_base + label_count + 1);
+    emit(REG_BR_TABLE, 0, index, label_count, Value{.i64 = static_cast<int64_t>(table_base)});
+
+    // Labels whose values are already in place are jumped to directly, the others get a stub
+    // with their copies. Loops always get one, which counts the back edge.
+    for (uint32_t i = 0; i <= label_count; ++i) {
+        Block& target = blocks[blocks.size() - 1 - func->branch_table[instr.a + i]];
+        if (&target != &blocks.front() && target.opcode != 0x03 && !needs_copies(target)) {
+            target.fixups.push_back(Fixup{true, table_base + i});
+        } else {
+            func->register_branch_table[table_base + i] = code->size();
+            emit_jump(target);
+        }
+    }
+}
+
+void Translator::translate_instruction(const Instruction& instr) {
+    // Dead code is skipped up to the else or end of the block that became unreachable
+    if (blocks.back().unreachable) {
+        switch (instr.opcode) {
+            case 0x02: case 0x03: case 0x04:
+                ++dead_nesting;
+                return;
+            case 0x05:
+                if (dead_nesting > 0) return;
+                break;
+            case 0x0B:
+                if (dead_nesting > 0) {
+                    --dead_nesting;
+                    return;
+                }
+                break;
+            default:
+                return;
+        }
+    }
+
+    switch (instr.opcode) {
+        // === CONTROL FLOW ===
+        case 0x00: // unreachable
+            emit(0x00);
+            set_unreachable();
+            return;
+        case 0x01: // nop
+            return;
+        case 0x02: // block
+        case 0x03: // loop
+            open_block(instr.opcode, instr.value.i64);
+            return;
+        case 0x04: { // if
+            uint32_t condition = pop_operand();
+            open_block(instr.opcode, instr.value.i64);
+            blocks.back().else_jump = emit(REG_JUMP_UNLESS, 0, condition);
+            return;
+        }
+        case 0x05: { // else
+            Block& block = blocks.back();
+            if (!block.unreachable) {
+                for (uint32_t i = 0; i < block.results; ++i) {
+                    materialize(block.height + i);
+                }
+                block.fixups.push_back(Fixup{false, emit(REG_JUMP)});
+            }
+            patch(Fixup{false, block.else_jump}, code->size());
+            bind_here();
+            block.has_else = true;
+            block.unreachable = false;
+
+            // The parameters are still in their own slots, where the if found them
+            operands.resize(block.height);
+            for (uint32_t i = 0; i < block.params; ++i) {
+                push_result();
+            }
+            return;
+        }
+        case 0x0B: // end
+            close_block();
+            return;
+        case 0x0C: // br
+            emit_jump(blocks[blocks.size() - 1 - instr.a]);
+            set_unreachable();
+            return;
+        case 0x0D: { // br_if
+            uint32_t condition = pop_operand();
+            emit_jump_if(blocks[blocks.size() - 1 - instr.a], condition);
+            return;
+        }
+        case 0x0E: // br_table
+            emit_br_table(instr);
+            set_unreachable();
+            return;
+        case 0x0F: // return
+            emit_return();
+            set_unreachable();
+            return;
+        case 0x10: { // call
+            // The arguments become the callee's first locals, so they must sit on top of the frame
+            const FunctionType& type = module.types[module.function_type_indices[instr.a]];
+            size_t base = operands.size() - type.params.size();
+            for (size_t height = base; height < operands.size(); ++height) {
+                materialize(height);
+            }
+            operands.resize(base);
+            emit(0x10, slot_of_height(base), 0, 0, Value{.i64 = instr.a});
+            for (size_t i = 0; i < type.results.size(); ++i) {
+                push_result();
+            }
+            return;
+        }
+        case 0x1A: // drop
+            pop_operand();
+            return;
+        case 0x1B: // select
+        case 0x1C: { // select t
+            uint32_t condition = pop_operand();
+            uint32_t b = pop_operand();
+            uint32_t a = pop_operand();
+            emit_result(0x1B, a, b, Value{.i64 = condition});
+            return;
+        }
+
+        // === VARIABLES ===
+        case 0x20: // local.get
+            operands.push_back(instr.a);
+            return;
+        case 0x21: // local.set
+            emit_local_set(instr.a);
+            return;
+        case 0x22: // local.tee
+            emit_local_set(instr.a);
+            operands.push_back(instr.a);
+            return;
+        case 0x23: // global.get
+            emit_result(0x23, 0, 0, Value{.i64 = instr.a});
+            return;
+        case 0x24: // global.set
+            emit(0x24, 0, pop_operand(), 0, Value{.i64 = instr.a});
+            return;
+
+        // === MEMORY ===
+        case 0x28: case 0x29: case 0x2A: case 0x2B: case 0x2C: case 0x2D: case 0x2E: case 0x2F:
+        case 0x30: case 0x31: case 0x32: case 0x33: case 0x34: case 0x35: { // loads
+            uint32_t address = pop_operand();
+            emit_result(instr.opcode, address, 0, Value{.i64 = instr.a});
+            return;
+        }
+        case 0x36: case 0x37: case 0x38: case 0x39: case 0x3A: case 0x3B: case 0x3C: case 0x3D: case 0x3E: { // stores
+            uint32_t value = pop_operand();
+            uint32_t address = pop_operand();
+            emit(instr.opcode, 0, address, value, Value{.i64 = instr.a});
+            return;
+        }
+        case 0x3F: // memory.size
+            emit_result(0x3F);
+            return;
+        case 0x40: { // memory.grow
+            uint32_t delta = pop_operand();
+            emit_result(0x40, delta);
+            return;
+        }
+
+        // === CONSTANTS ===
+        case 0x41: case 0x42: case 0x43: case 0x44:
+            emit_result(instr.opcode, 0, 0, instr.value);
+            return;
+
+        default:
+            break;
+    }
+
+    // === NUMERIC ===
+    switch (numeric_arity(instr.opcode)) {
+        case 1: {
+            uint32_t a = pop_operand();
+            emit_result(instr.opcode, a);
+            return;
+        }
+        case 2: {
+            uint32_t b = pop_operand();
+            uint32_t a = pop_operand();
+            emit_result(instr.opcode, a, b);
+            return;
+        }
+        default:
+            // The Interpreter does not implement it and traps when it is reached
+            emit(instr.opcode);
+            set_unreachable();
+            return;
+    }
+}
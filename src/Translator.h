@@ -0,0 +1,106 @@
+#ifndef TRANSLATOR_H
+#define TRANSLATOR_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#include "Module.h"
+
+/**
+ * @class Translator
+ * @brief Translates the validated stack code of every function into register code.
+ *
+ * The Validator fixes the operand stack height at every instruction, so every operand can be
+ * given a static slot in the frame: the value at height `h` lives in slot `locals + h`. The
+ * Translator walks a function once, tracking for every operand on its abstract stack the slot
+ * that holds it, and emits one register instruction per operation that reads and writes slots
+ * directly (see RegisterInstruction).
+ *
+ * local.get emits nothing: its operand is simply the local's slot, until that local is written
+ * while the operand is still on the stack. local.set emits nothing either when the value was
+ * computed by the instruction right before it, which then writes the local instead of its
+ * stack slot. Operands are moved to their own slots only where the stack layout must be fixed:
+ * at block boundaries, branches and calls. Blocks disappear into forward jumps and loops into
+ * backward jumps, so execution needs no control stack.
+ */
+class Translator {
+public:
+    /**
+     * @brief Constructs a Translator for a validated module.
+     * @param module The Module whose functions receive their register code.
+     */
+    explicit Translator(Module& module);
+
+    /**
+     * @brief Translates one validated function, which needs no other function's body.
+     * @param frame The sizes of the function's frame.
+     * @param function_code The decoded and validated body, which receives the register code.
+     */
+    void translate_function(const FrameLayout& frame, FunctionCode& function_code);
+
+private:
+    // A reference to a jump target that is patched once the target is known
+    struct Fixup {
+        bool in_branch_table; // Whether `index` is an entry of the branch table or an instruction
+        size_t index;
+    };
+
+    // A block, loop or if that is open at the current instruction
+    struct Block {
+        uint16_t opcode;
+        size_t height;              // Operand stack height below the block's parameters
+        uint32_t params;
+        uint32_t results;
+        uint32_t loop_header;       // Register PC of a loop's first instruction
+        uint32_t loop_pc;           // Wasm PC of a loop's first instruction
+        std::vector<Fixup> fixups;  // Forward jumps to the end of the block
+        size_t else_jump;           // The jump of an if that is taken when its condition is zero
+        bool has_else;
+        bool unreachable;           // Whether the rest of the block is dead code
+    };
+
+    Module& module;
+    FunctionCode* func = nullptr;
+    uint32_t local_count = 0;
+    size_t pc = 0;
+    std::vector<RegisterInstruction>* code = nullptr;
+
+    std::vector<uint32_t> operands;   // The slot holding each operand on the abstract stack
+    std::vector<Block> blocks;
+    size_t dead_nesting = 0;          // Blocks opened inside dead code, which is skipped
+    size_t jump_target = SIZE_MAX;    // The last register PC that a jump can land on
+    size_t last_result = SIZE_MAX;    // The last instruction that wrote a fresh operand slot
+
+    void translate_instruction(const Instruction& instr);
+
+    uint32_t slot_of_height(size_t height) const { return local_count + height; }
+    uint32_t push_result();
+    uint32_t pop_operand();
+    void materialize(size_t height);
+    void materialize_all();
+    void materialize_aliases(uint32_t local);
+    bool can_retarget(uint32_t slot) const;
+
+    size_t emit(uint16_t opcode, uint32_t r = 0, uint32_t a = 0, uint32_t b = 0, Value imm = {.i64 = 0});
+    void emit_result(uint16_t opcode, uint32_t a = 0, uint32_t b = 0, Value imm = {.i64 = 0});
+    void emit_copy(uint32_t to, uint32_t from);
+    void bind_here();
+    void patch(const Fixup& fixup, uint32_t target);
+
+    std::pair<uint32_t, uint32_t> block_signature(int64_t block_type) const;
+    void open_block(uint16_t opcode, int64_t block_type);
+    void close_block();
+    void set_unreachable();
+
+    bool needs_copies(const Block& target) const;
+    void emit_branch_copies(const Block& target);
+    void emit_jump(Block& target);
+    void emit_jump_if(Block& target, uint32_t condition);
+    void emit_return();
+    void emit_local_set(uint32_t local);
+    void emit_br_table(const Instruction& instr);
+};
+
+#endif //TRANSLATOR_H
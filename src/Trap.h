@@ -0,0 +1,54 @@
+#ifndef TRAP_H
+#define TRAP_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Why the execution of a WebAssembly function stopped before it returned.
+ *
+ * Traps are not C++ exceptions. The instruction that traps hands its code to the single exit
+ * of the interpreter loop, compiled code returns it, and Interpreter::invoke reports it in an
+ * InvokeResult, so a trapping guest costs no more than a returning one.
+ */
+enum TrapCode : uint32_t {
+    TRAP_NONE = 0,
+    TRAP_UNREACHABLE,
+    TRAP_DIVIDE_BY_ZERO,
+    TRAP_INTEGER_OVERFLOW,
+    TRAP_INVALID_CONVERSION,
+    TRAP_OUT_OF_BOUNDS,
+    TRAP_CALL_STACK_EXHAUSTED,
+    TRAP_UNSUPPORTED_INSTRUCTION, // An instruction the interpreter does not implement
+};
+
+/**
+ * @brief The message of a trap, worded like the WebAssembly specification tests.
+ */
+inline const char* trap_message(TrapCode trap) {
+    switch (trap) {
+        case TRAP_NONE: return "no trap";
+        case TRAP_UNREACHABLE: return "unreachable";
+        case TRAP_DIVIDE_BY_ZERO: return "integer divide by zero";
+        case TRAP_INTEGER_OVERFLOW: return "integer overflow";
+        case TRAP_INVALID_CONVERSION: return "invalid conversion to integer";
+        case TRAP_OUT_OF_BOUNDS: return "out of bounds memory access";
+        case TRAP_CALL_STACK_EXHAUSTED: return "call stack exhausted";
+        case TRAP_UNSUPPORTED_INSTRUCTION: return "unsupported instruction";
+    }
+    return "unknown trap";
+}
+
+/**
+ * @struct InvokeResult
+ * @brief The outcome of Interpreter::invoke: success, or the trap and where it happened.
+ */
+struct InvokeResult {
+    TrapCode trap = TRAP_NONE;
+    uint32_t function_index = 0; // The function executing the trapping instruction
+    size_t pc = 0;               // Index of the trapping instruction in its function's body
+
+    bool ok() const { return trap == TRAP_NONE; }
+};
+
+#endif //TRAP_H
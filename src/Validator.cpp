@@ -0,0 +1,603 @@
+#include "Validator.h"
+#include "Opcodes.h"
+#include "LinearMemory.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+namespace {
+
+// The type of a value popped from the polymorphic stack of unreachable code
+constexpr ValueType UNKNOWN = static_cast<ValueType>(0x00);
+
+bool is_num(ValueType type) {
+    return type == ValueType::I32 || type == ValueType::I64 || type == ValueType::F32 ||
+           type == ValueType::F64 || type == UNKNOWN;
+}
+
+bool is_ref(ValueType type) {
+    return type == ValueType::FUNCREF || type == ValueType::EXTERNREF || type == UNKNOWN;
+}
+
+bool is_value_type(ValueType type) {
+    return type != UNKNOWN && (is_num(type) || is_ref(type));
+}
+
+// The result types of the block types that are a single value type point in here
+constexpr ValueType VALUE_TYPES[] = {ValueType::I32, ValueType::I64, ValueType::F32, ValueType::F64,
+                                     ValueType::FUNCREF, ValueType::EXTERNREF};
+
+template <typename T>
+constexpr ValueType value_type_of() {
+    if constexpr (std::is_same_v<T, int32_t>) {
+        return ValueType::I32;
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        return ValueType::I64;
+    } else if constexpr (std::is_same_v<T, float>) {
+        return ValueType::F32;
+    } else {
+        static_assert(std::is_same_v<T, double>);
+        return ValueType::F64;
+    }
+}
+
+} // namespace
+
+Validator::Validator(Module& module)
+    : module(module), function_index(0), pc(0), max_height(0) {}
+
+void Validator::validate_function(uint32_t index, FunctionCode& code) {
+    function_index = index;
+    validate_body(code);
+}
+
+void Validator::validate_definitions() {
+    for (uint32_t type_index : module.function_type_indices) {
+        function_type(type_index);
+    }
+    if (module.memory_initial_pages > module.memory_max_pages) {
+        throw std::runtime_error("Validation failed: memory size minimum must not be greater than maximum");
+    }
+    if (module.memory_max_pages > MAX_PAGES) {
+        throw std::runtime_error("Validation failed: memory size must be at most 65536 pages (4 GiB)");
+    }
+    for (const DataSegment& segment : module.data_segments) {
+        if (segment.is_active && !module.has_memory) {
+            throw std::runtime_error("Validation failed: active data segment without a memory");
+        }
+    }
+    validate_exports();
+}
+
+void Validator::validate_exports() const {
+    for (const auto& ex : module.exports) {
+        bool valid = false;
+        switch (ex.kind) {
+            case 0: valid = ex.index < module.functions.size(); break;
+            case 1: valid = ex.index < module.tables.size(); break;
+            case 2: valid = ex.index == 0 && module.has_memory; break;
+            case 3: valid = ex.index < module.globals.size(); break;
+        }
+        if (!valid) {
+            throw std::runtime_error("Validation failed: export '" + std::string(ex.name) + "' refers to an unknown definition");
+        }
+    }
+}
+
+void Validator::fail(const std::string& message) const {
+    std::stringstream error_stream;
+    error_stream << "Validation failed in function " << function_index << " at instruction " << pc << ": " << message;
+    throw std::runtime_error(error_stream.str());
+}
+
+void Validator::validate_body(FunctionCode& code) {
+    const FunctionType& type = function_type(module.function_type_indices[function_index]);
+
+    params = type.params;
+    local_declarations = module.functions.local_declarations[function_index];
+    declaration_ends.clear();
+    uint64_t local_end = params.size();
+    for (ValueType param : params) {
+        if (!is_value_type(param)) {
+            fail("invalid local type");
+        }
+    }
+    for (const LocalDeclaration& declaration : local_declarations) {
+        if (!is_value_type(declaration.type)) {
+            fail("invalid local type");
+        }
+        local_end += declaration.count;
+        declaration_ends.push_back(local_end);
+    }
+
+    vals.clear();
+    ctrls.clear();
+    max_height = 0;
+
+    // The function body is the outermost label; branching to it returns the results
+    push_ctrl(0x02, {}, type.results);
+
+    for (pc = 0; pc < code.instructions.size(); ++pc) {
+        if (ctrls.empty()) {
+            fail("instructions after the end of the function body");
+        }
+        validate_instruction(code, code.instructions[pc]);
+    }
+    if (!ctrls.empty()) {
+        fail("function body is not terminated");
+    }
+
+    code.max_stack_height = max_height;
+}
+
+// The declarations are run-length encoded, so a local is found by the run it falls into
+ValueType Validator::local_type(uint32_t local_index) const {
+    if (local_index < params.size()) {
+        return params[local_index];
+    }
+    auto run = std::upper_bound(declaration_ends.begin(), declaration_ends.end(), uint64_t{local_index});
+    if (run == declaration_ends.end()) {
+        fail("unknown local");
+    }
+    return local_declarations[run - declaration_ends.begin()].type;
+}
+
+void Validator::push_val(ValueType type) {
+    vals.push_back(type);
+    max_height = std::max(max_height, vals.size());
+}
+
+ValueType Validator::pop_val() {
+    const ControlEntry& frame = ctrls.back();
+    if (vals.size() == frame.height) {
+        if (frame.unreachable) {
+            return UNKNOWN;
+        }
+        fail("operand stack underflow");
+    }
+    ValueType type = vals.back();
+    vals.pop_back();
+    return type;
+}
+
+ValueType Validator::pop_val(ValueType expected) {
+    ValueType actual = pop_val();
+    if (actual != expected && actual != UNKNOWN && expected != UNKNOWN) {
+        fail("type mismatch");
+    }
+    return actual == UNKNOWN ? expected : actual;
+}
+
+void Validator::push_vals(std::span<const ValueType> types) {
+    for (ValueType type : types) {
+        push_val(type);
+    }
+}
+
+void Validator::pop_vals(std::span<const ValueType> types) {
+    for (auto it = types.rbegin(); it != types.rend(); ++it) {
+        pop_val(*it);
+    }
+}
+
+void Validator::push_ctrl(uint16_t opcode, std::span<const ValueType> start_types,
+                          std::span<const ValueType> end_types) {
+    ctrls.push_back({opcode, start_types, end_types, vals.size(), false});
+    push_vals(start_types);
+}
+
+Validator::ControlEntry Validator::pop_ctrl() {
+    ControlEntry frame = ctrls.back();
+    pop_vals(frame.end_types);
+    if (vals.size() != frame.height) {
+        fail("values remaining on the stack at the end of a block");
+    }
+    ctrls.pop_back();
+    return frame;
+}
+
+const Validator::ControlEntry& Validator::label(uint32_t label_index) const {
+    if (label_index >= ctrls.size()) {
+        fail("unknown label");
+    }
+    return ctrls[ctrls.size() - 1 - label_index];
+}
+
+std::span<const ValueType> Validator::label_types(const ControlEntry& entry) {
+    // Branching to a loop re-enters it, branching to anything else leaves it
+    return entry.opcode == 0x03 ? entry.start_types : entry.end_types;
+}
+
+void Validator::set_unreachable() {
+    vals.resize(ctrls.back().height);
+    ctrls.back().unreachable = true;
+}
+
+const FunctionType& Validator::function_type(uint32_t type_index) const {
+    if (type_index >= module.types.size()) {
+        fail("unknown type");
+    }
+    return module.types[type_index];
+}
+
+FunctionType Validator::block_type(int64_t block_type) const {
+    if (block_type == -64) { // 0x40: empty block type
+        return {};
+    }
+    if (block_type < 0) { // A single value type, encoded as a negative 7-bit number
+        ValueType type = static_cast<ValueType>(block_type & 0x7f);
+        if (block_type < -64 || !is_value_type(type)) {
+            fail("invalid block type");
+        }
+        return {{}, {std::find(std::begin(VALUE_TYPES), std::end(VALUE_TYPES), type), 1}};
+    }
+    if (block_type > UINT32_MAX) {
+        fail("unknown type");
+    }
+    return function_type(static_cast<uint32_t>(block_type));
+}
+
+ValueType Validator::table_type(uint32_t table_index) const {
+    if (table_index >= module.tables.size()) {
+        fail("unknown table");
+    }
+    return module.tables[table_index];
+}
+
+void Validator::require_memory() const {
+    if (!module.has_memory) {
+        fail("unknown memory");
+    }
+}
+
+void Validator::validate_load(const Instruction& instr, ValueType type, uint32_t natural_alignment) {
+    require_memory();
+    if (instr.b > natural_alignment) {
+        fail("alignment must not be larger than natural");
+    }
+    pop_val(ValueType::I32);
+    push_val(type);
+}
+
+void Validator::validate_store(const Instruction& instr, ValueType type, uint32_t natural_alignment) {
+    require_memory();
+    if (instr.b > natural_alignment) {
+        fail("alignment must not be larger than natural");
+    }
+    pop_val(type);
+    pop_val(ValueType::I32);
+}
+
+void Validator::validate_unary(ValueType operand, ValueType result) {
+    pop_val(operand);
+    push_val(result);
+}
+
+void Validator::validate_binary(ValueType operand, ValueType result) {
+    pop_val(operand);
+    pop_val(operand);
+    push_val(result);
+}
+
+void Validator::validate_instruction(const FunctionCode& func, const Instruction& instr) {
+    switch (instr.opcode) {
+        // === CONTROL FLOW ===
+        case 0x00: // unreachable
+            set_unreachable();
+            break;
+        case 0x01: // nop
+            break;
+        case 0x02: // block
+        case 0x03: { // loop
+            FunctionType type = block_type(instr.value.i64);
+            pop_vals(type.params);
+            push_ctrl(instr.opcode, type.params, type.results);
+            break;
+        }
+        case 0x04: { // if
+            FunctionType type = block_type(instr.value.i64);
+            pop_val(ValueType::I32);
+            pop_vals(type.params);
+            push_ctrl(instr.opcode, type.params, type.results);
+            break;
+        }
+        case 0x05: { // else
+            if (ctrls.back().opcode != 0x04) {
+                fail("'else' without a matching 'if'");
+            }
+            ControlEntry frame = pop_ctrl();
+            push_ctrl(0x05, frame.start_types, frame.end_types);
+            break;
+        }
+        case 0x0B: { // end
+            ControlEntry frame = pop_ctrl();
+            // Without an else, the if's parameters fall through as its results
+            if (frame.opcode == 0x04 && !std::ranges::equal(frame.start_types, frame.end_types)) {
+                fail("'if' without 'else' must have matching parameters and results");
+            }
+            if (!ctrls.empty()) {
+                push_vals(frame.end_types);
+            }
+            break;
+        }
+        case 0x0C: // br
+            pop_vals(label_types(label(instr.a)));
+            set_unreachable();
+            break;
+        case 0x0D: { // br_if
+            pop_val(ValueType::I32);
+            std::span<const ValueType> types = label_types(label(instr.a));
+            pop_vals(types);
+            push_vals(types);
+            break;
+        }
+        case 0x0E: { // br_table
+            pop_val(ValueType::I32);
+            std::span<const ValueType> default_types = label_types(label(func.branch_table[instr.a + instr.b]));
+            for (uint32_t i = 0; i < instr.b; ++i) {
+                std::span<const ValueType> types = label_types(label(func.branch_table[instr.a + i]));
+                if (types.size() != default_types.size()) {
+                    fail("br_table targets have different arities");
+                }
+                // Check the operands against every target without consuming them
+                std::vector<ValueType> popped;
+                for (auto it = types.rbegin(); it != types.rend(); ++it) {
+                    popped.push_back(pop_val(*it));
+                }
+                for (auto it = popped.rbegin(); it != popped.rend(); ++it) {
+                    push_val(*it);
+                }
+            }
+            pop_vals(default_types);
+            set_unreachable();
+            break;
+        }
+        case 0x0F: // return
+            pop_vals(ctrls.front().end_types);
+            set_unreachable();
+            break;
+        case 0x10: { // call
+            if (instr.a >= module.function_type_indices.size()) {
+                fail("unknown function");
+            }
+            const FunctionType& type = function_type(module.function_type_indices[instr.a]);
+            pop_vals(type.params);
+            push_vals(type.results);
+            break;
+        }
+        case 0x11: { // call_indirect
+            if (table_type(instr.b) != ValueType::FUNCREF) {
+                fail("call_indirect requires a funcref table");
+            }
+            const FunctionType& type = function_type(instr.a);
+            pop_val(ValueType::I32);
+            pop_vals(type.params);
+            push_vals(type.results);
+            break;
+        }
+        case 0x12: // return_call
+        case 0x13: { // return_call_indirect
+            const FunctionType* type;
+            if (instr.opcode == 0x12) {
+                if (instr.a >= module.function_type_indices.size()) {
+                    fail("unknown function");
+                }
+                type = &function_type(module.function_type_indices[instr.a]);
+            } else {
+                if (table_type(instr.b) != ValueType::FUNCREF) {
+                    fail("return_call_indirect requires a funcref table");
+                }
+                type = &function_type(instr.a);
+                pop_val(ValueType::I32);
+            }
+            if (!std::ranges::equal(type->results, ctrls.front().end_types)) {
+                fail("tail call results do not match the function results");
+            }
+            pop_vals(type->params);
+            set_unreachable();
+            break;
+        }
+
+        // === PARAMETRIC ===
+        case 0x1A: // drop
+            pop_val();
+            break;
+        case 0x1B: { // select
+            pop_val(ValueType::I32);
+            ValueType t1 = pop_val();
+            ValueType t2 = pop_val();
+            if (!is_num(t1) || !is_num(t2)) {
+                fail("select without a type requires numeric operands");
+            }
+            if (t1 != t2 && t1 != UNKNOWN && t2 != UNKNOWN) {
+                fail("type mismatch");
+            }
+            push_val(t1 == UNKNOWN ? t2 : t1);
+            break;
+        }
+        case 0x1C: { // select t
+            ValueType type = static_cast<ValueType>(instr.a);
+            if (instr.b != 1 || !is_value_type(type)) {
+                fail("invalid result arity");
+            }
+            pop_val(ValueType::I32);
+            pop_val(type);
+            pop_val(type);
+            push_val(type);
+            break;
+        }
+
+        // === VARIABLES ===
+        case 0x20: // local.get
+        case 0x21: // local.set
+        case 0x22: { // local.tee
+            ValueType type = local_type(instr.a);
+            if (instr.opcode != 0x20) pop_val(type);
+            if (instr.opcode != 0x21) push_val(type);
+            break;
+        }
+        case 0x23: // global.get
+        case 0x24: { // global.set
+            if (instr.a >= module.globals.size()) {
+                fail("unknown global");
+            }
+            const GlobalType& global = module.globals[instr.a];
+            if (instr.opcode == 0x23) {
+                push_val(global.type);
+            } else {
+                if (!global.is_mutable) {
+                    fail("global is immutable");
+                }
+                pop_val(global.type);
+            }
+            break;
+        }
+        case 0x25: // table.get
+            pop_val(ValueType::I32);
+            push_val(table_type(instr.a));
+            break;
+        case 0x26: // table.set
+            pop_val(table_type(instr.a));
+            pop_val(ValueType::I32);
+            break;
+
+        // === LOAD AND STORE ===
+        // The last argument is the natural alignment as a power of two
+        case 0x28: validate_load(instr, ValueType::I32, 2); break; // i32.load
+        case 0x29: validate_load(instr, ValueType::I64, 3); break; // i64.load
+        case 0x2A: validate_load(instr, ValueType::F32, 2); break; // f32.load
+        case 0x2B: validate_load(instr, ValueType::F64, 3); break; // f64.load
+        case 0x2C: case 0x2D: validate_load(instr, ValueType::I32, 0); break; // i32.load8_s/u
+        case 0x2E: case 0x2F: validate_load(instr, ValueType::I32, 1); break; // i32.load16_s/u
+        case 0x30: case 0x31: validate_load(instr, ValueType::I64, 0); break; // i64.load8_s/u
+        case 0x32: case 0x33: validate_load(instr, ValueType::I64, 1); break; // i64.load16_s/u
+        case 0x34: case 0x35: validate_load(instr, ValueType::I64, 2); break; // i64.load32_s/u
+        case 0x36: validate_store(instr, ValueType::I32, 2); break; // i32.store
+        case 0x37: validate_store(instr, ValueType::I64, 3); break; // i64.store
+        case 0x38: validate_store(instr, ValueType::F32, 2); break; // f32.store
+        case 0x39: validate_store(instr, ValueType::F64, 3); break; // f64.store
+        case 0x3A: validate_store(instr, ValueType::I32, 0); break; // i32.store8
+        case 0x3B: validate_store(instr, ValueType::I32, 1); break; // i32.store16
+        case 0x3C: validate_store(instr, ValueType::I64, 0); break; // i64.store8
+        case 0x3D: validate_store(instr, ValueType::I64, 1); break; // i64.store16
+        case 0x3E: validate_store(instr, ValueType::I64, 2); break; // i64.store32
+
+        // === MEMORY ===
+        case 0x3F: // memory.size
+            require_memory();
+            push_val(ValueType::I32);
+            break;
+        case 0x40: // memory.grow
+            require_memory();
+            pop_val(ValueType::I32);
+            push_val(ValueType::I32);
+            break;
+
+        // === IMMEDIATES ===
+        case 0x41: push_val(ValueType::I32); break; // i32.const
+        case 0x42: push_val(ValueType::I64); break; // i64.const
+        case 0x43: push_val(ValueType::F32); break; // f32.const
+        case 0x44: push_val(ValueType::F64); break; // f64.const
+
+        // === NUMERIC ===
+        // The operand and result types come from the same table the interpreter's handlers are generated from
+#define VALIDATOR_NUMERIC_CASE(opcode, name, shape, Operand, Result, expression) \
+        case opcode: validate_##shape(value_type_of<Operand>(), value_type_of<Result>()); break;
+
+        WASM_NUMERIC_OPCODES(VALIDATOR_NUMERIC_CASE)
+
+#undef VALIDATOR_NUMERIC_CASE
+
+        // === REFERENCES ===
+        case 0xD0: { // ref.null
+            ValueType type = static_cast<ValueType>(instr.a);
+            if (type != ValueType::FUNCREF && type != ValueType::EXTERNREF) {
+                fail("invalid reference type");
+            }
+            push_val(type);
+            break;
+        }
+        case 0xD1: // ref.is_null
+            if (!is_ref(pop_val())) {
+                fail("type mismatch");
+            }
+            push_val(ValueType::I32);
+            break;
+        case 0xD2: // ref.func
+            if (instr.a >= module.function_type_indices.size()) {
+                fail("unknown function");
+            }
+            push_val(ValueType::FUNCREF);
+            break;
+
+        default:
+            if (instr.opcode >= PREFIX_FC) {
+                validate_prefixed_instruction(instr);
+                break;
+            }
+            fail("unknown opcode");
+    }
+}
+
+void Validator::validate_prefixed_instruction(const Instruction& instr) {
+    switch (instr.opcode - PREFIX_FC) {
+#define VALIDATOR_PREFIXED_NUMERIC_CASE(opcode, name, shape, Operand, Result, expression) \
+        case opcode: validate_##shape(value_type_of<Operand>(), value_type_of<Result>()); break;
+
+        WASM_PREFIXED_NUMERIC_OPCODES(VALIDATOR_PREFIXED_NUMERIC_CASE)
+
+#undef VALIDATOR_PREFIXED_NUMERIC_CASE
+
+        case 0x08: // memory.init
+            require_memory();
+            if (instr.a >= module.data_segment_count) {
+                fail("unknown data segment");
+            }
+            pop_vals({ValueType::I32, ValueType::I32, ValueType::I32});
+            break;
+        case 0x09: // data.drop
+            if (instr.a >= module.data_segment_count) {
+                fail("unknown data segment");
+            }
+            break;
+        case 0x0A: // memory.copy
+        case 0x0B: // memory.fill
+            require_memory();
+            pop_vals({ValueType::I32, ValueType::I32, ValueType::I32});
+            break;
+        case 0x0C: // table.init
+            table_type(instr.b);
+            if (instr.a >= module.element_segment_count) {
+                fail("unknown element segment");
+            }
+            pop_vals({ValueType::I32, ValueType::I32, ValueType::I32});
+            break;
+        case 0x0D: // elem.drop
+            if (instr.a >= module.element_segment_count) {
+                fail("unknown element segment");
+            }
+            break;
+        case 0x0E: // table.copy
+            if (table_type(instr.a) != table_type(instr.b)) {
+                fail("type mismatch");
+            }
+            pop_vals({ValueType::I32, ValueType::I32, ValueType::I32});
+            break;
+        case 0x0F: // table.grow
+            pop_val(ValueType::I32);
+            pop_val(table_type(instr.a));
+            push_val(ValueType::I32);
+            break;
+        case 0x10: // table.size
+            table_type(instr.a);
+            push_val(ValueType::I32);
+            break;
+        case 0x11: // table.fill
+            pop_val(ValueType::I32);
+            pop_val(table_type(instr.a));
+            pop_val(ValueType::I32);
+            break;
+        default:
+            fail("unknown opcode");
+    }
+}
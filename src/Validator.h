@@ -0,0 +1,104 @@
+#ifndef VALIDATOR_H
+#define VALIDATOR_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <stdexcept>
+
+#include "Module.h"
+
+/**
+ * @class Validator
+ * @brief Checks a parsed Module against the validation rules of the WebAssembly specification.
+ *
+ * Every function body is type-checked once by abstractly interpreting its instructions on a
+ * stack of value types, following the validation algorithm from the appendix of the spec.
+ * This covers operand and result types, block signatures, branch labels and all indices
+ * into the type, function, local, global, table, memory, element and data spaces.
+ *
+ * A validated module cannot underflow the operand stack, branch to a missing label or
+ * access a missing local, so the Interpreter executes it without any of these checks.
+ * While validating, the Validator also records each function's maximum operand stack
+ * height, which the Interpreter uses to reserve its frame once per call.
+ */
+class Validator {
+public:
+    /**
+     * @brief Constructs a Validator for a parsed module.
+     * @param module The Module to validate.
+     */
+    explicit Validator(Module& module);
+
+    /**
+     * @brief Validates the body of one function and records its stack limit.
+     *
+     * A body only depends on the sections before the Code section, so it can be validated
+     * as soon as it is parsed, before the bodies after it.
+     * @param code The decoded body, which receives the stack limit.
+     * @throws std::runtime_error describing the first rule that is violated.
+     */
+    void validate_function(uint32_t function_index, FunctionCode& code);
+
+    /**
+     * @brief Validates everything but the function bodies: function types, memory limits, data segments and exports.
+     * @throws std::runtime_error describing the first rule that is violated.
+     */
+    void validate_definitions();
+
+private:
+    // A block, loop, if or else that is open at the current instruction
+    struct ControlEntry {
+        uint16_t opcode;
+        std::span<const ValueType> start_types; // The block's parameters
+        std::span<const ValueType> end_types;   // The block's results
+        size_t height;                          // Operand stack height at the start of the block
+        bool unreachable;                       // Whether the rest of the block is dead code
+    };
+
+    Module& module;
+
+    uint32_t function_index;
+    size_t pc;
+    std::span<const ValueType> params;
+    std::span<const LocalDeclaration> local_declarations;
+    std::vector<uint64_t> declaration_ends; // Per declaration, the index of the local after its run
+    std::vector<ValueType> vals;
+    std::vector<ControlEntry> ctrls;
+    size_t max_height;
+
+    void validate_body(FunctionCode& code);
+    void validate_instruction(const FunctionCode& func, const Instruction& instr);
+    void validate_prefixed_instruction(const Instruction& instr);
+    void validate_exports() const;
+
+    [[noreturn]] void fail(const std::string& message) const;
+
+    void push_val(ValueType type);
+    ValueType pop_val();
+    ValueType pop_val(ValueType expected);
+    void push_vals(std::span<const ValueType> types);
+    void pop_vals(std::span<const ValueType> types);
+    void pop_vals(std::initializer_list<ValueType> types) { pop_vals(std::span<const ValueType>(types.begin(), types.size())); }
+
+    void push_ctrl(uint16_t opcode, std::span<const ValueType> start_types, std::span<const ValueType> end_types);
+    ControlEntry pop_ctrl();
+    const ControlEntry& label(uint32_t label_index) const;
+    static std::span<const ValueType> label_types(const ControlEntry& entry);
+    void set_unreachable();
+    ValueType local_type(uint32_t local_index) const;
+
+    const FunctionType& function_type(uint32_t type_index) const;
+    FunctionType block_type(int64_t block_type) const;
+    ValueType table_type(uint32_t table_index) const;
+    void require_memory() const;
+
+    void validate_load(const Instruction& instr, ValueType type, uint32_t natural_alignment);
+    void validate_store(const Instruction& instr, ValueType type, uint32_t natural_alignment);
+    void validate_unary(ValueType operand, ValueType result);
+    void validate_binary(ValueType operand, ValueType result);
+};
+
+#endif //VALIDATOR_H
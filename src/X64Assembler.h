@@ -0,0 +1,218 @@
+#ifndef X64_ASSEMBLER_H
+#define X64_ASSEMBLER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * A minimal x86-64 instruction encoder for the JIT. It only knows the handful of instruction
+ * forms the baseline compiler emits: register/register arithmetic, loads and stores with a
+ * base register and a 32-bit displacement, scalar SSE arithmetic, and rel32 jumps to labels.
+ */
+
+enum Reg : uint8_t {
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+enum Xmm : uint8_t {
+    XMM0 = 0, XMM1,
+};
+
+enum Condition : uint8_t {
+    CC_O = 0x0, CC_NO = 0x1, CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7,
+    CC_S = 0x8, CC_NS = 0x9, CC_P = 0xA, CC_NP = 0xB, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF,
+};
+
+// Opcodes of the "op r/m, reg" ALU forms
+enum AluOp : uint8_t {
+    ALU_ADD = 0x01, ALU_OR = 0x09, ALU_AND = 0x21, ALU_SUB = 0x29, ALU_XOR = 0x31, ALU_CMP = 0x39, ALU_TEST = 0x85,
+};
+
+// The /digit of the group instructions (81 /digit, D3 /digit, F7 /digit)
+enum GroupOp : uint8_t {
+    GROUP_ADD = 0, GROUP_ROL = 0, GROUP_ROR = 1, GROUP_SHL = 4, GROUP_SHR = 5, GROUP_SAR = 7, GROUP_CMP = 7,
+    GROUP_DIV = 6, GROUP_IDIV = 7,
+};
+
+/**
+ * @struct Label
+ * @brief A jump target that may be bound before or after the jumps to it are emitted.
+ */
+struct Label {
+    int64_t position = -1;           // Offset of the target in the code, -1 while unbound
+    std::vector<size_t> fixups;      // Offsets of the rel32 fields that jump here
+};
+
+class X64Assembler {
+public:
+    std::vector<uint8_t> code;
+
+    size_t position() const { return code.size(); }
+
+    void bind(Label& label) {
+        label.position = static_cast<int64_t>(code.size());
+        for (size_t fixup : label.fixups) {
+            patch_rel32(fixup, label.position);
+        }
+        label.fixups.clear();
+    }
+
+    void jmp(Label& label) {
+        emit(0xE9);
+        emit_rel32(label);
+    }
+
+    void jcc(Condition cc, Label& label) {
+        emit(0x0F);
+        emit(0x80 | cc);
+        emit_rel32(label);
+    }
+
+    // mov dst, [base + disp]
+    void load64(Reg dst, Reg base, int32_t disp) { rex(true, dst, base); emit(0x8B); modrm_mem(dst, base, disp); }
+    void load32(Reg dst, Reg base, int32_t disp) { rex(false, dst, base); emit(0x8B); modrm_mem(dst, base, disp); }
+
+    // movzx/movsx dst, byte/word [base + disp]; `op` is 0xB6, 0xB7, 0xBE or 0xBF
+    void load_extend(uint8_t op, bool wide, Reg dst, Reg base, int32_t disp) {
+        rex(wide, dst, base);
+        emit(0x0F);
+        emit(op);
+        modrm_mem(dst, base, disp);
+    }
+
+    // movsxd dst, dword [base + disp]
+    void load_sign_extend32(Reg dst, Reg base, int32_t disp) { rex(true, dst, base); emit(0x63); modrm_mem(dst, base, disp); }
+
+    // mov [base + disp], src
+    void store64(Reg base, int32_t disp, Reg src) { rex(true, src, base); emit(0x89); modrm_mem(src, base, disp); }
+    void store32(Reg base, int32_t disp, Reg src) { rex(false, src, base); emit(0x89); modrm_mem(src, base, disp); }
+    void store16(Reg base, int32_t disp, Reg src) { emit(0x66); rex(false, src, base); emit(0x89); modrm_mem(src, base, disp); }
+    void store8(Reg base, int32_t disp, Reg src) { rex(false, src, base, src >= RSP); emit(0x88); modrm_mem(src, base, disp); }
+
+    // cmp reg, [base + disp]
+    void cmp_mem(bool wide, Reg reg, Reg base, int32_t disp) { rex(wide, reg, base); emit(0x3B); modrm_mem(reg, base, disp); }
+
+    // lea dst, [base + disp]
+    void lea(Reg dst, Reg base, int32_t disp) { rex(true, dst, base); emit(0x8D); modrm_mem(dst, base, disp); }
+
+    void mov_imm64(Reg dst, uint64_t imm) { rex(true, 0, dst); emit(0xB8 | (dst & 7)); emit64(imm); }
+    void mov_imm32(Reg dst, uint32_t imm) { rex(false, 0, dst); emit(0xB8 | (dst & 7)); emit32(imm); }
+
+    void mov(bool wide, Reg dst, Reg src) { rex(wide, src, dst); emit(0x89); modrm_reg(src, dst); }
+
+    // op dst, src
+    void alu(AluOp op, bool wide, Reg dst, Reg src) { rex(wide, src, dst); emit(op); modrm_reg(src, dst); }
+
+    // op dst, imm32 (add/cmp with a sign-extended immediate)
+    void alu_imm32(GroupOp op, bool wide, Reg dst, int32_t imm) { rex(wide, 0, dst); emit(0x81); modrm_reg(op, dst); emit32(imm); }
+
+    void imul(bool wide, Reg dst, Reg src) { rex(wide, dst, src); emit(0x0F); emit(0xAF); modrm_reg(dst, src); }
+
+    // shl/shr/sar/rol/ror dst, cl
+    void shift_cl(GroupOp op, bool wide, Reg dst) { rex(wide, 0, dst); emit(0xD3); modrm_reg(op, dst); }
+
+    // shl/shr/sar dst, imm8
+    void shift_imm(GroupOp op, bool wide, Reg dst, uint8_t imm) { rex(wide, 0, dst); emit(0xC1); modrm_reg(op, dst); emit(imm); }
+
+    // div/idiv src, dividing rdx:rax
+    void divide(GroupOp op, bool wide, Reg src) { rex(wide, 0, src); emit(0xF7); modrm_reg(op, src); }
+
+    // cdq / cqo
+    void sign_extend_accumulator(bool wide) { rex(wide, 0, 0); emit(0x99); }
+
+    // setcc dst8 followed by movzx dst32, dst8
+    void setcc(Condition cc, Reg dst) {
+        rex(false, 0, dst, dst >= RSP);
+        emit(0x0F);
+        emit(0x90 | cc);
+        modrm_reg(0, dst);
+        rex(false, dst, dst, dst >= RSP);
+        emit(0x0F);
+        emit(0xB6);
+        modrm_reg(dst, dst);
+    }
+
+    void cmov(Condition cc, bool wide, Reg dst, Reg src) { rex(wide, dst, src); emit(0x0F); emit(0x40 | cc); modrm_reg(dst, src); }
+
+    void call(Reg target) { rex(false, 0, target); emit(0xFF); modrm_reg(2, target); }
+
+    void push(Reg reg) { rex(false, 0, reg); emit(0x50 | (reg & 7)); }
+    void pop(Reg reg) { rex(false, 0, reg); emit(0x58 | (reg & 7)); }
+    void ret() { emit(0xC3); }
+
+    // movss/movsd xmm, [base + disp] and back; `prefix` is 0xF3 for f32 and 0xF2 for f64
+    void sse_load(uint8_t prefix, Xmm dst, Reg base, int32_t disp) {
+        emit(prefix); rex(false, dst, base); emit(0x0F); emit(0x10); modrm_mem(dst, base, disp);
+    }
+    void sse_store(uint8_t prefix, Reg base, int32_t disp, Xmm src) {
+        emit(prefix); rex(false, src, base); emit(0x0F); emit(0x11); modrm_mem(src, base, disp);
+    }
+
+    // addss/subss/mulss/divss/sqrtss dst, src (and the sd forms)
+    void sse_op(uint8_t prefix, uint8_t op, Xmm dst, Xmm src) {
+        emit(prefix); rex(false, dst, src); emit(0x0F); emit(op); modrm_reg(dst, src);
+    }
+
+    // ucomiss/ucomisd a, b
+    void ucomis(bool is_double, Xmm a, Xmm b) {
+        if (is_double) emit(0x66);
+        rex(false, a, b);
+        emit(0x0F);
+        emit(0x2E);
+        modrm_reg(a, b);
+    }
+
+private:
+    void emit(uint8_t byte) { code.push_back(byte); }
+
+    void emit32(uint32_t value) {
+        uint8_t bytes[4];
+        std::memcpy(bytes, &value, 4);
+        code.insert(code.end(), bytes, bytes + 4);
+    }
+
+    void emit64(uint64_t value) {
+        uint8_t bytes[8];
+        std::memcpy(bytes, &value, 8);
+        code.insert(code.end(), bytes, bytes + 8);
+    }
+
+    void emit_rel32(Label& label) {
+        size_t fixup = code.size();
+        emit32(0);
+        if (label.position >= 0) {
+            patch_rel32(fixup, label.position);
+        } else {
+            label.fixups.push_back(fixup);
+        }
+    }
+
+    void patch_rel32(size_t fixup, int64_t target) {
+        int32_t rel = static_cast<int32_t>(target - static_cast<int64_t>(fixup + 4));
+        std::memcpy(&code[fixup], &rel, 4);
+    }
+
+    // Emits a REX prefix when the operand size is 64 bits or an extended register is used.
+    // `force` is needed to address the low byte of rsp, rbp, rsi and rdi.
+    void rex(bool wide, uint8_t reg, uint8_t rm, bool force = false) {
+        uint8_t prefix = 0x40 | (wide ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) | ((rm & 8) ? 0x01 : 0);
+        if (prefix != 0x40 || force) {
+            emit(prefix);
+        }
+    }
+
+    void modrm_reg(uint8_t reg, uint8_t rm) { emit(0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+
+    // [base + disp32]; rsp and r12 as base need a SIB byte
+    void modrm_mem(uint8_t reg, uint8_t base, int32_t disp) {
+        emit(0x80 | ((reg & 7) << 3) | (base & 7));
+        if ((base & 7) == 4) {
+            emit(0x24);
+        }
+        emit32(static_cast<uint32_t>(disp));
+    }
+};
+
+#endif //X64_ASSEMBLER_H
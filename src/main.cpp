@@ -1,22 +1,47 @@
-#include <fstream>
+#include <cstdio>
+#include <string>
 #include <vector>
 
-#include "Module.h"
-#include "Parser.h"
+#include "CompiledModule.h"
+#include "StreamingParser.h"
 
-std::vector<uint8_t> load_wasm_file(const std::string& path) {
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open()) throw std::runtime_error("Failed to open file: " + path);
-    return {(std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()};
+// A path of "-" reads the module from standard input, compiling it while it arrives. The cache
+// is keyed by the whole binary, so with a cache directory the input is read in full first.
+static std::shared_ptr<const CompiledModule> compile_from_stdin(const CompileOptions& compile_options) {
+    uint8_t chunk[65536];
+    size_t size;
+    if (!compile_options.cache_directory.empty()) {
+        std::vector<uint8_t> binary;
+        while ((size = std::fread(chunk, 1, sizeof(chunk), stdin)) > 0) {
+            binary.insert(binary.end(), chunk, chunk + size);
+        }
+        return CompiledModule::compile(std::move(binary), compile_options);
+    }
+
+    StreamingParser streaming_parser;
+    while ((size = std::fread(chunk, 1, sizeof(chunk), stdin)) > 0) {
+        streaming_parser.feed(std::span<const uint8_t>(chunk, size));
+    }
+    return streaming_parser.finish();
 }
 
+// Usage: webassembly_interpreter [--cache-dir DIR] module.wasm
+// With a cache directory, a module compiled by an earlier run is loaded from the cache instead
 int main(int argc, char* argv[]) {
-    std::string wasm_path = argv[1];
+    CompileOptions compile_options;
+    int argument = 1;
+    if (argument + 1 < argc && std::string(argv[argument]) == "--cache-dir") {
+        compile_options.cache_directory = argv[argument + 1];
+        argument += 2;
+    }
+    if (argument >= argc) {
+        std::fprintf(stderr, "Usage: %s [--cache-dir DIR] module.wasm\n", argv[0]);
+        return 1;
+    }
+    std::string wasm_path = argv[argument];
 
-    auto wasm_binary = load_wasm_file(wasm_path);
-    Module my_module;
-    Parser parser(wasm_binary);
-    parser.parse_into(my_module);
+    auto compiled_module = wasm_path == "-" ? compile_from_stdin(compile_options)
+                                            : CompiledModule::compile(ModuleBinary::map_file(wasm_path), compile_options);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,6 +1,131 @@
 #include "TestSuite.h"
 #include <iostream>
 #include <cstring>
+#include <vector>
+#include <algorithm>
+
+static void append_u32(std::vector<uint8_t>& bytes, uint32_t value) {
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        bytes.push_back(value != 0 ? byte | 0x80 : byte);
+    } while (value != 0);
+}
+
+static void append_s32(std::vector<uint8_t>& bytes, int32_t value) {
+    while (true) {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40))) {
+            bytes.push_back(byte);
+            return;
+        }
+        bytes.push_back(byte | 0x80);
+    }
+}
+
+static void append_section(std::vector<uint8_t>& binary, uint8_t id, const std::vector<uint8_t>& contents) {
+    binary.push_back(id);
+    append_u32(binary, contents.size());
+    binary.insert(binary.end(), contents.begin(), contents.end());
+}
+
+std::vector<uint8_t> TestModule::assemble() const {
+    std::vector<uint8_t> binary = {0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00};
+
+    std::vector<uint8_t> types, function_types, code;
+    append_u32(types, functions.size());
+    append_u32(function_types, functions.size());
+    append_u32(code, functions.size());
+    for (uint32_t i = 0; i < functions.size(); ++i) {
+        const TestFunction& function = functions[i];
+        types.push_back(0x60);
+        append_u32(types, function.params.size());
+        types.insert(types.end(), function.params.begin(), function.params.end());
+        append_u32(types, function.results.size());
+        types.insert(types.end(), function.results.begin(), function.results.end());
+        append_u32(function_types, i);
+        append_u32(code, function.body.size());
+        code.insert(code.end(), function.body.begin(), function.body.end());
+    }
+
+    append_section(binary, 1, types);
+    append_section(binary, 3, function_types);
+    if (!memory.empty()) {
+        std::vector<uint8_t> memories = {0x01};
+        memories.insert(memories.end(), memory.begin(), memory.end());
+        append_section(binary, 5, memories);
+    }
+    if (!globals.empty()) {
+        std::vector<uint8_t> global_section;
+        append_u32(global_section, globals.size());
+        for (int32_t value : globals) {
+            global_section.insert(global_section.end(), {0x7f, 0x01, 0x41});
+            append_s32(global_section, value);
+            global_section.push_back(0x0b);
+        }
+        append_section(binary, 6, global_section);
+    }
+    append_section(binary, 10, code);
+    if (!data.empty()) {
+        std::vector<uint8_t> data_section;
+        append_u32(data_section, data.size());
+        for (const auto& [offset, bytes] : data) {
+            data_section.insert(data_section.end(), {0x00, 0x41});
+            append_s32(data_section, static_cast<int32_t>(offset));
+            data_section.push_back(0x0b);
+            append_u32(data_section, bytes.size());
+            data_section.insert(data_section.end(), bytes.begin(), bytes.end());
+        }
+        append_section(binary, 11, data_section);
+    }
+    return binary;
+}
+
+static bool same_register_code(std::span<const RegisterInstruction> expected, std::span<const RegisterInstruction> actual) {
+    return std::equal(expected.begin(), expected.end(), actual.begin(), actual.end(),
+                      [](const RegisterInstruction& a, const RegisterInstruction& b) {
+                          return a.opcode == b.opcode && a.r == b.r && a.a == b.a && a.b == b.b && a.imm.i64 == b.imm.i64;
+                      });
+}
+
+bool same_compiled_module(const Module& expected, const Module& actual) {
+    if (expected.functions.size() != actual.functions.size() || expected.exports.size() != actual.exports.size() ||
+        expected.globals.size() != actual.globals.size() || expected.data_segments.size() != actual.data_segments.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < expected.functions.size(); ++i) {
+        const FrameLayout& a = expected.functions.frames[i];
+        const FrameLayout& b = actual.functions.frames[i];
+        if (a.param_count != b.param_count || a.local_count != b.local_count || a.result_count != b.result_count ||
+            a.max_stack_height != b.max_stack_height ||
+            expected.function_type_indices[i] != actual.function_type_indices[i] ||
+            !same_register_code(expected.functions.register_code[i], actual.functions.register_code[i]) ||
+            !std::ranges::equal(expected.functions.register_branch_table[i], actual.functions.register_branch_table[i])) {
+            std::cout << "Function " << i << " differs" << std::endl;
+            return false;
+        }
+    }
+    for (size_t i = 0; i < expected.exports.size(); ++i) {
+        if (expected.exports[i].name != actual.exports[i].name || expected.exports[i].kind != actual.exports[i].kind ||
+            expected.exports[i].index != actual.exports[i].index) {
+            return false;
+        }
+    }
+    // Only the i32 of an initial value is set, as globals are only initialized with i32.const
+    for (size_t i = 0; i < expected.globals.size(); ++i) {
+        if (expected.globals[i].type != actual.globals[i].type || expected.globals[i].initial_value.i32 != actual.globals[i].initial_value.i32) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < expected.data_segments.size(); ++i) {
+        if (expected.data_segments[i].memory_offset != actual.data_segments[i].memory_offset ||
+            !std::ranges::equal(expected.data_segments[i].bytes, actual.data_segments[i].bytes)) {
+            return false;
+        }
+    }
+    return true;
+}
 
 VerificationFn expect_i32(uint32_t address, int32_t expected_value) {
     return [address, expected_value](const Interpreter& interpreter) {
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <cstdint>
+#include <utility>
 #include "../src/Interpreter.h"
 
 using VerificationFn = std::function<bool(const Interpreter&)>;
@@ -20,6 +22,43 @@ struct TestSuite {
     std::vector<Test> tests;
 };
 
+// A test of the embedding API that takes more than invoking one function of a module, such as
+// a module that must fail to compile, or an instance pool whose resets fail
+using HostCheckFn = std::function<bool()>;
+
+struct HostTest {
+    std::string name;
+    HostCheckFn check;
+};
+
+struct HostTestSuite {
+    std::string name;
+    std::vector<HostTest> tests;
+};
+
+// A function of a TestModule: the value types of its parameters and results, and its body,
+// the local declarations followed by the instructions up to and including the final end
+struct TestFunction {
+    std::vector<uint8_t> params;
+    std::vector<uint8_t> results;
+    std::vector<uint8_t> body;
+};
+
+// A small module for host tests, for which no wasm file is worth keeping
+struct TestModule {
+    std::vector<TestFunction> functions;
+    std::vector<uint8_t> memory; // The limits of its memory, such as {0x01, 1, 2} for 1 to 2 pages, or empty for none
+    std::vector<int32_t> globals; // The initial values of its globals, which are mutable i32s
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> data; // Its active data segments: the offset and the bytes
+
+    // The binary, with a type of its own for every function
+    std::vector<uint8_t> assemble() const;
+};
+
+// Whether two compilations of a binary produced the same module: the same frame layouts and
+// register code for every function, and the same exports, globals and data segments
+bool same_compiled_module(const Module& expected, const Module& actual);
+
 VerificationFn expect_i32(uint32_t address, int32_t expected_value) ;
 VerificationFn expect_f32(uint32_t address, float expected_value);
 VerificationFn expect_f64_low32(uint32_t address, double expected_value);
@@ -0,0 +1,75 @@
+#include "TestSuite.h"
+#include "../src/InstancePool.h"
+#include <iostream>
+#include <stdexcept>
+
+// A pool whose resets fail, and whose replacement instances fail as well once make_fails is set
+class FailingResetPool : public InstancePool {
+public:
+    using InstancePool::InstancePool;
+
+    bool make_fails = false;
+
+protected:
+    std::unique_ptr<Interpreter> make_instance() const override {
+        if (make_fails) {
+            throw std::runtime_error("Failed to allocate linear memory");
+        }
+        return InstancePool::make_instance();
+    }
+
+    void reset_instance(Interpreter&) const override {
+        throw std::runtime_error("Failed to restore linear memory");
+    }
+};
+
+static std::shared_ptr<const CompiledModule> pool_test_module() {
+    return CompiledModule::compile(ModuleBinary::map_file(std::string(WASM_TEST_DIR) + "/01_test.wasm"));
+}
+
+const HostTestSuite test_10 = {
+    "Test10 (instance pool)",
+    {
+        {"InstancePool: A failed reset replaces the instance", [] {
+            FailingResetPool pool(pool_test_module(), 1);
+            {
+                InstancePool::Lease lease = pool.try_acquire();
+                if (!lease || !lease->invoke(0).ok()) {
+                    return false;
+                }
+            } // The reset throws, a new instance takes the slot
+            InstancePool::Lease lease = pool.try_acquire();
+            std::cout << "Retired: " << pool.retired() << ", leased again: " << static_cast<bool>(lease) << std::endl;
+            return pool.retired() == 0 && lease && lease->get_memory_i32(0) == 0;
+        }},
+        {"InstancePool: A slot that cannot be replaced is retired", [] {
+            FailingResetPool pool(pool_test_module(), 2);
+            pool.make_fails = true;
+            {
+                InstancePool::Lease first = pool.try_acquire();
+                InstancePool::Lease second = pool.try_acquire();
+                if (!first || !second) {
+                    return false;
+                }
+                first = std::move(second); // Returns the first instance, from a noexcept move
+            } // Returns the second one, from a destructor
+            InstancePool::Lease lease = pool.try_acquire();
+            std::cout << "Retired: " << pool.retired() << ", leased again: " << static_cast<bool>(lease) << std::endl;
+            return pool.retired() == 2 && !lease;
+        }},
+        {"InstancePool: Leases end without the retired slots", [] {
+            FailingResetPool pool(pool_test_module(), 2);
+            {
+                InstancePool::Lease lease = pool.try_acquire();
+            }
+            pool.make_fails = true;
+            {
+                InstancePool::Lease lease = pool.try_acquire();
+            }
+            InstancePool::Lease first = pool.try_acquire();
+            InstancePool::Lease second = pool.try_acquire();
+            std::cout << "Retired: " << pool.retired() << std::endl;
+            return pool.retired() == 1 && first && !second;
+        }},
+    }
+};
@@ -0,0 +1,105 @@
+#include "TestSuite.h"
+#include "../src/ModuleCache.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+static const std::string cache_test_wasm = std::string(WASM_TEST_DIR) + "/01_test.wasm";
+
+// A cache directory of its own, emptied, holding the artifact of 01_test.wasm
+static std::string fresh_cache_with_artifact() {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "wasm_interpreter_test_cache";
+    std::filesystem::remove_all(directory);
+    CompiledModule::compile(ModuleBinary::map_file(cache_test_wasm), CompileOptions{.cache_directory = directory.string()});
+    return directory.string();
+}
+
+static std::vector<uint8_t> read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Compiles with the cache, which must recompile, and checks the module runs and is stored again
+static bool recompiles_and_runs(const std::string& directory, std::span<const uint8_t> binary) {
+    auto compiled_module = CompiledModule::compile(ModuleBinary::map_file(cache_test_wasm),
+                                                   CompileOptions{.cache_directory = directory});
+    Interpreter instance(compiled_module);
+    bool runs = instance.invoke(0).ok() && instance.get_memory_i32(0) == 42;
+    bool stored_again = ModuleCache(directory).load(binary).has_value();
+    std::cout << "Runs: " << runs << ", stored again: " << stored_again << std::endl;
+    return runs && stored_again;
+}
+
+const HostTestSuite test_11 = {
+    "Test11 (module cache)",
+    {
+        {"ModuleCache: A stored artifact is loaded", [] {
+            std::string directory = fresh_cache_with_artifact();
+            ModuleBinary binary = ModuleBinary::map_file(cache_test_wasm);
+            return ModuleCache(directory).load(binary.bytes()).has_value();
+        }},
+        {"ModuleCache: A corrupted artifact is rejected and recompiled", [] {
+            std::string directory = fresh_cache_with_artifact();
+            ModuleBinary binary = ModuleBinary::map_file(cache_test_wasm);
+            std::string path = ModuleCache(directory).artifact_path(binary.bytes());
+            std::vector<uint8_t> artifact = read_file(path);
+            artifact[artifact.size() * 3 / 4] ^= 0x40; // Somewhere in the code
+            write_file(path, artifact);
+            if (ModuleCache(directory).load(binary.bytes()).has_value()) {
+                return false;
+            }
+            return recompiles_and_runs(directory, binary.bytes());
+        }},
+        {"ModuleCache: A truncated artifact is rejected and recompiled", [] {
+            std::string directory = fresh_cache_with_artifact();
+            ModuleBinary binary = ModuleBinary::map_file(cache_test_wasm);
+            std::string path = ModuleCache(directory).artifact_path(binary.bytes());
+            std::vector<uint8_t> artifact = read_file(path);
+            artifact.resize(artifact.size() / 2);
+            write_file(path, artifact);
+            if (ModuleCache(directory).load(binary.bytes()).has_value()) {
+                return false;
+            }
+            return recompiles_and_runs(directory, binary.bytes());
+        }},
+        {"ModuleCache: An artifact of another binary with the same name is rejected", [] {
+            // Another binary of the same size, whose function 0 stores 43 instead of 42
+            std::string directory = fresh_cache_with_artifact();
+            ModuleBinary binary = ModuleBinary::map_file(cache_test_wasm);
+            std::vector<uint8_t> other(binary.bytes().begin(), binary.bytes().end());
+            const uint8_t i32_const_42[] = {0x41, 0x2a};
+            auto constant = std::search(other.begin(), other.end(), std::begin(i32_const_42), std::end(i32_const_42));
+            constant[1] = 0x2b;
+            ModuleCache cache(directory);
+            std::string other_path = cache.artifact_path(other);
+            CompiledModule::compile(other, CompileOptions{.cache_directory = directory});
+
+            // As if the hashes collided: the header names the size and hash of 01_test.wasm
+            std::vector<uint8_t> artifact = read_file(other_path);
+            std::vector<uint8_t> own_artifact = read_file(cache.artifact_path(binary.bytes()));
+            constexpr size_t BINARY_SIZE_OFFSET = 32, BINARY_HASH_END = 56;
+            std::copy(own_artifact.begin() + BINARY_SIZE_OFFSET, own_artifact.begin() + BINARY_HASH_END,
+                      artifact.begin() + BINARY_SIZE_OFFSET);
+            write_file(cache.artifact_path(binary.bytes()), artifact);
+            if (cache.load(binary.bytes()).has_value()) {
+                return false;
+            }
+            return recompiles_and_runs(directory, binary.bytes());
+        }},
+        {"ModuleCache: Compiling a module again writes the same artifact", [] {
+            std::string directory = fresh_cache_with_artifact();
+            ModuleBinary binary = ModuleBinary::map_file(cache_test_wasm);
+            std::string path = ModuleCache(directory).artifact_path(binary.bytes());
+            std::vector<uint8_t> artifact = read_file(path);
+            std::filesystem::remove(path);
+            CompiledModule::compile(ModuleBinary::map_file(cache_test_wasm), CompileOptions{.cache_directory = directory});
+            return !artifact.empty() && read_file(path) == artifact;
+        }},
+    }
+};
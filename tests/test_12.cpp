@@ -0,0 +1,102 @@
+#include "TestSuite.h"
+#include "../src/Leb128.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Decodes the number at the start of `bytes`, followed by `padding` more bytes, which long
+// enough paddings take the word-at-a-time path for and short ones the byte loop
+template <typename T>
+static std::string decode_with_padding(std::vector<uint8_t> bytes, size_t padding, T& value, size_t& length) {
+    bytes.resize(bytes.size() + padding, 0x00);
+    size_t offset = 0;
+    try {
+        value = decode_leb128<T>(bytes, offset, "end of the bytes");
+    } catch (const std::runtime_error& e) {
+        std::cout << "Error: " << e.what() << std::endl;
+        return e.what();
+    }
+    length = offset;
+    return "";
+}
+
+// Whether a number fails with `message` both with 8 bytes to spare and with none
+template <typename T>
+static bool rejects(const std::vector<uint8_t>& bytes, const std::string& message) {
+    for (size_t padding : {size_t{0}, size_t{8}}) {
+        T value;
+        size_t length;
+        if (decode_with_padding<T>(bytes, padding, value, length) != message) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether a number decodes to `expected` and takes all of its bytes, with 8 bytes to spare and with none
+template <typename T>
+static bool decodes(const std::vector<uint8_t>& bytes, T expected) {
+    for (size_t padding : {size_t{0}, size_t{8}}) {
+        T value = 0;
+        size_t length = 0;
+        if (!decode_with_padding<T>(bytes, padding, value, length).empty() || value != expected || length != bytes.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const HostTestSuite test_12 = {
+    "Test12 (LEB128)",
+    {
+        {"LEB128: Numbers padded to the full length decode", [] {
+            return decodes<uint32_t>({0x85, 0x80, 0x80, 0x80, 0x00}, 5) &&
+                   decodes<int32_t>({0xff, 0xff, 0xff, 0xff, 0x7f}, -1) &&
+                   decodes<uint32_t>({0xff, 0xff, 0xff, 0xff, 0x0f}, UINT32_MAX) &&
+                   decodes<int32_t>({0x80, 0x80, 0x80, 0x80, 0x78}, INT32_MIN) &&
+                   decodes<int64_t>({0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f}, -1);
+        }},
+        {"LEB128: A number longer than its type needs is rejected", [] {
+            return rejects<uint32_t>({0x80, 0x80, 0x80, 0x80, 0x80, 0x00}, "Malformed LEB128 number.") &&
+                   rejects<int32_t>({0xff, 0xff, 0xff, 0xff, 0xff, 0x7f}, "Malformed LEB128 number.") &&
+                   rejects<uint64_t>({0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00},
+                                     "Malformed LEB128 number.");
+        }},
+        {"LEB128: Unused bits set in the last byte are rejected", [] {
+            return rejects<uint32_t>({0xff, 0xff, 0xff, 0xff, 0x1f}, "Malformed LEB128 number.") &&
+                   rejects<uint32_t>({0x80, 0x80, 0x80, 0x80, 0x70}, "Malformed LEB128 number.") &&
+                   // Bits past the sign bit must be copies of it
+                   rejects<int32_t>({0xff, 0xff, 0xff, 0xff, 0x4f}, "Malformed LEB128 number.") &&
+                   rejects<int32_t>({0x80, 0x80, 0x80, 0x80, 0x08}, "Malformed LEB128 number.") &&
+                   rejects<uint64_t>({0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x02},
+                                     "Malformed LEB128 number.") &&
+                   rejects<int64_t>({0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3f},
+                                    "Malformed LEB128 number.");
+        }},
+        {"LEB128: A number cut off by the end of the bytes is rejected", [] {
+            for (size_t length = 1; length <= 4; ++length) {
+                uint32_t value;
+                size_t decoded_length;
+                if (decode_with_padding<uint32_t>(std::vector<uint8_t>(length, 0x80), 0, value, decoded_length) != "end of the bytes") {
+                    return false;
+                }
+            }
+            uint64_t value;
+            size_t decoded_length;
+            return decode_with_padding<uint64_t>({0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80}, 0, value, decoded_length) ==
+                   "end of the bytes";
+        }},
+        {"LEB128: A module with a malformed number fails to compile", [] {
+            // A Type section whose count takes six bytes
+            std::vector<uint8_t> binary = {0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,
+                                           0x01, 0x06, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00};
+            try {
+                CompiledModule::compile(binary);
+            } catch (const std::runtime_error& e) {
+                std::cout << "Error: " << e.what() << std::endl;
+                return std::string(e.what()) == "Malformed LEB128 number.";
+            }
+            return false;
+        }},
+    },
+};
@@ -0,0 +1,71 @@
+#include "TestSuite.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+static constexpr uint8_t I32 = 0x7f;
+static constexpr uint8_t I64 = 0x7e;
+
+// Whether a module fails to compile with a validation error that ends in `reason`
+static bool fails_validation(const TestModule& module, const std::string& reason) {
+    try {
+        CompiledModule::compile(module.assemble());
+    } catch (const std::runtime_error& e) {
+        std::string message = e.what();
+        std::cout << "Error: " << message << std::endl;
+        return message.starts_with("Validation failed") && message.ends_with(reason);
+    }
+    return false;
+}
+
+const HostTestSuite test_13 = {
+    "Test13 (validation)",
+    {
+        {"Validator: A well-typed function is accepted", [] {
+            // i64.add of a parameter and a constant, wrapped to an i32
+            auto compiled_module = CompiledModule::compile(
+                TestModule{{{{I64}, {I32}, {0x00, 0x20, 0x00, 0x42, 0x01, 0x7c, 0xa7, 0x0b}}}}.assemble());
+            return compiled_module->module().functions.size() == 1;
+        }},
+        {"Validator: An operand of the wrong type is rejected", [] {
+            // i32.add of an i64 and an i32
+            return fails_validation({{{{}, {I32}, {0x00, 0x42, 0x01, 0x41, 0x02, 0x6a, 0x0b}}}}, "type mismatch");
+        }},
+        {"Validator: A result of the wrong type is rejected", [] {
+            return fails_validation({{{{}, {I32}, {0x00, 0x42, 0x01, 0x0b}}}}, "type mismatch");
+        }},
+        {"Validator: Popping from an empty operand stack is rejected", [] {
+            return fails_validation({{{{}, {I32}, {0x00, 0x41, 0x01, 0x6a, 0x0b}}}}, "operand stack underflow");
+        }},
+        {"Validator: Values left at the end of a block are rejected", [] {
+            return fails_validation({{{{}, {}, {0x00, 0x02, 0x40, 0x41, 0x01, 0x0b, 0x0b}}}},
+                                    "values remaining on the stack at the end of a block");
+        }},
+        {"Validator: Unknown locals, labels and functions are rejected", [] {
+            return fails_validation({{{{I64}, {I64}, {0x01, 0x01, I32, 0x20, 0x02, 0x0b}}}}, "unknown local") &&
+                   fails_validation({{{{}, {}, {0x00, 0x0c, 0x01, 0x0b}}}}, "unknown label") &&
+                   fails_validation({{{{}, {}, {0x00, 0x10, 0x01, 0x0b}}}}, "unknown function");
+        }},
+        {"Validator: A load without a memory is rejected", [] {
+            return fails_validation({{{{}, {I32}, {0x00, 0x41, 0x00, 0x28, 0x02, 0x00, 0x0b}}}}, "unknown memory");
+        }},
+        {"Validator: Compiled lazily, an invalid function is rejected on its call", [] {
+            TestModule module = {{
+                {{}, {}, {0x00, 0x0b}},
+                {{}, {I32}, {0x00, 0x42, 0x01, 0x0b}},
+            }};
+            auto compiled_module = CompiledModule::compile(module.assemble(), CompileOptions{.lazy = true});
+            Interpreter instance(compiled_module);
+            if (!instance.invoke(0).ok()) {
+                return false;
+            }
+            try {
+                instance.invoke(1);
+            } catch (const std::runtime_error& e) {
+                std::cout << "Error: " << e.what() << std::endl;
+                return std::string(e.what()).ends_with("type mismatch");
+            }
+            return false;
+        }},
+    },
+};
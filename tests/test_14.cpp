@@ -0,0 +1,141 @@
+#include "TestSuite.h"
+#include "../src/LinearMemory.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Functions that store what memory.grow returns at address 0 and memory.size at address 4
+static TestModule growing_module(std::vector<uint8_t> memory) {
+    return {{
+        // memory.grow 1
+        {{}, {}, {0x00, 0x41, 0x00, 0x41, 0x01, 0x40, 0x00, 0x36, 0x02, 0x00, 0x0b}},
+        // memory.grow 65536, all of the 4 GiB a memory can have
+        {{}, {}, {0x00, 0x41, 0x00, 0x41, 0x80, 0x80, 0x04, 0x40, 0x00, 0x36, 0x02, 0x00, 0x0b}},
+        // memory.size
+        {{}, {}, {0x00, 0x41, 0x04, 0x3f, 0x00, 0x36, 0x02, 0x00, 0x0b}},
+        // Stores 7 at the start of the second page
+        {{}, {}, {0x00, 0x41, 0x80, 0x80, 0x04, 0x41, 0x07, 0x36, 0x02, 0x00, 0x0b}},
+    }, std::move(memory)};
+}
+
+// Runs functions of the growing module and checks what the last of them stored at an address
+static bool invokes_and_stores(Interpreter& instance, std::initializer_list<uint32_t> function_indices,
+                               uint32_t address, int32_t expected_value) {
+    for (uint32_t function_index : function_indices) {
+        if (!instance.invoke(function_index).ok()) {
+            return false;
+        }
+    }
+    return expect_i32(address, expected_value)(instance);
+}
+
+// The same checks, interpreted and compiled
+static bool with_and_without_jit(const std::function<bool(const TieringPolicy&)>& check) {
+    return check(TieringPolicy{}) && check(TieringPolicy{0, 0});
+}
+
+// Functions that store at and load from the last four bytes of the first page, and one past them
+static TestModule bounds_module(std::vector<uint8_t> memory) {
+    return {{
+        {{}, {}, {0x00, 0x41, 0xfc, 0xff, 0x03, 0x41, 0x01, 0x36, 0x02, 0x00, 0x0b}},
+        {{}, {}, {0x00, 0x41, 0xfd, 0xff, 0x03, 0x41, 0x01, 0x36, 0x02, 0x00, 0x0b}},
+        {{}, {}, {0x00, 0x41, 0xfc, 0xff, 0x03, 0x28, 0x02, 0x00, 0x1a, 0x0b}},
+        {{}, {}, {0x00, 0x41, 0xfd, 0xff, 0x03, 0x28, 0x02, 0x00, 0x1a, 0x0b}},
+    }, std::move(memory)};
+}
+
+// Whether the accesses in the last bytes of a one page memory run and those past them trap
+static bool traps_past_the_end(const std::vector<uint8_t>& memory) {
+    auto compiled_module = CompiledModule::compile(bounds_module(memory).assemble());
+    return with_and_without_jit([&](const TieringPolicy& tiering_policy) {
+        Interpreter instance(compiled_module, tiering_policy);
+        InvokeResult store_past_the_end = instance.invoke(1);
+        InvokeResult load_past_the_end = instance.invoke(3);
+        std::cout << "Checked: " << LinearMemory::checks_bounds(compiled_module->module().memory_max_pages)
+                  << ", traps: " << trap_message(store_past_the_end.trap) << ", " << trap_message(load_past_the_end.trap) << std::endl;
+        return instance.invoke(0).ok() && instance.invoke(2).ok() &&
+               store_past_the_end.trap == TRAP_OUT_OF_BOUNDS && load_past_the_end.trap == TRAP_OUT_OF_BOUNDS;
+    });
+}
+
+// The address space of the process in KiB, or 0 where /proc does not tell
+static size_t address_space_kib() {
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);) {
+        if (line.starts_with("VmSize:")) {
+            return std::stoull(line.substr(7));
+        }
+    }
+    return 0;
+}
+
+// How much address space 64 instances of a module take, in KiB
+static size_t address_space_of_instances(const TestModule& module) {
+    auto compiled_module = CompiledModule::compile(module.assemble());
+    size_t before = address_space_kib();
+    std::vector<std::unique_ptr<Interpreter>> instances;
+    for (int i = 0; i < 64; ++i) {
+        instances.push_back(std::make_unique<Interpreter>(compiled_module));
+    }
+    return address_space_kib() - before;
+}
+
+const HostTestSuite test_14 = {
+    "Test14 (linear memory)",
+    {
+        {"memory.grow: Growing up to the maximum succeeds", [] {
+            auto compiled_module = CompiledModule::compile(growing_module({0x01, 1, 2}).assemble());
+            return with_and_without_jit([&](const TieringPolicy& tiering_policy) {
+                Interpreter instance(compiled_module, tiering_policy);
+                return invokes_and_stores(instance, {0}, 0, 1) &&
+                       invokes_and_stores(instance, {2}, 4, 2);
+            });
+        }},
+        {"memory.grow: Growing beyond the maximum returns -1 and keeps the memory", [] {
+            auto compiled_module = CompiledModule::compile(growing_module({0x01, 1, 2}).assemble());
+            return with_and_without_jit([&](const TieringPolicy& tiering_policy) {
+                Interpreter instance(compiled_module, tiering_policy);
+                return invokes_and_stores(instance, {0, 3, 0}, 0, -1) &&
+                       invokes_and_stores(instance, {1}, 0, -1) &&
+                       invokes_and_stores(instance, {2}, 4, 2) &&
+                       expect_i32(65536, 7)(instance);
+            });
+        }},
+        {"memory.grow: Without a maximum, growing beyond 4 GiB returns -1", [] {
+            auto compiled_module = CompiledModule::compile(growing_module({0x00, 1}).assemble());
+            return with_and_without_jit([&](const TieringPolicy& tiering_policy) {
+                Interpreter instance(compiled_module, tiering_policy);
+                return invokes_and_stores(instance, {1}, 0, -1) &&
+                       invokes_and_stores(instance, {2}, 4, 1);
+            });
+        }},
+        {"memory.grow: A reset instance grows up to the maximum again", [] {
+            auto compiled_module = CompiledModule::compile(growing_module({0x01, 1, 2}).assemble());
+            Interpreter instance(compiled_module);
+            if (!invokes_and_stores(instance, {0, 0}, 0, -1)) {
+                return false;
+            }
+            instance.reset();
+            return invokes_and_stores(instance, {0}, 0, 1) &&
+                   invokes_and_stores(instance, {2}, 4, 2);
+        }},
+        {"LinearMemory: grow stops at the maximum", [] {
+            LinearMemory memory(1, 3);
+            int32_t first = memory.grow(2);
+            int32_t beyond = memory.grow(1);
+            std::cout << "Grown from: " << first << ", beyond the maximum: " << beyond << ", pages: " << memory.pages() << std::endl;
+            return first == 1 && beyond == -1 && memory.pages() == 3 && memory.grow(0) == 3;
+        }},
+        {"LinearMemory: Accesses past the end trap with a small maximum and with none", [] {
+            return traps_past_the_end({0x01, 1, 1}) && traps_past_the_end({0x00, 1});
+        }},
+        {"LinearMemory: Instances without a memory or with a small one reserve little address space", [] {
+            // Less for all 64 instances than one memory with guard pages reserves
+            constexpr size_t LIMIT_KIB = size_t{8} << 20;
+            size_t without_memory = address_space_of_instances({{{{}, {}, {0x00, 0x0b}}}});
+            size_t with_small_memory = address_space_of_instances(bounds_module({0x01, 1, 16}));
+            std::cout << "Without a memory: " << without_memory << " KiB, with a small one: " << with_small_memory << " KiB" << std::endl;
+            return without_memory < LIMIT_KIB && with_small_memory < LIMIT_KIB;
+        }},
+    },
+};
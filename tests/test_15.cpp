@@ -0,0 +1,116 @@
+#include "TestSuite.h"
+#include "../src/InstancePool.h"
+#include "../src/Snapshot.h"
+#include <iostream>
+
+static constexpr uint32_t SNAPSHOT_INITIALIZE = 0;
+static constexpr uint32_t SNAPSHOT_OVERWRITE = 1;
+static constexpr uint32_t SNAPSHOT_REPORT = 2;
+
+// A module whose initialization grows the memory to three pages, stores 42 at address 0 and 43
+// in the third page and sets its global to 5. The other functions overwrite all of that with 7
+// and 9, and store the global at address 4 and the memory size at address 8.
+static std::shared_ptr<const CompiledModule> snapshot_test_module() {
+    TestModule module = {{
+        {{}, {}, {0x00,
+                  0x41, 0x02, 0x40, 0x00, 0x1a,                         // memory.grow 2
+                  0x41, 0x00, 0x41, 0x2a, 0x36, 0x02, 0x00,             // Stores 42 at 0
+                  0x41, 0x88, 0x80, 0x08, 0x41, 0x2b, 0x36, 0x02, 0x00, // Stores 43 at 131080
+                  0x41, 0x05, 0x24, 0x00,                               // Sets the global to 5
+                  0x0b}},
+        {{}, {}, {0x00,
+                  0x41, 0x00, 0x41, 0x07, 0x36, 0x02, 0x00,
+                  0x41, 0x88, 0x80, 0x08, 0x41, 0x07, 0x36, 0x02, 0x00,
+                  0x41, 0x09, 0x24, 0x00,
+                  0x0b}},
+        {{}, {}, {0x00,
+                  0x41, 0x04, 0x23, 0x00, 0x36, 0x02, 0x00, // Stores the global at 4
+                  0x41, 0x08, 0x3f, 0x00, 0x36, 0x02, 0x00, // Stores memory.size at 8
+                  0x0b}},
+    }, {0x00, 1}, {0}};
+    return CompiledModule::compile(module.assemble());
+}
+
+static std::shared_ptr<const Snapshot> initialized_snapshot() {
+    Interpreter initialized(snapshot_test_module());
+    if (!initialized.invoke(SNAPSHOT_INITIALIZE).ok()) {
+        return nullptr;
+    }
+    return initialized.snapshot();
+}
+
+// Whether an instance holds what the initialization left, in memory and in its global
+static bool holds_initialized_state(Interpreter& instance) {
+    return instance.invoke(SNAPSHOT_REPORT).ok() &&
+           expect_i32(0, 42)(instance) &&
+           expect_i32(131080, 43)(instance) &&
+           expect_i32(4, 5)(instance) &&
+           expect_i32(8, 3)(instance);
+}
+
+const HostTestSuite test_15 = {
+    "Test15 (snapshots)",
+    {
+        {"Snapshot: An instance starts with the memory and globals of the snapshot", [] {
+            auto snapshot = initialized_snapshot();
+            if (!snapshot) {
+                return false;
+            }
+            Interpreter instance(snapshot);
+            return holds_initialized_state(instance);
+        }},
+        {"Snapshot: Writes after the snapshot are not part of it", [] {
+            Interpreter initialized(snapshot_test_module());
+            if (!initialized.invoke(SNAPSHOT_INITIALIZE).ok()) {
+                return false;
+            }
+            auto snapshot = initialized.snapshot();
+            if (!initialized.invoke(SNAPSHOT_OVERWRITE).ok() || !expect_i32(0, 7)(initialized)) {
+                return false;
+            }
+            Interpreter instance(snapshot);
+            return holds_initialized_state(instance);
+        }},
+        {"Snapshot: Instances of one snapshot do not see each other's writes", [] {
+            auto snapshot = initialized_snapshot();
+            if (!snapshot) {
+                return false;
+            }
+            Interpreter writer(snapshot);
+            Interpreter reader(snapshot);
+            if (!writer.invoke(SNAPSHOT_OVERWRITE).ok() || !expect_i32(131080, 7)(writer)) {
+                return false;
+            }
+            Interpreter later(snapshot);
+            return holds_initialized_state(reader) && holds_initialized_state(later);
+        }},
+        {"Snapshot: A reset instance returns to the snapshot", [] {
+            auto snapshot = initialized_snapshot();
+            if (!snapshot) {
+                return false;
+            }
+            Interpreter instance(snapshot);
+            if (!instance.invoke(SNAPSHOT_OVERWRITE).ok() || !instance.invoke(SNAPSHOT_REPORT).ok() ||
+                !expect_i32(4, 9)(instance)) {
+                return false;
+            }
+            instance.reset();
+            return holds_initialized_state(instance);
+        }},
+        {"Snapshot: The instances of a pool reset to the snapshot", [] {
+            auto snapshot = initialized_snapshot();
+            if (!snapshot) {
+                return false;
+            }
+            InstancePool pool(snapshot, 1);
+            {
+                InstancePool::Lease lease = pool.try_acquire();
+                if (!lease || !lease->invoke(SNAPSHOT_OVERWRITE).ok()) {
+                    return false;
+                }
+            }
+            InstancePool::Lease lease = pool.try_acquire();
+            return lease && holds_initialized_state(*lease);
+        }},
+    },
+};
@@ -0,0 +1,143 @@
+#include "TestSuite.h"
+#include "../src/Leb128.h"
+#include "../src/StreamingParser.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+static const std::vector<std::string> streaming_test_files = {"01_test.wasm", "06_test_fc.wasm", "07_test_bulk_memory.wasm"};
+
+static std::vector<uint8_t> read_test_binary(const std::string& file_name) {
+    std::ifstream file(std::string(WASM_TEST_DIR) + "/" + file_name, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Streams a binary in chunks that end at the given offsets and at its end
+static std::shared_ptr<const CompiledModule> stream_split_at(const std::vector<uint8_t>& binary, const std::vector<size_t>& splits) {
+    StreamingParser streaming_parser;
+    size_t begin = 0;
+    for (size_t split : splits) {
+        streaming_parser.feed(std::span(binary).subspan(begin, split - begin));
+        begin = split;
+    }
+    streaming_parser.feed(std::span(binary).subspan(begin));
+    return streaming_parser.finish();
+}
+
+// Streams a binary in chunks of one size, the last one shorter
+static std::shared_ptr<const CompiledModule> stream_in_chunks(const std::vector<uint8_t>& binary, size_t chunk_size) {
+    std::vector<size_t> splits;
+    for (size_t split = chunk_size; split < binary.size(); split += chunk_size) {
+        splits.push_back(split);
+    }
+    return stream_split_at(binary, splits);
+}
+
+// Offsets in every section: after its id, inside its size if that takes more than one byte,
+// after its size and in the middle of its contents. In the Code section also inside and after
+// the size of every body, and in the middle of it.
+static std::vector<size_t> section_splits(const std::vector<uint8_t>& binary, size_t& splits_inside_leb128) {
+    std::vector<size_t> splits;
+    auto add_number_splits = [&](size_t begin, size_t end) {
+        for (size_t split = begin + 1; split < end; ++split) {
+            splits.push_back(split);
+            ++splits_inside_leb128;
+        }
+        splits.push_back(end);
+    };
+    size_t offset = 8;
+    while (offset < binary.size()) {
+        uint8_t id = binary[offset++];
+        splits.push_back(offset);
+        size_t size_begin = offset;
+        uint32_t size = decode_leb128<uint32_t>(binary, offset, "Unexpected end of the section size");
+        add_number_splits(size_begin, offset);
+        size_t contents_end = offset + size;
+        splits.push_back(offset + size / 2);
+
+        if (id == 10) {
+            uint32_t body_count = decode_leb128<uint32_t>(binary, offset, "Unexpected end of the body count");
+            for (uint32_t i = 0; i < body_count; ++i) {
+                size_t body_size_begin = offset;
+                uint32_t body_size = decode_leb128<uint32_t>(binary, offset, "Unexpected end of the body size");
+                add_number_splits(body_size_begin, offset);
+                splits.push_back(offset + body_size / 2);
+                offset += body_size;
+            }
+        }
+        offset = contents_end;
+    }
+    std::ranges::sort(splits);
+    auto duplicates = std::ranges::unique(splits);
+    splits.erase(duplicates.begin(), duplicates.end());
+    if (!splits.empty() && splits.back() >= binary.size()) {
+        splits.pop_back();
+    }
+    return splits;
+}
+
+const HostTestSuite test_16 = {
+    "Test16 (streaming)",
+    {
+        {"StreamingParser: Chunks of odd sizes give the same module", [] {
+            for (const std::string& file_name : streaming_test_files) {
+                std::vector<uint8_t> binary = read_test_binary(file_name);
+                auto expected = CompiledModule::compile(binary);
+                for (size_t chunk_size : {1, 3, 7, 61, 509}) {
+                    if (!same_compiled_module(expected->module(), stream_in_chunks(binary, chunk_size)->module())) {
+                        std::cout << file_name << " differs when streamed in chunks of " << chunk_size << std::endl;
+                        return false;
+                    }
+                }
+            }
+            Interpreter instance(stream_in_chunks(read_test_binary("01_test.wasm"), 3));
+            return instance.invoke(0).ok() && expect_i32(0, 42)(instance);
+        }},
+        {"StreamingParser: Splits inside numbers and sections give the same module", [] {
+            size_t splits_inside_leb128 = 0;
+            for (const std::string& file_name : streaming_test_files) {
+                std::vector<uint8_t> binary = read_test_binary(file_name);
+                auto expected = CompiledModule::compile(binary);
+                for (size_t split : section_splits(binary, splits_inside_leb128)) {
+                    if (!same_compiled_module(expected->module(), stream_split_at(binary, {split})->module())) {
+                        std::cout << file_name << " differs when split at " << split << std::endl;
+                        return false;
+                    }
+                }
+            }
+            std::cout << "Splits inside LEB128 numbers: " << splits_inside_leb128 << std::endl;
+            return splits_inside_leb128 > 0;
+        }},
+        {"StreamingParser: A binary cut short fails to finish", [] {
+            std::vector<uint8_t> binary = read_test_binary("01_test.wasm");
+            size_t splits_inside_leb128 = 0;
+            for (size_t length : section_splits(binary, splits_inside_leb128)) {
+                try {
+                    StreamingParser streaming_parser;
+                    streaming_parser.feed(std::span(binary).first(length));
+                    streaming_parser.finish();
+                    std::cout << "The first " << length << " bytes compiled" << std::endl;
+                    return false;
+                } catch (const std::runtime_error&) {
+                }
+            }
+            return true;
+        }},
+        {"StreamingParser: An invalid function fails while it streams", [] {
+            // A body whose i64 result does not match the i32 of its type, and one more after it
+            std::vector<uint8_t> binary = TestModule{{
+                {{}, {0x7f}, {0x00, 0x42, 0x01, 0x0b}},
+                {{}, {}, {0x00, 0x0b}},
+            }}.assemble();
+            StreamingParser streaming_parser;
+            try {
+                streaming_parser.feed(std::span(binary).first(binary.size() - 2));
+            } catch (const std::runtime_error& e) {
+                std::cout << "Error: " << e.what() << std::endl;
+                return std::string(e.what()).ends_with("type mismatch");
+            }
+            return false;
+        }},
+    },
+};
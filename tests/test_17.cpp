@@ -0,0 +1,102 @@
+#include "TestSuite.h"
+#include "../src/ModuleCache.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+static constexpr uint32_t PARALLEL_TEST_THREADS[] = {2, 3, 8};
+
+// Many small functions of different sizes, each of which adds to its parameter and calls the one before it
+static TestModule many_functions_module() {
+    TestModule module;
+    for (uint8_t i = 0; i < 120; ++i) {
+        std::vector<uint8_t> body = {0x00, 0x20, 0x00};
+        for (uint8_t j = 0; j <= i % 5; ++j) {
+            uint8_t constant = (i + j) % 64;
+            body.push_back(0x41);
+            body.push_back(constant);
+            body.push_back(0x6a);
+        }
+        if (i > 0) {
+            body.push_back(0x10);
+            body.push_back(i - 1);
+        }
+        body.push_back(0x0b);
+        module.functions.push_back({{0x7f}, {0x7f}, body});
+    }
+    return module;
+}
+
+// The binaries that must compile the same on any number of threads
+static std::vector<std::vector<uint8_t>> parallel_test_binaries() {
+    std::vector<std::vector<uint8_t>> binaries = {many_functions_module().assemble()};
+    for (const char* file_name : {"01_test.wasm", "02_test_prio1.wasm", "06_test_fc.wasm", "07_test_bulk_memory.wasm"}) {
+        std::ifstream file(std::string(WASM_TEST_DIR) + "/" + file_name, std::ios::binary);
+        binaries.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    return binaries;
+}
+
+static std::string compile_error(const std::vector<uint8_t>& binary, uint32_t threads) {
+    try {
+        CompiledModule::compile(binary, CompileOptions{.threads = threads});
+    } catch (const std::runtime_error& e) {
+        std::cout << "Error on " << threads << " threads: " << e.what() << std::endl;
+        return e.what();
+    }
+    return "";
+}
+
+// The artifact a module cache stores for a binary compiled on a number of threads
+static std::vector<uint8_t> compiled_artifact(const std::vector<uint8_t>& binary, uint32_t threads) {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "wasm_interpreter_test_parallel";
+    std::filesystem::remove_all(directory);
+    CompiledModule::compile(binary, CompileOptions{.threads = threads, .cache_directory = directory.string()});
+    std::ifstream file(ModuleCache(directory.string()).artifact_path(binary), std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+const HostTestSuite test_17 = {
+    "Test17 (parallel compilation)",
+    {
+        {"Parallel compilation: The module is the same as compiled on one thread", [] {
+            for (const std::vector<uint8_t>& binary : parallel_test_binaries()) {
+                auto serial = CompiledModule::compile(binary, CompileOptions{.threads = 1});
+                for (uint32_t threads : PARALLEL_TEST_THREADS) {
+                    auto parallel = CompiledModule::compile(binary, CompileOptions{.threads = threads});
+                    if (!same_compiled_module(serial->module(), parallel->module())) {
+                        std::cout << "The module differs on " << threads << " threads" << std::endl;
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }},
+        {"Parallel compilation: The cache artifact is the same as compiled on one thread", [] {
+            for (const std::vector<uint8_t>& binary : parallel_test_binaries()) {
+                std::vector<uint8_t> serial_artifact = compiled_artifact(binary, 1);
+                for (uint32_t threads : PARALLEL_TEST_THREADS) {
+                    if (serial_artifact.empty() || compiled_artifact(binary, threads) != serial_artifact) {
+                        std::cout << "The artifact differs on " << threads << " threads" << std::endl;
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }},
+        {"Parallel compilation: The first invalid function is reported on any number of threads", [] {
+            TestModule module = many_functions_module();
+            module.functions[30].body = {0x00, 0x42, 0x01, 0x0b}; // An i64 where the type returns an i32
+            module.functions[100].body = {0x00, 0x6a, 0x0b};      // i32.add of nothing
+            std::vector<uint8_t> binary = module.assemble();
+            std::string serial_error = compile_error(binary, 1);
+            for (uint32_t threads : PARALLEL_TEST_THREADS) {
+                if (compile_error(binary, threads) != serial_error) {
+                    return false;
+                }
+            }
+            return serial_error.starts_with("Validation failed in function 30");
+        }},
+    },
+};
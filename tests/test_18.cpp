@@ -0,0 +1,67 @@
+#include "TestSuite.h"
+#include <algorithm>
+#include <iostream>
+
+// Stores local 0 at address 0 and local 1 at address 4, after the instructions of a test
+static std::vector<uint8_t> storing_locals(std::vector<uint8_t> instructions) {
+    std::vector<uint8_t> body = {0x01, 0x03, 0x7f}; // Three i32 locals
+    for (uint8_t byte : instructions) {
+        body.push_back(byte);
+    }
+    for (uint8_t local : {0, 1}) {
+        const uint8_t store[] = {0x41, static_cast<uint8_t>(local * 4), 0x20, local, 0x36, 0x02, 0x00};
+        for (uint8_t byte : store) {
+            body.push_back(byte);
+        }
+    }
+    body.push_back(0x0b);
+    return body;
+}
+
+// Whether a function of storing_locals leaves the expected values in locals 0 and 1,
+// interpreted and compiled
+static bool stores_locals(const std::vector<uint8_t>& instructions, int32_t local_0, int32_t local_1) {
+    auto compiled_module = CompiledModule::compile(TestModule{{{{}, {}, storing_locals(instructions)}}, {0x00, 1}}.assemble());
+    for (TieringPolicy tiering_policy : {TieringPolicy{}, TieringPolicy{0, 0}}) {
+        Interpreter instance(compiled_module, tiering_policy);
+        if (!instance.invoke(0).ok() || !expect_i32(0, local_0)(instance) || !expect_i32(4, local_1)(instance)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t count_copies(const CompiledModule& compiled_module) {
+    auto register_code = compiled_module.module().functions.register_code[0];
+    return std::ranges::count(register_code, REG_COPY, &RegisterInstruction::opcode);
+}
+
+const HostTestSuite test_18 = {
+    "Test18 (translator)",
+    {
+        {"Translator: local.set after local.tee writes both locals", [] {
+            // i32.const 7; local.set 2; local.get 2; local.tee 1; local.set 0
+            return stores_locals({0x41, 0x07, 0x21, 0x02, 0x20, 0x02, 0x22, 0x01, 0x21, 0x00}, 7, 7);
+        }},
+        {"Translator: local.set after local.tee of a computed value writes both locals", [] {
+            // i32.const 3; i32.const 4; i32.add; local.tee 1; local.set 0
+            return stores_locals({0x41, 0x03, 0x41, 0x04, 0x6a, 0x22, 0x01, 0x21, 0x00}, 7, 7);
+        }},
+        {"Translator: local.get reads what the local.set right before it wrote", [] {
+            // i32.const 5; local.set 0; local.get 0; local.get 0; i32.add; local.set 1
+            return stores_locals({0x41, 0x05, 0x21, 0x00, 0x20, 0x00, 0x20, 0x00, 0x6a, 0x21, 0x01}, 5, 10);
+        }},
+        {"Translator: local.set of a local still on the stack keeps its old value there", [] {
+            // i32.const 2; local.set 0; local.get 0; i32.const 9; local.set 0; local.set 1
+            return stores_locals({0x41, 0x02, 0x21, 0x00, 0x20, 0x00, 0x41, 0x09, 0x21, 0x00, 0x21, 0x01}, 9, 2);
+        }},
+        {"Translator: A computed value is written to its local without a copy", [] {
+            // i32.const 3; i32.const 4; i32.add; local.set 0
+            std::vector<uint8_t> instructions = {0x41, 0x03, 0x41, 0x04, 0x6a, 0x21, 0x00};
+            auto compiled_module = CompiledModule::compile(TestModule{{{{}, {}, storing_locals(instructions)}}, {0x00, 1}}.assemble());
+            size_t copies = count_copies(*compiled_module);
+            std::cout << "Copies: " << copies << std::endl;
+            return copies == 0 && stores_locals(instructions, 7, 0);
+        }},
+    },
+};
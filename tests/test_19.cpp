@@ -0,0 +1,119 @@
+#include "TestSuite.h"
+#include "../src/Fuser.h"
+#include <iostream>
+
+// Slots 0 and 1 are locals, from slot 2 on operands
+static constexpr uint32_t FUSER_TEST_TEMPORARY = 2;
+
+// Fuses register code with the given branch table in a frame of two locals
+static FunctionCode fused(std::vector<RegisterInstruction> code, std::vector<uint32_t> branch_table = {}) {
+    Module module;
+    FunctionCode function_code;
+    function_code.register_code = std::move(code);
+    function_code.register_branch_table = std::move(branch_table);
+    for (uint32_t pc = 0; pc < function_code.register_code.size(); ++pc) {
+        function_code.register_origins.push_back(pc);
+    }
+    Fuser(module).fuse_function(FrameLayout{0, 2, 0, 4}, function_code);
+    return function_code;
+}
+
+static bool has_opcodes(const FunctionCode& function_code, const std::vector<uint16_t>& opcodes) {
+    std::cout << "Opcodes:";
+    for (const RegisterInstruction& instr : function_code.register_code) {
+        std::cout << " 0x" << std::hex << instr.opcode << std::dec;
+    }
+    std::cout << std::endl;
+    if (function_code.register_code.size() != opcodes.size()) {
+        return false;
+    }
+    for (size_t pc = 0; pc < opcodes.size(); ++pc) {
+        if (function_code.register_code[pc].opcode != opcodes[pc]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// i32.const 10 into an operand slot, then a binary operation of it and local 0, the constant first or second
+static std::vector<RegisterInstruction> constant_operand(uint16_t opcode, bool constant_first) {
+    uint32_t t = FUSER_TEST_TEMPORARY;
+    return {
+        {0x41, t, 0, 0, {.i64 = 10}},
+        {opcode, t, constant_first ? t : 0, constant_first ? 0 : t, {.i64 = 0}},
+        {0x0F, 0, t, 1, {.i64 = 0}},
+    };
+}
+
+const HostTestSuite test_19 = {
+    "Test19 (fuser)",
+    {
+        {"Fuser: A jump target between a constant and its consumer keeps them apart", [] {
+            uint32_t t = FUSER_TEST_TEMPORARY;
+            // The jump lands on the i32.add, which must not disappear into the constant
+            FunctionCode into_pair = fused({
+                {0x41, t, 0, 0, {.i64 = 5}},
+                {0x6A, t, 0, t, {.i64 = 0}},
+                {REG_JUMP_IF, 0, t, 0, {.i64 = 1}},
+                {0x0F, 0, 0, 0, {.i64 = 0}},
+            });
+            // The same code jumping past the pair fuses it, and the jump follows its target
+            FunctionCode past_pair = fused({
+                {0x41, t, 0, 0, {.i64 = 5}},
+                {0x6A, t, 0, t, {.i64 = 0}},
+                {REG_JUMP_IF, 0, t, 0, {.i64 = 3}},
+                {0x0F, 0, 0, 0, {.i64 = 0}},
+            });
+            return has_opcodes(into_pair, {0x41, 0x6A, REG_JUMP_IF, 0x0F}) && into_pair.register_code[2].imm.i64 == 1 &&
+                   has_opcodes(past_pair, {REG_WITH_IMMEDIATE + 0x6A, REG_JUMP_IF, 0x0F}) && past_pair.register_code[1].imm.i64 == 2 &&
+                   past_pair.register_origins == std::vector<uint32_t>{1, 2, 3};
+        }},
+        {"Fuser: A branch table target between a comparison and its jump keeps them apart", [] {
+            uint32_t t = FUSER_TEST_TEMPORARY;
+            std::vector<RegisterInstruction> code = {
+                {0x48, t, 0, 1, {.i64 = 0}},
+                {REG_JUMP_UNLESS, 0, t, 0, {.i64 = 2}},
+                {0x0F, 0, 0, 0, {.i64 = 0}},
+            };
+            FunctionCode targeted = fused(code, {1});
+            FunctionCode untargeted = fused(code, {2});
+            // Not jumping on i32.lt_s is jumping on i32.ge_s
+            return has_opcodes(targeted, {0x48, REG_JUMP_UNLESS, 0x0F}) && targeted.register_branch_table == std::vector<uint32_t>{1} &&
+                   has_opcodes(untargeted, {REG_COMPARE_JUMP + 0x4E, 0x0F}) && untargeted.register_code[0].r == 1 &&
+                   untargeted.register_branch_table == std::vector<uint32_t>{1};
+        }},
+        {"Fuser: A constant first operand is only fused into commutative operations", [] {
+            FunctionCode sub_of_constant = fused(constant_operand(0x6B, true));
+            FunctionCode lt_s_of_constant = fused(constant_operand(0x48, true));
+            FunctionCode shl_of_constant = fused(constant_operand(0x74, true));
+            FunctionCode add_of_constant = fused(constant_operand(0x6A, true));
+            FunctionCode sub_constant = fused(constant_operand(0x6B, false));
+            const RegisterInstruction& add = add_of_constant.register_code[0];
+            const RegisterInstruction& sub = sub_constant.register_code[0];
+            return has_opcodes(sub_of_constant, {0x41, 0x6B, 0x0F}) &&
+                   has_opcodes(lt_s_of_constant, {0x41, 0x48, 0x0F}) &&
+                   has_opcodes(shl_of_constant, {0x41, 0x74, 0x0F}) &&
+                   has_opcodes(add_of_constant, {REG_WITH_IMMEDIATE + 0x6A, 0x0F}) && add.a == 0 && add.imm.i64 == 10 &&
+                   has_opcodes(sub_constant, {REG_WITH_IMMEDIATE + 0x6B, 0x0F}) && sub.a == 0 && sub.imm.i64 == 10;
+        }},
+        {"Fuser: Constant operands on either side compute the same, interpreted and compiled", [] {
+            auto compiled_module = CompiledModule::compile(TestModule{{{{}, {}, {
+                0x01, 0x01, 0x7f,
+                0x41, 0x03, 0x21, 0x00,                                     // local 0 = 3
+                0x41, 0x00, 0x41, 0x0a, 0x20, 0x00, 0x6b, 0x36, 0x02, 0x00, // 10 - local 0 at 0
+                0x41, 0x04, 0x20, 0x00, 0x41, 0x0a, 0x6b, 0x36, 0x02, 0x00, // local 0 - 10 at 4
+                0x41, 0x08, 0x41, 0x0a, 0x20, 0x00, 0x48, 0x36, 0x02, 0x00, // 10 < local 0 at 8
+                0x41, 0x0c, 0x20, 0x00, 0x41, 0x0a, 0x48, 0x36, 0x02, 0x00, // local 0 < 10 at 12
+                0x0b,
+            }}}, {0x00, 1}}.assemble());
+            for (TieringPolicy tiering_policy : {TieringPolicy{}, TieringPolicy{0, 0}}) {
+                Interpreter instance(compiled_module, tiering_policy);
+                if (!instance.invoke(0).ok() || !expect_i32(0, 7)(instance) || !expect_i32(4, -7)(instance) ||
+                    !expect_i32(8, 0)(instance) || !expect_i32(12, 1)(instance)) {
+                    return false;
+                }
+            }
+            return true;
+        }},
+    },
+};
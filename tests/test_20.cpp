@@ -0,0 +1,61 @@
+#include "TestSuite.h"
+#include <algorithm>
+#include <iostream>
+
+// Function 0 calls function 1 with the argument the constant encodes and drops its result
+static TestModule calling_module(std::vector<uint8_t> argument, std::vector<uint8_t> callee_body, std::vector<uint8_t> memory = {}) {
+    std::vector<uint8_t> caller_body = {0x00, 0x41};
+    for (uint8_t byte : argument) {
+        caller_body.push_back(byte);
+    }
+    for (uint8_t byte : {0x10, 0x01, 0x1a, 0x0b}) {
+        caller_body.push_back(byte);
+    }
+    return {{{{}, {}, caller_body}, {{0x7f}, {0x7f}, std::move(callee_body)}}, std::move(memory)};
+}
+
+// Whether invoking function 0 traps in function 1 at the wasm instruction `pc`, interpreted and compiled
+static bool traps_in_callee(const TestModule& module, TrapCode trap, size_t pc) {
+    auto compiled_module = CompiledModule::compile(module.assemble());
+    for (TieringPolicy tiering_policy : {TieringPolicy{}, TieringPolicy{0, 0}}) {
+        Interpreter instance(compiled_module, tiering_policy);
+        InvokeResult result = instance.invoke(0);
+        std::cout << "Trap: " << trap_message(result.trap) << " in function " << result.function_index
+                  << " at instruction " << result.pc << std::endl;
+        if (result.trap != trap || result.function_index != 1 || result.pc != pc) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool has_opcode(const TestModule& module, uint16_t opcode) {
+    auto compiled_module = CompiledModule::compile(module.assemble());
+    return std::ranges::count(compiled_module->module().functions.register_code[1], opcode, &RegisterInstruction::opcode) == 1;
+}
+
+const HostTestSuite test_20 = {
+    "Test20 (traps)",
+    {
+        {"Traps: A division by a constant zero reports the division", [] {
+            // local.get 0; i32.const 0; i32.div_s
+            TestModule module = calling_module({0x07}, {0x00, 0x20, 0x00, 0x41, 0x00, 0x6d, 0x0b});
+            return has_opcode(module, REG_WITH_IMMEDIATE + 0x6D) && traps_in_callee(module, TRAP_DIVIDE_BY_ZERO, 2);
+        }},
+        {"Traps: An unreachable after a compare and jump reports the unreachable", [] {
+            // block; local.get 0; i32.const 5; i32.lt_s; br_if 0; unreachable; end; i32.const 1
+            TestModule module = calling_module({0x09}, {0x00, 0x02, 0x40, 0x20, 0x00, 0x41, 0x05, 0x48, 0x0d, 0x00, 0x00, 0x0b, 0x41, 0x01, 0x0b});
+            return has_opcode(module, REG_COMPARE_IMMEDIATE_JUMP + 0x48) && traps_in_callee(module, TRAP_UNREACHABLE, 5);
+        }},
+        {"Traps: A load past the end reports the load, with a small maximum and with none", [] {
+            // i32.const 0; drop; local.get 0; i32.load
+            std::vector<uint8_t> load = {0x00, 0x41, 0x00, 0x1a, 0x20, 0x00, 0x28, 0x02, 0x00, 0x0b};
+            for (const std::vector<uint8_t>& memory : {std::vector<uint8_t>{0x01, 1, 1}, std::vector<uint8_t>{0x00, 1}}) {
+                if (!traps_in_callee(calling_module({0x80, 0x80, 0x04}, load, memory), TRAP_OUT_OF_BOUNDS, 3)) {
+                    return false;
+                }
+            }
+            return true;
+        }},
+    },
+};
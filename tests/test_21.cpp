@@ -0,0 +1,90 @@
+#include "TestSuite.h"
+#include "../src/Decoder.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Decodes a function body without the end that closes it, as the parser hands it over
+static FunctionCode decoded(const std::vector<uint8_t>& code) {
+    FunctionCode function_code;
+    Decoder(code).decode_into(function_code);
+    return function_code;
+}
+
+static std::string decode_error(const std::vector<uint8_t>& code) {
+    try {
+        decoded(code);
+    } catch (const std::runtime_error& e) {
+        std::cout << "Error: " << e.what() << std::endl;
+        return e.what();
+    }
+    return "";
+}
+
+const HostTestSuite test_21 = {
+    "Test21 (decoder)",
+    {
+        {"Decoder: Immediates are decoded into the instruction", [] {
+            FunctionCode function_code = decoded({
+                0x41, 0xff, 0x7e,                   // i32.const -129
+                0x42, 0x80, 0x80, 0x80, 0x80, 0x10, // i64.const 1 << 32
+                0x43, 0x00, 0x00, 0xc0, 0x3f,       // f32.const 1.5
+                0x28, 0x02, 0xac, 0x02,             // i32.load align=2 offset=300
+                0x20, 0x81, 0x01,                   // local.get 129
+                0xfc, 0x0a, 0x00, 0x00,             // memory.copy
+            });
+            const std::vector<Instruction>& instructions = function_code.instructions;
+            return instructions.size() == 7 &&
+                   instructions[0].opcode == 0x41 && instructions[0].value.i32 == -129 &&
+                   instructions[1].opcode == 0x42 && instructions[1].value.i64 == int64_t{1} << 32 &&
+                   instructions[2].opcode == 0x43 && instructions[2].value.f32 == 1.5f &&
+                   instructions[3].opcode == 0x28 && instructions[3].a == 300 && instructions[3].b == 2 &&
+                   instructions[4].opcode == 0x20 && instructions[4].a == 129 &&
+                   instructions[5].opcode == PREFIX_FC + 0x0A &&
+                   instructions[6].opcode == 0x0B;
+        }},
+        {"Decoder: Blocks are linked to their else and end", [] {
+            // block; i32.const 1; if; nop; else; nop; end; loop; end; end
+            FunctionCode function_code = decoded({0x02, 0x40, 0x41, 0x01, 0x04, 0x40, 0x01, 0x05, 0x01, 0x0b, 0x03, 0x40, 0x0b, 0x0b});
+            const std::vector<Instruction>& instructions = function_code.instructions;
+            return instructions[0].a == 9 &&                            // block to its end
+                   instructions[2].a == 6 && instructions[2].b == 5 && // if to its end, and past its else
+                   instructions[4].a == 6 &&                            // else to the shared end
+                   instructions[7].a == 8 &&                            // loop to its end
+                   instructions[0].value.i64 == -64;                    // the empty block type
+        }},
+        {"Decoder: The labels of br_table go into the branch table, the default last", [] {
+            // block; block; i32.const 0; br_table 1 0 1; end; end; i32.const 0; br_table 0
+            FunctionCode function_code = decoded({0x02, 0x40, 0x02, 0x40, 0x41, 0x00, 0x0e, 0x02, 0x01, 0x00, 0x01, 0x0b, 0x0b,
+                                                  0x41, 0x00, 0x0e, 0x00, 0x00});
+            const std::vector<Instruction>& instructions = function_code.instructions;
+            return function_code.branch_table == std::vector<uint32_t>{1, 0, 1, 0} &&
+                   instructions[3].a == 0 && instructions[3].b == 2 &&
+                   instructions[7].a == 3 && instructions[7].b == 0;
+        }},
+        {"Decoder: Malformed bodies are rejected", [] {
+            return decode_error({0x02, 0x40}) == "Function body ends inside an unterminated block" &&
+                   decode_error({0x01, 0x0b}) == "'end' without a matching block" &&
+                   decode_error({0x01, 0x05}) == "'else' without a matching 'if'" &&
+                   decode_error({0x41, 0x80}) == "Unexpected end of function body" &&
+                   decode_error({0x06}) == "Unknown opcode while decoding: 0x06" &&
+                   decode_error({0xfc, 0x20}) == "Unknown opcode while decoding: 0xFC 0x20";
+        }},
+        {"Decoder: Loads and stores add their offset to the address", [] {
+            // Stores 7 at 4 + 300, and loads it back from 304 into address 0
+            auto compiled_module = CompiledModule::compile(TestModule{{{{}, {}, {
+                0x00,
+                0x41, 0x04, 0x41, 0x07, 0x36, 0x02, 0xac, 0x02,
+                0x41, 0x00, 0x41, 0xb0, 0x02, 0x28, 0x02, 0x00, 0x36, 0x02, 0x00,
+                0x0b,
+            }}}, {0x00, 1}}.assemble());
+            for (TieringPolicy tiering_policy : {TieringPolicy{}, TieringPolicy{0, 0}}) {
+                Interpreter instance(compiled_module, tiering_policy);
+                if (!instance.invoke(0).ok() || !expect_i32(0, 7)(instance)) {
+                    return false;
+                }
+            }
+            return true;
+        }},
+    },
+};
@@ -0,0 +1,64 @@
+#include "TestSuite.h"
+
+// Whether invoking a function leaves `expected_value` at address 0, interpreted and compiled
+static bool stores_at_0(const TestModule& module, uint32_t function_index, int32_t expected_value) {
+    auto compiled_module = CompiledModule::compile(module.assemble());
+    for (TieringPolicy tiering_policy : {TieringPolicy{}, TieringPolicy{0, 0}}) {
+        Interpreter instance(compiled_module, tiering_policy);
+        if (!instance.invoke(function_index).ok() || !expect_i32(0, expected_value)(instance)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function 0 takes an i32 and returns what `body` computes of it. Function 1 + i stores at
+// address 0 what function 0 returns for arguments[i].
+static TestModule calling_module(std::vector<uint8_t> body, std::initializer_list<uint8_t> arguments) {
+    TestModule module{{{{0x7f}, {0x7f}, std::move(body)}}, {0x00, 1}};
+    for (uint8_t argument : arguments) {
+        module.functions.push_back({{}, {}, {0x00, 0x41, 0x00, 0x41, argument, 0x10, 0x00, 0x36, 0x02, 0x00, 0x0b}});
+    }
+    return module;
+}
+
+const HostTestSuite test_22 = {
+    "Test22 (control flow)",
+    {
+        {"Branches: A branch carries its label's values and drops the operands below them", [] {
+            // i32.const 0; block (result i32); i32.const 1; i32.const 2; i32.const 42; br 0; end; i32.store
+            TestModule module{{{{}, {}, {0x00, 0x41, 0x00, 0x02, 0x7f, 0x41, 0x01, 0x41, 0x02, 0x41, 0x2a, 0x0c, 0x00, 0x0b,
+                                         0x36, 0x02, 0x00, 0x0b}}}, {0x00, 1}};
+            return stores_at_0(module, 0, 42);
+        }},
+        {"Branches: A branch to the function's label returns", [] {
+            // block; local.get 0; local.get 0; br_if 1; drop; end; i32.const 5: the argument unless it is 0
+            TestModule module = calling_module({0x00, 0x02, 0x40, 0x20, 0x00, 0x20, 0x00, 0x0d, 0x01, 0x1a, 0x0b, 0x41, 0x05, 0x0b}, {0, 9});
+            return stores_at_0(module, 1, 5) && stores_at_0(module, 2, 9);
+        }},
+        {"Branches: A loop runs until its br_if falls through, an if picks the branch of its condition", [] {
+            // local 1 counts up to the argument in a loop, then is 100 if it equals 3 and 200 if not
+            TestModule module = calling_module({
+                0x01, 0x01, 0x7f,
+                0x03, 0x40,                                                             // loop
+                0x20, 0x01, 0x41, 0x01, 0x6a, 0x21, 0x01,                               //   local 1 += 1
+                0x20, 0x01, 0x20, 0x00, 0x48, 0x0d, 0x00,                               //   br_if 0 (local 1 < local 0)
+                0x0b,                                                                   // end
+                0x20, 0x01, 0x41, 0x03, 0x46, 0x04, 0x7f, 0x41, 0xe4, 0x00, 0x05, 0x41, // if (result i32) 100 else 200
+                0xc8, 0x01, 0x0b,
+                0x0b,
+            }, {3, 7});
+            return stores_at_0(module, 1, 100) && stores_at_0(module, 2, 200);
+        }},
+        {"Branches: br_table picks its label by the index, the default past the end", [] {
+            // block; block; block; local.get 0; br_table 0 1 2; end; i32.const 10; return; end;
+            // i32.const 20; return; end; i32.const 30
+            TestModule module = calling_module({
+                0x00, 0x02, 0x40, 0x02, 0x40, 0x02, 0x40, 0x20, 0x00, 0x0e, 0x02, 0x00, 0x01, 0x02, 0x0b,
+                0x41, 0x0a, 0x0f, 0x0b, 0x41, 0x14, 0x0f, 0x0b, 0x41, 0x1e, 0x0b,
+            }, {0, 1, 2, 50});
+            return stores_at_0(module, 1, 10) && stores_at_0(module, 2, 20) && stores_at_0(module, 3, 30) &&
+                   stores_at_0(module, 4, 30);
+        }},
+    },
+};
@@ -0,0 +1,69 @@
+#include "TestSuite.h"
+#include "../src/Opcodes.h"
+#include <cmath>
+#include <limits>
+
+const HostTestSuite test_23 = {
+    "Test23 (numeric kernels)",
+    {
+        {"Kernels: Integer kernels follow WebAssembly, not C++", [] {
+            return i32_shl_kernel::apply(1, 33) == 2 &&
+                   i32_shr_u_kernel::apply(-8, 1) == 0x7ffffffc &&
+                   i32_shr_s_kernel::apply(-8, 1) == -4 &&
+                   i32_rotl_kernel::apply(static_cast<int32_t>(0x80000001), 1) == 3 &&
+                   i64_rotr_kernel::apply(1, 65) == INT64_MIN &&
+                   i32_clz_kernel::apply(0) == 32 && i64_ctz_kernel::apply(0) == 64 &&
+                   i32_rem_s_kernel::apply(INT32_MIN, -1) == 0 &&
+                   i32_div_u_kernel::apply(-2, 2) == 0x7fffffff &&
+                   i32_lt_u_kernel::apply(1, -1) == 1;
+        }},
+        {"Kernels: Float kernels propagate NaN and order -0 below +0", [] {
+            return std::isnan(f32_min_kernel::apply(std::nanf(""), 1.0f)) &&
+                   std::isnan(f64_max_kernel::apply(1.0, std::nan(""))) &&
+                   std::signbit(f32_min_kernel::apply(0.0f, -0.0f)) &&
+                   !std::signbit(f64_max_kernel::apply(-0.0, 0.0)) &&
+                   f32_nearest_kernel::apply(2.5f) == 2.0f;
+        }},
+        {"Kernels: Only the trapping instructions check their operands", [] {
+            return NumericTrap<i32_div_s_kernel>::check(INT32_MIN, -1) == TRAP_INTEGER_OVERFLOW &&
+                   NumericTrap<i64_div_u_kernel>::check(1, 0) == TRAP_DIVIDE_BY_ZERO &&
+                   NumericTrap<i32_rem_s_kernel>::check(INT32_MIN, -1) == TRAP_NONE &&
+                   NumericTrap<i32_trunc_f32_s_kernel>::check(std::nanf("")) == TRAP_INVALID_CONVERSION &&
+                   NumericTrap<i32_trunc_f64_u_kernel>::check(4294967296.0) == TRAP_INTEGER_OVERFLOW &&
+                   NumericTrap<i32_trunc_f64_u_kernel>::check(-0.9) == TRAP_NONE &&
+                   NumericTrap<i32_add_kernel>::check(INT32_MAX, 1) == TRAP_NONE;
+        }},
+        {"Kernels: Saturating truncations clamp to the integer range", [] {
+            float infinity = std::numeric_limits<float>::infinity();
+            return i32_trunc_sat_f32_s_kernel::apply(std::nanf("")) == 0 &&
+                   i32_trunc_sat_f32_u_kernel::apply(-5.0f) == 0 &&
+                   i32_trunc_sat_f32_u_kernel::apply(infinity) == -1 &&
+                   i64_trunc_sat_f64_s_kernel::apply(-1e300) == INT64_MIN &&
+                   i32_trunc_sat_f64_s_kernel::apply(-3.9) == -3;
+        }},
+        {"Kernels: numeric_arity counts the operands of the table's instructions only", [] {
+            static_assert(numeric_arity(0x6A) == 2 && numeric_arity(0x45) == 1 && numeric_arity(PREFIX_FC + 0x07) == 1);
+            return numeric_arity(0x41) == 0 && numeric_arity(0x28) == 0 && numeric_arity(PREFIX_FC + 0x0A) == 0 &&
+                   numeric_arity(0xC4) == 1 && numeric_arity(0xA6) == 2;
+        }},
+        {"Kernels: The interpreter and compiled code compute the same as the kernels", [] {
+            auto compiled_module = CompiledModule::compile(TestModule{{{{}, {}, {
+                0x00,
+                0x41, 0x00, 0x41, 0x80, 0x80, 0x80, 0x80, 0x78, 0x41, 0x7f, 0x6f, 0x36, 0x02, 0x00, // i32.rem_s INT32_MIN -1 at 0
+                0x41, 0x04, 0x41, 0x01, 0x41, 0x21, 0x74, 0x36, 0x02, 0x00,                         // i32.shl 1 33 at 4
+                0x41, 0x08, 0x43, 0x00, 0x00, 0xa0, 0xc0, 0xfc, 0x01, 0x36, 0x02, 0x00,             // i32.trunc_sat_f32_u -5 at 8
+                0x41, 0x0c, 0x43, 0x00, 0x00, 0x00, 0x00, 0x43, 0x00, 0x00, 0x00, 0x80, 0x96,       // f32.min 0 -0 at 12
+                0xbc, 0x36, 0x02, 0x00,
+                0x0b,
+            }}}, {0x00, 1}}.assemble());
+            for (TieringPolicy tiering_policy : {TieringPolicy{}, TieringPolicy{0, 0}}) {
+                Interpreter instance(compiled_module, tiering_policy);
+                if (!instance.invoke(0).ok() || !expect_i32(0, 0)(instance) || !expect_i32(4, 2)(instance) ||
+                    !expect_i32(8, 0)(instance) || !expect_i32(12, INT32_MIN)(instance)) {
+                    return false;
+                }
+            }
+            return true;
+        }},
+    },
+};
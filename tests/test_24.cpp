@@ -0,0 +1,92 @@
+#include "TestSuite.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Every allocation of the test binary is counted, for the tests of code that must not allocate
+static std::atomic<size_t> allocation_count{0};
+
+void* operator new(size_t size) {
+    ++allocation_count;
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+// Function 1 sums the numbers up to its parameter recursively, function 2 returns its parameter
+// plus a local it never set. Function 0 stores the sum up to 1000 at address 0, function 3 what
+// function 2 returns for 5 at address 4, and function 4 recurses deeper than the call stack.
+static TestModule recursive_module() {
+    return {{
+        {{}, {}, {0x00, 0x41, 0x00, 0x41, 0xe8, 0x07, 0x10, 0x01, 0x36, 0x02, 0x00, 0x0b}},
+        {{0x7f}, {0x7f}, {0x00, 0x20, 0x00, 0x45, 0x04, 0x7f, 0x41, 0x00, 0x05, 0x20, 0x00, 0x41, 0x01, 0x6b, 0x10, 0x01,
+                          0x20, 0x00, 0x6a, 0x0b, 0x0b}},
+        {{0x7f}, {0x7f}, {0x01, 0x01, 0x7f, 0x20, 0x01, 0x20, 0x00, 0x6a, 0x22, 0x01, 0x0b}},
+        {{}, {}, {0x00, 0x41, 0x04, 0x41, 0x05, 0x10, 0x02, 0x36, 0x02, 0x00, 0x0b}},
+        {{}, {}, {0x00, 0x41, 0xa0, 0x8d, 0x06, 0x10, 0x01, 0x1a, 0x0b}},
+    }, {0x00, 1}};
+}
+
+const HostTestSuite test_24 = {
+    "Test24 (calls)",
+    {
+        {"Calls: Recursive calls return their results in place of their arguments", [] {
+            auto compiled_module = CompiledModule::compile(recursive_module().assemble());
+            for (TieringPolicy tiering_policy : {TieringPolicy{}, TieringPolicy{0, 0}}) {
+                Interpreter instance(compiled_module, tiering_policy);
+                if (!instance.invoke(0).ok() || !expect_i32(0, 500500)(instance)) {
+                    return false;
+                }
+            }
+            return true;
+        }},
+        {"Calls: Locals start at zero in stack slots that earlier calls used", [] {
+            auto compiled_module = CompiledModule::compile(recursive_module().assemble());
+            for (TieringPolicy tiering_policy : {TieringPolicy{}, TieringPolicy{0, 0}}) {
+                Interpreter instance(compiled_module, tiering_policy);
+                if (!instance.invoke(0).ok() || !instance.invoke(3).ok() || !instance.invoke(3).ok() ||
+                    !expect_i32(4, 5)(instance)) {
+                    return false;
+                }
+            }
+            return true;
+        }},
+        {"Calls: Recursing past the call stack traps, and the instance keeps working", [] {
+            auto compiled_module = CompiledModule::compile(recursive_module().assemble());
+            for (TieringPolicy tiering_policy : {TieringPolicy{}, TieringPolicy{0, 0}}) {
+                Interpreter instance(compiled_module, tiering_policy);
+                InvokeResult result = instance.invoke(4);
+                std::cout << "Trap: " << trap_message(result.trap) << " in function " << result.function_index << std::endl;
+                if (result.trap != TRAP_CALL_STACK_EXHAUSTED || result.function_index != 1 ||
+                    !instance.invoke(0).ok() || !expect_i32(0, 500500)(instance)) {
+                    return false;
+                }
+            }
+            return true;
+        }},
+        {"Calls: Interpreted calls allocate nothing", [] {
+            auto compiled_module = CompiledModule::compile(recursive_module().assemble());
+            // The instance allocates its stacks up front. Its functions never get hot enough to be compiled.
+            size_t before = allocation_count;
+            Interpreter instance(compiled_module, TieringPolicy{UINT32_MAX, UINT32_MAX});
+            if (allocation_count == before || !instance.invoke(0).ok()) {
+                return false;
+            }
+            before = allocation_count;
+            bool ok = instance.invoke(0).ok() && instance.invoke(3).ok();
+            size_t allocations = allocation_count - before;
+            std::cout << "Allocations in 1002 calls: " << allocations << std::endl;
+            return ok && allocations == 0;
+        }},
+    },
+};
@@ -0,0 +1,103 @@
+#include "TestSuite.h"
+#include "../src/JitCompiler.h"
+#include <iostream>
+
+// Function 0 stores the results of many kinds of instruction in the first 60 bytes of memory,
+// function 1 computes a - 2 * b for it, function 2 runs memory.fill, and function 3
+// stores at address 60 what a loop counted up to
+static TestModule mixed_module() {
+    return {{
+        {{}, {}, {
+            0x00,
+            0x41, 0x00, 0x42, 0x79, 0x42, 0x03, 0x7e, 0x42, 0x02, 0x7f, 0x37, 0x03, 0x00,       // -7 * 3 / 2 as i64 at 0
+            0x41, 0x08, 0x42, 0x7f, 0x42, 0x04, 0x88, 0x37, 0x03, 0x00,                         // -1 >>> 4 as i64 at 8
+            0x41, 0x10, 0x44, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x9f,             // sqrt(2) * 3 at 16
+            0x44, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x40, 0xa2, 0x39, 0x03, 0x00,
+            0x41, 0x18, 0x41, 0x08, 0x2c, 0x00, 0x00, 0x36, 0x02, 0x00,                         // i32.load8_s of 8 at 24
+            0x41, 0x1c, 0x41, 0x08, 0x2f, 0x01, 0x00, 0x36, 0x02, 0x00,                         // i32.load16_u of 8 at 28
+            0x41, 0x20, 0x41, 0x0b, 0x41, 0x16, 0x41, 0x00, 0x1b, 0x36, 0x02, 0x00,             // select 11 22 0 at 32
+            0x23, 0x00, 0x41, 0x05, 0x6a, 0x24, 0x00, 0x41, 0x24, 0x23, 0x00, 0x36, 0x02, 0x00, // global 0 + 5 at 36
+            0x41, 0x28, 0x41, 0x01, 0x40, 0x00, 0x36, 0x02, 0x00,                               // memory.grow 1 at 40
+            0x41, 0x2c, 0x3f, 0x00, 0x36, 0x02, 0x00,                                           // memory.size at 44
+            0x41, 0x30, 0x41, 0x7f, 0xb3, 0xbc, 0x36, 0x02, 0x00,                               // f32.convert_i32_u -1 at 48
+            0x41, 0x34, 0x41, 0x0a, 0x41, 0x03, 0x10, 0x01, 0x36, 0x02, 0x00,                   // function 1 of 10 and 3 at 52
+            0x41, 0x38, 0x44, 0x9a, 0x99, 0x99, 0x99, 0x99, 0x99, 0x0d, 0xc0, 0xaa,             // i32.trunc_f64_s -3.7 at 56
+            0x36, 0x02, 0x00,
+            0x0b,
+        }},
+        {{0x7f, 0x7f}, {0x7f}, {0x00, 0x20, 0x00, 0x20, 0x01, 0x41, 0x02, 0x6c, 0x6b, 0x0b}},
+        {{}, {}, {0x00, 0x41, 0x00, 0x41, 0x07, 0x41, 0x04, 0xfc, 0x0b, 0x00, 0x0b}},
+        {{}, {}, {
+            0x01, 0x01, 0x7f,
+            0x03, 0x40, 0x20, 0x00, 0x41, 0x01, 0x6a, 0x22, 0x00, 0x41, 0x0a, 0x48, 0x0d, 0x00, 0x0b,
+            0x41, 0x3c, 0x20, 0x00, 0x36, 0x02, 0x00,
+            0x0b,
+        }},
+    }, {0x00, 1}, {37}};
+}
+
+// The first 64 bytes of memory after running a function of the mixed module
+static std::vector<int32_t> memory_after(uint32_t function_index, const TieringPolicy& tiering_policy) {
+    auto compiled_module = CompiledModule::compile(mixed_module().assemble());
+    Interpreter instance(compiled_module, tiering_policy);
+    std::vector<int32_t> words;
+    if (!instance.invoke(function_index).ok()) {
+        return words;
+    }
+    for (uint32_t address = 0; address < 64; address += 4) {
+        words.push_back(instance.get_memory_i32(address));
+    }
+    return words;
+}
+
+// Whether a function leaves the same memory compiled as interpreted
+static bool same_as_interpreted(uint32_t function_index) {
+    std::vector<int32_t> interpreted = memory_after(function_index, TieringPolicy{});
+    std::vector<int32_t> compiled = memory_after(function_index, TieringPolicy{0, 0});
+    for (size_t i = 0; i < compiled.size(); ++i) {
+        if (compiled[i] != interpreted[i]) {
+            std::cout << "Differs at " << i * 4 << ": " << compiled[i] << " instead of " << interpreted[i] << std::endl;
+        }
+    }
+    return !interpreted.empty() && compiled == interpreted;
+}
+
+const HostTestSuite test_25 = {
+    "Test25 (JIT)",
+    {
+        {"JIT: Compiled code computes the same as the interpreter", [] {
+            std::vector<int32_t> words = memory_after(0, TieringPolicy{});
+            return same_as_interpreted(0) && words.size() == 16 && words[0] == -10 && words[1] == -1 &&
+                   words[2] == -1 && words[3] == 0x0fffffff && words[6] == -1 && words[7] == 0xffff &&
+                   words[8] == 22 && words[9] == 42 && words[10] == 1 && words[11] == 2 &&
+                   words[12] == 0x4f800000 && words[13] == 4 && words[14] == -3;
+        }},
+        {"JIT: A loop computes the same compiled as interpreted", [] {
+            return same_as_interpreted(3) && memory_after(3, TieringPolicy{0, 0})[15] == 10;
+        }},
+        {"JIT: A function the JIT does not compile stays in the interpreter", [] {
+            // Neither tier implements memory.fill, so the interpreter reports it with either policy
+            auto compiled_module = CompiledModule::compile(mixed_module().assemble());
+            for (TieringPolicy tiering_policy : {TieringPolicy{}, TieringPolicy{0, 0}}) {
+                Interpreter instance(compiled_module, tiering_policy);
+                InvokeResult result = instance.invoke(2);
+                std::cout << "Trap: " << trap_message(result.trap) << " at instruction " << result.pc << std::endl;
+                if (result.trap != TRAP_UNSUPPORTED_INSTRUCTION || result.function_index != 2 || result.pc != 3) {
+                    return false;
+                }
+            }
+            return true;
+        }},
+#if WASM_JIT
+        {"JIT: Only functions without unsupported instructions are compiled, with an entry per loop", [] {
+            auto compiled_module = CompiledModule::compile(mixed_module().assemble());
+            JitCompiler jit_compiler(compiled_module->module(), Interpreter::jit_helpers());
+            CompiledFunction mixed = jit_compiler.compile(0);
+            CompiledFunction bulk_memory = jit_compiler.compile(2);
+            CompiledFunction loop = jit_compiler.compile(3);
+            return mixed.entry != nullptr && mixed.loop_entries.empty() && bulk_memory.entry == nullptr &&
+                   loop.entry != nullptr && loop.loop_entries.size() == 1;
+        }},
+#endif
+    },
+};
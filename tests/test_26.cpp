@@ -0,0 +1,86 @@
+#include "TestSuite.h"
+#include "../src/TieringManager.h"
+#include <iostream>
+#include <thread>
+
+static constexpr uint32_t TIERING_TEST_THREADS = 8;
+
+// Function 0 counts its calls in a global and stores the count at address 4, function 1 counts
+// to 1000 in a loop and stores the count at address 0, function 2 runs memory.fill
+static TestModule counting_module() {
+    return {{
+        {{}, {}, {0x00, 0x23, 0x00, 0x41, 0x01, 0x6a, 0x24, 0x00, 0x41, 0x04, 0x23, 0x00, 0x36, 0x02, 0x00, 0x0b}},
+        {{}, {}, {
+            0x01, 0x01, 0x7f,
+            0x03, 0x40, 0x20, 0x00, 0x41, 0x01, 0x6a, 0x22, 0x00, 0x41, 0xe8, 0x07, 0x48, 0x0d, 0x00, 0x0b,
+            0x41, 0x00, 0x20, 0x00, 0x36, 0x02, 0x00,
+            0x0b,
+        }},
+        {{}, {}, {0x00, 0x41, 0x00, 0x41, 0x07, 0x41, 0x04, 0xfc, 0x0b, 0x00, 0x0b}},
+    }, {0x00, 1}, {0}};
+}
+
+const HostTestSuite test_26 = {
+    "Test26 (tiering)",
+    {
+        {"Tiering: Calls past the call threshold compute the same", [] {
+            auto compiled_module = CompiledModule::compile(counting_module().assemble());
+            Interpreter instance(compiled_module, TieringPolicy{3, UINT32_MAX});
+            for (int i = 0; i < 10; ++i) {
+                if (!instance.invoke(0).ok()) {
+                    return false;
+                }
+            }
+            return expect_i32(4, 10)(instance);
+        }},
+        {"Tiering: A loop that gets hot continues in compiled code with the same result", [] {
+            auto compiled_module = CompiledModule::compile(counting_module().assemble());
+            Interpreter instance(compiled_module, TieringPolicy{UINT32_MAX, 5});
+            return instance.invoke(1).ok() && expect_i32(0, 1000)(instance);
+        }},
+#if WASM_JIT
+        {"Tiering: A function is promoted once its calls or back edges reach the threshold", [] {
+            auto compiled_module = CompiledModule::compile(counting_module().assemble());
+            TieringManager tiering(*compiled_module, TieringPolicy{3, 4});
+            bool interpreted_calls = tiering.on_call(0) == nullptr && tiering.on_call(0) == nullptr;
+            JitCode at_calls = tiering.on_call(0);
+            bool interpreted_loop = tiering.on_back_edge(1, 1) == nullptr && tiering.on_back_edge(1, 1) == nullptr &&
+                                    tiering.on_back_edge(1, 1) == nullptr;
+            JitCode at_back_edges = tiering.on_back_edge(1, 1);
+            const CompiledFunction& loop = compiled_module->compiled_function(1);
+            return interpreted_calls && at_calls != nullptr && at_calls == compiled_module->compiled_function(0).entry &&
+                   interpreted_loop && at_back_edges != nullptr && at_back_edges == loop.loop_entry(1) &&
+                   tiering.on_call(1) == loop.entry;
+        }},
+        {"Tiering: A function the JIT does not support stays interpreted", [] {
+            auto compiled_module = CompiledModule::compile(counting_module().assemble());
+            TieringManager tiering(*compiled_module, TieringPolicy{0, 0});
+            return tiering.on_call(2) == nullptr && tiering.on_call(2) == nullptr;
+        }},
+        {"Tiering: Instances promoting a function at once get the same code, compiled once", [] {
+            auto compiled_module = CompiledModule::compile(counting_module().assemble());
+            std::vector<JitCode> entries(TIERING_TEST_THREADS);
+            std::vector<uint8_t> results(TIERING_TEST_THREADS); // Not vector<bool>, whose elements share bytes
+            std::vector<std::thread> threads;
+            for (uint32_t i = 0; i < TIERING_TEST_THREADS; ++i) {
+                threads.emplace_back([&compiled_module, &entries, &results, i] {
+                    TieringManager tiering(*compiled_module, TieringPolicy{0, 0});
+                    entries[i] = tiering.on_call(1);
+                    Interpreter instance(compiled_module, TieringPolicy{0, 0});
+                    results[i] = instance.invoke(1).ok() && instance.get_memory_i32(0) == 1000;
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            for (uint32_t i = 0; i < TIERING_TEST_THREADS; ++i) {
+                if (!results[i] || entries[i] == nullptr || entries[i] != entries[0]) {
+                    std::cout << "Thread " << i << " differs" << std::endl;
+                    return false;
+                }
+            }
+            return entries[0] == compiled_module->compiled_function(1).entry;
+        }},
+#endif
+    },
+};
@@ -0,0 +1,60 @@
+#include "TestSuite.h"
+
+// Functions whose interpreted frames are left and resumed in the middle: by calls, by a trap,
+// and by a loop that continues in compiled code
+static TestModule resuming_module() {
+    return {{
+        // 0: stores function 1 of 3 at address 0
+        {{}, {}, {0x00, 0x41, 0x00, 0x41, 0x03, 0x10, 0x01, 0x36, 0x02, 0x00, 0x0b}},
+        // 1: function 2 of p + 1, plus 10 * p kept in a local across the call
+        {{0x7f}, {0x7f}, {0x01, 0x01, 0x7f, 0x20, 0x00, 0x41, 0x0a, 0x6c, 0x21, 0x01, 0x20, 0x00, 0x41, 0x01, 0x6a, 0x10, 0x02,
+                          0x20, 0x01, 0x6a, 0x0b}},
+        // 2: function 3 of p, minus 100 * p kept in a local across the call
+        {{0x7f}, {0x7f}, {0x01, 0x01, 0x7f, 0x20, 0x00, 0x41, 0xe4, 0x00, 0x6c, 0x21, 0x01, 0x20, 0x00, 0x10, 0x03, 0x20, 0x01,
+                          0x6b, 0x0b}},
+        // 3: p + 7
+        {{0x7f}, {0x7f}, {0x00, 0x20, 0x00, 0x41, 0x07, 0x6a, 0x0b}},
+        // 4: sums function 3 of 0 to 4 in a loop, and stores the sum at address 4
+        {{}, {}, {0x01, 0x02, 0x7f, 0x03, 0x40, 0x20, 0x01, 0x20, 0x00, 0x10, 0x03, 0x6a, 0x21, 0x01, 0x20, 0x00, 0x41, 0x01,
+                  0x6a, 0x22, 0x00, 0x41, 0x05, 0x48, 0x0d, 0x00, 0x0b, 0x41, 0x04, 0x20, 0x01, 0x36, 0x02, 0x00, 0x0b}},
+        // 5: sets global 0 to 1 and traps if it was 0, else stores 1 at address 8
+        {{}, {}, {0x00, 0x23, 0x00, 0x41, 0x01, 0x24, 0x00, 0x45, 0x04, 0x40, 0x00, 0x0b, 0x41, 0x08, 0x41, 0x01, 0x36, 0x02,
+                  0x00, 0x0b}},
+        // 6: calls function 5, then stores 2 at address 12
+        {{}, {}, {0x00, 0x10, 0x05, 0x41, 0x0c, 0x41, 0x02, 0x36, 0x02, 0x00, 0x0b}},
+        // 7: stores function 8 at address 16, then 3 at address 20
+        {{}, {}, {0x00, 0x41, 0x10, 0x10, 0x08, 0x36, 0x02, 0x00, 0x41, 0x14, 0x41, 0x03, 0x36, 0x02, 0x00, 0x0b}},
+        // 8: counts to 1000 in a loop
+        {{}, {0x7f}, {0x01, 0x01, 0x7f, 0x03, 0x40, 0x20, 0x00, 0x41, 0x01, 0x6a, 0x22, 0x00, 0x41, 0xe8, 0x07, 0x48, 0x0d,
+                      0x00, 0x0b, 0x20, 0x00, 0x0b}},
+    }, {0x00, 1}, {0}};
+}
+
+const HostTestSuite test_27 = {
+    "Test27 (interpreter state)",
+    {
+        {"Interpreter: Each caller resumes after its call with its own locals", [] {
+            auto compiled_module = CompiledModule::compile(resuming_module().assemble());
+            Interpreter instance(compiled_module);
+            // (3 + 1 + 7) - 100 * 4 + 10 * 3
+            return instance.invoke(0).ok() && expect_i32(0, -359)(instance);
+        }},
+        {"Interpreter: A loop resumes after each call it makes", [] {
+            auto compiled_module = CompiledModule::compile(resuming_module().assemble());
+            Interpreter instance(compiled_module);
+            return instance.invoke(4).ok() && expect_i32(4, 45)(instance);
+        }},
+        {"Interpreter: A call after a trap starts at the beginning of its function", [] {
+            auto compiled_module = CompiledModule::compile(resuming_module().assemble());
+            Interpreter instance(compiled_module);
+            InvokeResult trapped = instance.invoke(6);
+            return trapped.trap == TRAP_UNREACHABLE && trapped.function_index == 5 && expect_i32(12, 0)(instance) &&
+                   instance.invoke(6).ok() && expect_i32(8, 1)(instance) && expect_i32(12, 2)(instance);
+        }},
+        {"Interpreter: The caller of a loop that continues in compiled code resumes after the call", [] {
+            auto compiled_module = CompiledModule::compile(resuming_module().assemble());
+            Interpreter instance(compiled_module, TieringPolicy{UINT32_MAX, 5});
+            return instance.invoke(7).ok() && expect_i32(16, 1000)(instance) && expect_i32(20, 3)(instance);
+        }},
+    },
+};
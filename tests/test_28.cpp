@@ -0,0 +1,77 @@
+#include "TestSuite.h"
+#include <iostream>
+#include <thread>
+
+static constexpr uint32_t SHARED_TEST_THREADS = 8;
+static constexpr int SHARED_TEST_CALLS = 200;
+
+// Function 0 counts its calls in a global and stores the count at address 0, function 1 counts
+// to 1000 in a loop and stores the count at address 4
+static TestModule instance_state_module() {
+    return {{
+        {{}, {}, {0x00, 0x23, 0x00, 0x41, 0x01, 0x6a, 0x24, 0x00, 0x41, 0x00, 0x23, 0x00, 0x36, 0x02, 0x00, 0x0b}},
+        {{}, {}, {
+            0x01, 0x01, 0x7f,
+            0x03, 0x40, 0x20, 0x00, 0x41, 0x01, 0x6a, 0x22, 0x00, 0x41, 0xe8, 0x07, 0x48, 0x0d, 0x00, 0x0b,
+            0x41, 0x04, 0x20, 0x00, 0x36, 0x02, 0x00,
+            0x0b,
+        }},
+    }, {0x00, 1}, {0}};
+}
+
+// Whether an instance counts exactly its own calls, and its loop to 1000
+static bool counts_own_calls(const std::shared_ptr<const CompiledModule>& compiled_module, const TieringPolicy& tiering_policy) {
+    Interpreter instance(compiled_module, tiering_policy);
+    for (int i = 0; i < SHARED_TEST_CALLS; ++i) {
+        if (!instance.invoke(0).ok() || !instance.invoke(1).ok()) {
+            return false;
+        }
+    }
+    return instance.get_memory_i32(0) == SHARED_TEST_CALLS && instance.get_memory_i32(4) == 1000;
+}
+
+const HostTestSuite test_28 = {
+    "Test28 (shared module)",
+    {
+        {"Shared module: Instances of one module have their own memory and globals", [] {
+            auto compiled_module = CompiledModule::compile(instance_state_module().assemble());
+            Interpreter first(compiled_module);
+            Interpreter second(compiled_module);
+            return first.invoke(0).ok() && first.invoke(0).ok() && second.invoke(0).ok() &&
+                   expect_i32(0, 2)(first) && expect_i32(0, 1)(second);
+        }},
+        {"Shared module: Instances on many threads run one module at once", [] {
+            auto compiled_module = CompiledModule::compile(instance_state_module().assemble());
+            std::vector<uint8_t> results(SHARED_TEST_THREADS); // Not vector<bool>, whose elements share bytes
+            std::vector<std::thread> threads;
+            for (uint32_t i = 0; i < SHARED_TEST_THREADS; ++i) {
+                // Half of them compile the functions on their first call, and race to do so
+                TieringPolicy tiering_policy = i % 2 == 0 ? TieringPolicy{} : TieringPolicy{0, 0};
+                threads.emplace_back([&compiled_module, &results, i, tiering_policy] {
+                    results[i] = counts_own_calls(compiled_module, tiering_policy);
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            for (uint32_t i = 0; i < SHARED_TEST_THREADS; ++i) {
+                if (!results[i]) {
+                    std::cout << "Thread " << i << " failed" << std::endl;
+                    return false;
+                }
+            }
+            // Nothing the instances did changed the module
+            auto fresh = CompiledModule::compile(instance_state_module().assemble());
+            return same_compiled_module(fresh->module(), compiled_module->module()) &&
+                   compiled_module->initial_globals()[0].i32 == 0;
+        }},
+        {"Shared module: An instance keeps its module alive", [] {
+            auto compiled_module = CompiledModule::compile(instance_state_module().assemble());
+            std::weak_ptr<const CompiledModule> module_reference = compiled_module;
+            auto instance = std::make_unique<Interpreter>(std::move(compiled_module));
+            bool alive_with_instance = !module_reference.expired() && instance->invoke(1).ok() && expect_i32(4, 1000)(*instance);
+            instance.reset();
+            return alive_with_instance && module_reference.expired();
+        }},
+    },
+};
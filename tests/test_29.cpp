@@ -0,0 +1,66 @@
+#include "TestSuite.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Function 0 stores 0 at address 0, and the memory of 2 pages holds the given segments
+static TestModule data_module(std::vector<std::pair<uint32_t, std::vector<uint8_t>>> data) {
+    TestModule module{{{{}, {}, {0x00, 0x41, 0x00, 0x41, 0x00, 0x36, 0x02, 0x00, 0x0b}}}, {0x00, 2}};
+    module.data = std::move(data);
+    return module;
+}
+
+// Two overlapping segments, the second of which overwrites the first from address 2 on, with
+// `size` bytes in all
+static TestModule overlapping_data_module(size_t size) {
+    std::vector<uint8_t> first(size / 2, 0x11);
+    std::vector<uint8_t> second(size - size / 2, 0x22);
+    return data_module({{0, first}, {2, second}});
+}
+
+// Whether new, written and reset instances hold the segments of an overlapping_data_module
+static bool holds_overlapping_data(const std::shared_ptr<const CompiledModule>& compiled_module, size_t size) {
+    Interpreter instance(compiled_module);
+    Interpreter written(compiled_module);
+    // The last four bytes of the second segment
+    uint32_t end_address = static_cast<uint32_t>(2 + (size - size / 2) - 4);
+    bool before_write = expect_i32(0, 0x22221111)(written) && expect_i32(end_address, 0x22222222)(written);
+    bool after_write = written.invoke(0).ok() && expect_i32(0, 0)(written) && expect_i32(0, 0x22221111)(instance);
+    written.reset();
+    return before_write && after_write && expect_i32(0, 0x22221111)(written);
+}
+
+const HostTestSuite test_29 = {
+    "Test29 (data segments)",
+    {
+        {"Data segments: Small segments are copied into every instance in order", [] {
+            auto compiled_module = CompiledModule::compile(overlapping_data_module(64).assemble());
+            return compiled_module->memory_image() == nullptr && holds_overlapping_data(compiled_module, 64);
+        }},
+        {"Data segments: Large segments are mapped from an image, which instances write copy-on-write", [] {
+            size_t size = CompiledModule::DATA_IMAGE_THRESHOLD + 4000;
+            auto compiled_module = CompiledModule::compile(overlapping_data_module(size).assemble());
+            return compiled_module->memory_image() != nullptr && compiled_module->memory_image()->pages() == 2 &&
+                   holds_overlapping_data(compiled_module, size);
+        }},
+        {"Data segments: A segment past the end of the memory is rejected", [] {
+            std::vector<uint8_t> bytes = {1, 2, 3, 4};
+            try {
+                CompiledModule::compile(data_module({{2 * PAGE_SIZE - 3, bytes}}).assemble());
+            } catch (const std::runtime_error& e) {
+                std::cout << "Error: " << e.what() << std::endl;
+                return std::string(e.what()) == "Data segment does not fit into memory";
+            }
+            return false;
+        }},
+        {"Data segments: The segments are views of the binary", [] {
+            auto compiled_module = CompiledModule::compile(data_module({{8, {1, 2, 3, 4}}, {12, {5, 6}}}).assemble());
+            std::span<const DataSegment> segments = compiled_module->module().data_segments;
+            // In the binary, the bytes of the second segment follow those of the first and its five byte header
+            return segments.size() == 2 && segments[0].is_active && segments[0].memory_offset == 8 &&
+                   std::ranges::equal(segments[1].bytes, std::vector<uint8_t>{5, 6}) &&
+                   segments[1].bytes.data() == segments[0].bytes.data() + 4 + 5;
+        }},
+    },
+};
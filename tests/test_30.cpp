@@ -0,0 +1,74 @@
+#include "TestSuite.h"
+#include "../src/ModuleBinary.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Writes bytes to a file of its own in the temporary directory and returns its path
+static std::string write_binary_file(const std::string& name, const std::vector<uint8_t>& bytes) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / ("wasm_interpreter_test_" + name);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return path.string();
+}
+
+static bool points_into(std::span<const uint8_t> view, std::span<const uint8_t> bytes) {
+    return view.data() >= bytes.data() && view.data() + view.size() <= bytes.data() + bytes.size();
+}
+
+static std::string map_error(const std::string& path) {
+    try {
+        CompiledModule::compile(ModuleBinary::map_file(path));
+    } catch (const std::runtime_error& e) {
+        std::cout << "Error: " << e.what() << std::endl;
+        return e.what();
+    }
+    return "";
+}
+
+const HostTestSuite test_30 = {
+    "Test30 (module binary)",
+    {
+        {"ModuleBinary: A module compiled from a mapped file points into the mapping", [] {
+            // Stores the 4 bytes of its data segment at address 8 to address 0
+            TestModule module{{{{}, {}, {0x00, 0x41, 0x00, 0x41, 0x08, 0x28, 0x02, 0x00, 0x36, 0x02, 0x00, 0x0b}}}, {0x00, 1}};
+            module.data = {{8, {0x78, 0x56, 0x34, 0x12}}};
+            std::vector<uint8_t> bytes = module.assemble();
+            std::string path = write_binary_file("mapped.wasm", bytes);
+
+            ModuleBinary binary = ModuleBinary::map_file(path);
+            std::span<const uint8_t> mapping = binary.bytes();
+            bool same_bytes = std::ranges::equal(mapping, bytes);
+            auto compiled_module = CompiledModule::compile(std::move(binary));
+            const Module& parsed = compiled_module->module();
+            bool points_into_mapping = points_into(parsed.functions.code[0], mapping) &&
+                                       points_into(parsed.data_segments[0].bytes, mapping);
+
+            // The mapping outlives the file
+            std::filesystem::remove(path);
+            Interpreter instance(compiled_module);
+            return same_bytes && points_into_mapping && instance.invoke(0).ok() && expect_i32(0, 0x12345678)(instance);
+        }},
+        {"ModuleBinary: Moving a binary leaves its bytes where they are", [] {
+            std::vector<uint8_t> bytes = TestModule{{{{}, {}, {0x00, 0x0b}}}}.assemble();
+            ModuleBinary owned(bytes);
+            ModuleBinary mapped = ModuleBinary::map_file(write_binary_file("moved.wasm", bytes));
+            const uint8_t* owned_bytes = owned.bytes().data();
+            const uint8_t* mapped_bytes = mapped.bytes().data();
+            ModuleBinary moved_owned(std::move(owned));
+            ModuleBinary moved_mapped(std::move(mapped));
+            return moved_owned.bytes().data() == owned_bytes && moved_mapped.bytes().data() == mapped_bytes &&
+                   std::ranges::equal(moved_mapped.bytes(), bytes) && owned.bytes().empty() && mapped.bytes().empty();
+        }},
+        {"ModuleBinary: Missing and empty files are rejected", [] {
+            std::string missing = (std::filesystem::temp_directory_path() / "wasm_interpreter_test_missing.wasm").string();
+            std::filesystem::remove(missing);
+            std::string empty = write_binary_file("empty.wasm", {});
+            return map_error(missing) == "Failed to open file: " + missing && !map_error(empty).empty() &&
+                   ModuleBinary::map_file(empty).bytes().empty();
+        }},
+    },
+};
@@ -0,0 +1,105 @@
+#include "TestSuite.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+static constexpr uint32_t LAZY_TEST_THREADS = 8;
+
+// Function 0 counts to 1000 in a loop and stores the count at address 0, function 1 returns
+// p + 7, function 2 stores function 1 of 3 at address 4, and function 3, if asked for, is invalid
+static TestModule lazy_module(bool with_invalid_function) {
+    TestModule module{{
+        {{}, {}, {
+            0x01, 0x01, 0x7f,
+            0x03, 0x40, 0x20, 0x00, 0x41, 0x01, 0x6a, 0x22, 0x00, 0x41, 0xe8, 0x07, 0x48, 0x0d, 0x00, 0x0b,
+            0x41, 0x00, 0x20, 0x00, 0x36, 0x02, 0x00,
+            0x0b,
+        }},
+        {{0x7f}, {0x7f}, {0x00, 0x20, 0x00, 0x41, 0x07, 0x6a, 0x0b}},
+        {{}, {}, {0x00, 0x41, 0x04, 0x41, 0x03, 0x10, 0x01, 0x36, 0x02, 0x00, 0x0b}},
+    }, {0x00, 1}};
+    if (with_invalid_function) {
+        // Returns an i64 for an i32
+        module.functions.push_back({{}, {0x7f}, {0x00, 0x42, 0x01, 0x0b}});
+    }
+    return module;
+}
+
+static std::string invoke_error(Interpreter& instance, uint32_t function_index) {
+    try {
+        instance.invoke(function_index);
+    } catch (const std::runtime_error& e) {
+        std::cout << "Error: " << e.what() << std::endl;
+        return e.what();
+    }
+    return "";
+}
+
+const HostTestSuite test_31 = {
+    "Test31 (lazy compilation)",
+    {
+        {"Lazy compilation: Concurrent first calls translate a function once", [] {
+            auto compiled_module = CompiledModule::compile(lazy_module(false).assemble(), CompileOptions{.lazy = true});
+            const FunctionTable& functions = compiled_module->module().functions;
+            std::vector<const RegisterInstruction*> translations(LAZY_TEST_THREADS);
+            std::vector<uint8_t> results(LAZY_TEST_THREADS); // Not vector<bool>, whose elements share bytes
+            std::vector<std::thread> threads;
+            for (uint32_t i = 0; i < LAZY_TEST_THREADS; ++i) {
+                threads.emplace_back([&compiled_module, &functions, &translations, &results, i] {
+                    Interpreter instance(compiled_module);
+                    // Half of them race to translate the called function from its caller, the others directly
+                    if (i % 2 == 0) {
+                        results[i] = instance.invoke(2).ok() && instance.get_memory_i32(4) == 10;
+                    } else {
+                        compiled_module->prepare_function(1);
+                        results[i] = true;
+                    }
+                    translations[i] = functions.register_code[1].data();
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            for (uint32_t i = 0; i < LAZY_TEST_THREADS; ++i) {
+                // A second translation would have been copied elsewhere in the arena
+                if (!results[i] || translations[i] == nullptr || translations[i] != functions.register_code[1].data()) {
+                    std::cout << "Thread " << i << " differs" << std::endl;
+                    return false;
+                }
+            }
+            return true;
+        }},
+        {"Lazy compilation: Only the functions that are called are translated", [] {
+            auto compiled_module = CompiledModule::compile(lazy_module(true).assemble(), CompileOptions{.lazy = true});
+            const FunctionTable& functions = compiled_module->module().functions;
+            bool none_before = functions.register_code[0].empty() && functions.register_code[1].empty() &&
+                               functions.register_code[2].empty() && functions.register_code[3].empty();
+            Interpreter instance(compiled_module);
+            return none_before && instance.invoke(2).ok() && expect_i32(4, 10)(instance) &&
+                   functions.register_code[0].empty() && !functions.register_code[1].empty() &&
+                   !functions.register_code[2].empty() && functions.register_code[3].empty();
+        }},
+        {"Lazy compilation: An invalid function fails on every call while the others run", [] {
+            auto compiled_module = CompiledModule::compile(lazy_module(true).assemble(), CompileOptions{.lazy = true});
+            Interpreter instance(compiled_module);
+            std::string first_error = invoke_error(instance, 3);
+            bool others_run = instance.invoke(0).ok() && instance.invoke(2).ok() &&
+                              expect_i32(0, 1000)(instance) && expect_i32(4, 10)(instance);
+            std::string second_error = invoke_error(instance, 3);
+            return first_error.ends_with("type mismatch") && second_error == first_error && others_run &&
+                   compiled_module->module().functions.register_code[3].empty();
+        }},
+        {"Lazy compilation: Prepared functions are the same as compiled eagerly", [] {
+            std::vector<uint8_t> bytes = lazy_module(false).assemble();
+            auto eager = CompiledModule::compile(bytes);
+            auto lazy = CompiledModule::compile(bytes, CompileOptions{.lazy = true});
+            for (uint32_t i = 0; i < lazy->module().functions.size(); ++i) {
+                lazy->prepare_function(i);
+            }
+            Interpreter instance(lazy);
+            return same_compiled_module(eager->module(), lazy->module()) && instance.invoke(0).ok() &&
+                   expect_i32(0, 1000)(instance);
+        }},
+    },
+};
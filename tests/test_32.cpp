@@ -0,0 +1,91 @@
+#include "TestSuite.h"
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+static constexpr uint32_t TABLE_TEST_THREADS = 4;
+
+// Functions whose frames all differ. Function 0 stores function 1 of 5 at address 0, function 2
+// of 5 and 2 at address 4, and function 3 of 5 at address 8; function 4 declares 65537 locals
+// in two runs
+static TestModule function_table_module() {
+    return {{
+        {{}, {}, {0x00, 0x41, 0x00, 0x41, 0x05, 0x10, 0x01, 0x36, 0x02, 0x00, 0x41, 0x04, 0x41, 0x05, 0x41, 0x02, 0x10, 0x02,
+                  0x36, 0x02, 0x00, 0x41, 0x08, 0x41, 0x05, 0x10, 0x03, 0x36, 0x02, 0x00, 0x0b}},
+        // 1: p * p kept in a local, plus 1
+        {{0x7f}, {0x7f}, {0x01, 0x01, 0x7f, 0x20, 0x00, 0x20, 0x00, 0x6c, 0x21, 0x01, 0x20, 0x01, 0x41, 0x01, 0x6a, 0x0b}},
+        // 2: function 1 of p0, minus p1
+        {{0x7f, 0x7f}, {0x7f}, {0x00, 0x20, 0x00, 0x10, 0x01, 0x20, 0x01, 0x6b, 0x0b}},
+        // 3: p + 7, of the same signature as function 1
+        {{0x7f}, {0x7f}, {0x00, 0x20, 0x00, 0x41, 0x07, 0x6a, 0x0b}},
+        // 4: 65536 i32 and one i64, the last of which it reads
+        {{}, {}, {0x02, 0x80, 0x80, 0x04, 0x7f, 0x01, 0x7e, 0x20, 0x80, 0x80, 0x04, 0x1a, 0x0b}},
+    }, {0x00, 1}};
+}
+
+// Whether an instance of the module computes what function 0 stores
+static bool computes_table_results(const std::shared_ptr<const CompiledModule>& compiled_module,
+                                   const TieringPolicy& tiering_policy = {}) {
+    Interpreter instance(compiled_module, tiering_policy);
+    return instance.invoke(0).ok() && instance.get_memory_i32(0) == 26 && instance.get_memory_i32(4) == 24 &&
+           instance.get_memory_i32(8) == 12;
+}
+
+const HostTestSuite test_32 = {
+    "Test32 (function table)",
+    {
+        {"Function table: Every array has an entry per function, and each frame its own counts", [] {
+            auto compiled_module = CompiledModule::compile(function_table_module().assemble());
+            const FunctionTable& functions = compiled_module->module().functions;
+            uint32_t expected_frames[][3] = {{0, 0, 0}, {1, 1, 1}, {2, 0, 1}, {1, 0, 1}, {0, 65537, 0}};
+            if (functions.size() != 5 || functions.register_code.size() != 5 || functions.register_branch_table.size() != 5 ||
+                functions.local_declarations.size() != 5 || functions.code.size() != 5 || functions.instructions.size() != 5 ||
+                functions.branch_table.size() != 5 || functions.register_origins.size() != 5) {
+                return false;
+            }
+            for (uint32_t i = 0; i < functions.size(); ++i) {
+                const FrameLayout& frame = functions.frames[i];
+                if (frame.param_count != expected_frames[i][0] || frame.local_count != expected_frames[i][1] ||
+                    frame.result_count != expected_frames[i][2] || functions.register_code[i].empty() ||
+                    functions.register_origins[i].size() != functions.register_code[i].size()) {
+                    std::cout << "Function " << i << " differs" << std::endl;
+                    return false;
+                }
+            }
+            return computes_table_results(compiled_module);
+        }},
+        {"Function table: Locals stay in the runs they are declared in", [] {
+            auto compiled_module = CompiledModule::compile(function_table_module().assemble());
+            std::span<const LocalDeclaration> locals = compiled_module->module().functions.local_declarations[4];
+            return locals.size() == 2 && locals[0].count == 65536 && locals[0].type == ValueType::I32 &&
+                   locals[1].count == 1 && locals[1].type == ValueType::I64;
+        }},
+        {"Function table: Equal signatures share their types", [] {
+            auto compiled_module = CompiledModule::compile(function_table_module().assemble());
+            const Module& module = compiled_module->module();
+            const FunctionType& first = module.types[module.function_type_indices[1]];
+            const FunctionType& same = module.types[module.function_type_indices[3]];
+            const FunctionType& other = module.types[module.function_type_indices[2]];
+            return first.canonical_index == same.canonical_index && first.params.data() == same.params.data() &&
+                   first.results.data() == same.results.data() && other.canonical_index != first.canonical_index;
+        }},
+        {"Function table: Calls compute the same however the module is compiled", [] {
+            std::vector<uint8_t> bytes = function_table_module().assemble();
+            auto serial = CompiledModule::compile(bytes, CompileOptions{.threads = 1});
+            auto parallel = CompiledModule::compile(bytes, CompileOptions{.threads = TABLE_TEST_THREADS});
+            auto lazy = CompiledModule::compile(bytes, CompileOptions{.lazy = true});
+            std::filesystem::path directory = std::filesystem::temp_directory_path() / "wasm_interpreter_test_table";
+            std::filesystem::remove_all(directory);
+            CompiledModule::compile(bytes, CompileOptions{.cache_directory = directory.string()});
+            auto cached = CompiledModule::compile(bytes, CompileOptions{.cache_directory = directory.string()});
+            bool results = computes_table_results(serial) && computes_table_results(parallel) &&
+                           computes_table_results(lazy) && computes_table_results(cached) &&
+                           computes_table_results(serial, TieringPolicy{0, 0});
+            // Function 4 is only translated once it is prepared
+            lazy->prepare_function(4);
+            return results && same_compiled_module(serial->module(), parallel->module()) &&
+                   same_compiled_module(serial->module(), lazy->module()) &&
+                   same_compiled_module(serial->module(), cached->module());
+        }},
+    },
+};
@@ -3,11 +3,12 @@
 #include <string>
 #include <functional>
 #include <iomanip>
-#include <fstream>
+#include <filesystem>
+#include <cstdio>
 
-#include "../src/Parser.h"
-#include "../src/Module.h"
+#include "../src/CompiledModule.h"
 #include "../src/Interpreter.h"
+#include "../src/ModuleCache.h"
 #include "test_01.cpp"
 #include "test_02.cpp"
 #include "test_03.cpp"
@@ -17,6 +18,29 @@
 #include "test_07.cpp"
 #include "test_08.cpp"
 #include "test_09.cpp"
+#include "test_10.cpp"
+#include "test_11.cpp"
+#include "test_12.cpp"
+#include "test_13.cpp"
+#include "test_14.cpp"
+#include "test_15.cpp"
+#include "test_16.cpp"
+#include "test_17.cpp"
+#include "test_18.cpp"
+#include "test_19.cpp"
+#include "test_20.cpp"
+#include "test_21.cpp"
+#include "test_22.cpp"
+#include "test_23.cpp"
+#include "test_24.cpp"
+#include "test_25.cpp"
+#include "test_26.cpp"
+#include "test_27.cpp"
+#include "test_28.cpp"
+#include "test_29.cpp"
+#include "test_30.cpp"
+#include "test_31.cpp"
+#include "test_32.cpp"
 
 const std::vector all_suites_to_run = {
     test_01,
@@ -30,13 +54,67 @@ const std::vector all_suites_to_run = {
     test_09,
 };
 
-std::vector<uint8_t> load_wasm_file(const std::string& path) {
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open()) throw std::runtime_error("Failed to open file: " + path);
-    return {(std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()};
+const std::vector all_host_suites_to_run = {
+    test_10,
+    test_11,
+    test_12,
+    test_13,
+    test_14,
+    test_15,
+    test_16,
+    test_17,
+    test_18,
+    test_19,
+    test_20,
+    test_21,
+    test_22,
+    test_23,
+    test_24,
+    test_25,
+    test_26,
+    test_27,
+    test_28,
+    test_29,
+    test_30,
+    test_31,
+    test_32,
+};
+
+// With a cache directory, every module is compiled into the cache first and then loaded back from it
+static std::shared_ptr<const CompiledModule> compile_suite_module(const std::string& wasm_path,
+                                                                  const CompileOptions& compile_options) {
+    if (compile_options.cache_directory.empty()) {
+        return CompiledModule::compile(ModuleBinary::map_file(wasm_path), compile_options);
+    }
+    ModuleBinary binary = ModuleBinary::map_file(wasm_path);
+    std::string artifact_path = ModuleCache(compile_options.cache_directory).artifact_path(binary.bytes());
+    std::remove(artifact_path.c_str());
+
+    CompileOptions storing_options = compile_options;
+    storing_options.lazy = false;
+    CompiledModule::compile(ModuleBinary::map_file(wasm_path), storing_options);
+    if (!std::filesystem::exists(artifact_path)) {
+        throw std::runtime_error("The module was not stored in the cache: " + artifact_path);
+    }
+    return CompiledModule::compile(std::move(binary), compile_options);
 }
 
-int main() {
+// With --compile-eagerly every function is promoted to compiled code on its first call,
+// with --compile-lazily every function is validated and translated on its first call,
+// with --module-cache DIR every module runs as loaded from a module cache in DIR
+int main(int argc, char* argv[]) {
+    TieringPolicy tiering_policy;
+    CompileOptions compile_options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--compile-eagerly") {
+            tiering_policy = TieringPolicy{0, 0};
+        } else if (std::string(argv[i]) == "--compile-lazily") {
+            compile_options.lazy = true;
+        } else if (std::string(argv[i]) == "--module-cache" && i + 1 < argc) {
+            compile_options.cache_directory = argv[++i];
+        }
+    }
+
     int total_passed = 0;
     int total_ran = 0;
 
@@ -47,17 +125,17 @@ int main() {
         int suite_passed_count = 0;
 
         try {
-            auto wasm_binary = load_wasm_file(suite.wasm_path);
-            Module my_module;
-            Parser parser(wasm_binary);
-            parser.parse_into(my_module);
-            Interpreter interpreter(my_module);
+            auto compiled_module = compile_suite_module(suite.wasm_path, compile_options);
+            Interpreter interpreter(compiled_module, tiering_policy);
 
             for (const auto& test : suite.tests) {
                 std::cout << "Running: " << test.name << std::endl;
                 try {
-                    interpreter.invoke(test.function_index_to_run);
-                    if (test.verify(interpreter)) {
+                    InvokeResult result = interpreter.invoke(test.function_index_to_run);
+                    if (!result.ok()) {
+                        std::cout << "ERROR: " << trap_message(result.trap) << " in function " << result.function_index
+                                  << " at instruction " << result.pc << std::endl;
+                    } else if (test.verify(interpreter)) {
                         std::cout << "SUCCESS" << std::endl;
                         suite_passed_count++;
                     } else {
@@ -77,6 +155,32 @@ int main() {
         std::cout << "Suite Summary: " << suite_passed_count << " / " << suite.tests.size() << " passed." << std::endl;
     }
 
+    for (const auto& suite : all_host_suites_to_run) {
+        std::cout << "\n=================================================" << std::endl;
+        std::cout << "  RUNNING SUITE: " << suite.name << std::endl;
+        std::cout << "=================================================\n" << std::endl;
+        int suite_passed_count = 0;
+
+        for (const auto& test : suite.tests) {
+            std::cout << "Running: " << test.name << std::endl;
+            try {
+                if (test.check()) {
+                    std::cout << "SUCCESS" << std::endl;
+                    suite_passed_count++;
+                } else {
+                    std::cout << "FAILURE" << std::endl;
+                }
+            } catch (const std::exception& e) {
+                std::cout << "ERROR: " << e.what() << std::endl;
+            }
+            std::cout << std::endl;
+        }
+
+        total_passed += suite_passed_count;
+        total_ran += suite.tests.size();
+        std::cout << "Suite Summary: " << suite_passed_count << " / " << suite.tests.size() << " passed." << std::endl;
+    }
+
     std::cout << "=================================================" << std::endl;
     std::cout << "  OVERALL SUMMARY: " << total_passed << " / " << total_ran << " passed." << std::endl;
     std::cout << "=================================================\n" << std::endl;